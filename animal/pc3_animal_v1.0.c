@@ -13,15 +13,44 @@
 #include <complex.h>
 #include "dbscan_animals.c"
 #include <stdlib.h>
-int frame_number = 0; 
-int point_cnt_array[3] = {0};
-int row_temp = 0;
-int frame_number_inf = 0; 
-int animal_count = 0;
-int temp_maxofindex = 0;
-int temp_count_nan_normal = 0;
+#include "../common/frame_reader.h"
+#include "../common/serial_port.h"
+#include "../common/radar_decode.h"
+#include "../common/pc_tlv.h"
+#include "../common/cluster_stats.h"
+#include "../common/dbscan_window.h"
+#include "../common/stage_timer.h"
+#include "../common/result_log.h"
+#include "../common/dashboard.h"
+#include "../common/frame_ring.h"
+#include "../common/stop_signal.h"
+#include "../common/task_pool.h"
+#define ANIMAL_TARGET_GATE 0.6 //點離target中心多遠內算同一群, 同dbscan的epsilon
+#define ANIMAL_MAX_CLUSTERS 100 //動物上限100, 多的群不算
+#define ANIMAL_MAX_WINDOW_FRAMES 32 //--window-frames上限
+//pipeline狀態, 原本的全域變數與要跨frame保留的上一frame的群
+typedef struct {
+	int mode;               //1:顯示mode 0:debug mode
+	char filename[64];      //csv檔名
+	result_log_t csv;       //一直開著, 背景thread批次寫入
+	dashboard_region_t view; //畫面上的幾行
+	int frame_number_inf;   //有點雲的frame數
+	int animal_count;       //分過群的frame數, 第1個沒得比較
+	int temp_maxofindex;    //上一frame最大的label
+	int temp_count_nan_normal; //上一frame的點數
+	float temp_store_mean_xy[ANIMAL_MAX_CLUSTERS][2]; //上一frame每群的中心
+	unsigned long tracker_frames, dbscan_frames; //label來自雷達tracker / host dbscan的frame數
+	frame_ring_t ring;      //最近N frame濾好轉好的點(x,y,z,range,doppler,snr), 最舊的在前, 每frame只放新的點進去
+	dbscan_window_t window; //最近N frame已經分好群的點, 每frame只放新的點進去, 最舊的frame自己移出去
+	float (*frame_pos)[6];  //這frame濾好轉好的點, 放進ring之前
+	int *window_labels;     //以下都只會變大, 不用每frame在stack上開陣列
+	cluster_stats_t *window_clusters;
+	int scratch_cap;
+} animal_ctx_t;
+
+dashboard_t dash; //畫面緩衝區不小, 不放stack
+int use_dbscan = 0; //--dbscan: 跑dbscan, 預設用v1.0的range bins
 
-float temp_store_mean_xy [100][2];
 //int sort 的function
 int compare (const void * a, const void * b)
 {
@@ -29,834 +58,684 @@ int compare (const void * a, const void * b)
   float fb = *(const float*) b;
   return (fa > fb) - (fa < fb);
 }
-//float sort 的function
-int cmpfunc (const void * a, const void * b)
+//v1.0的dbscan_output把沒有點的range bin拿掉, 後面的label往前補, 順序不變
+//labels是0 ~ num_labels-1(num_labels <= CLUSTER_RANGE_BINS_MAX), 回傳有點的bin數
+int compact_labels(int *labels, int n, int num_labels)
 {
-	return (*(float*)a - *(float*)b);
-}
-//ieee 754 function decoder的strust 規範 ieee 754的格式
-typedef union {
-	float f;
-	struct
+	int remap[CLUSTER_RANGE_BINS_MAX];
+	for(int k=0; k < num_labels; ++k)
 	{
-		unsigned int mantissa : 23;
-		unsigned int exponent : 8;
-		unsigned int sign : 1;
-	} raw;
-} myfloat;
-//ieee 754 function 從二進位轉成int
-unsigned int convertToInt(int* arr, int low, int high)
-{
-	unsigned f = 0, i;
-	for (i = high; i >= low; i--) {
-		f = f + arr[i] * pow(2, high - i);
+		remap[k] = -1;
+	}
+	for(int num=0; num < n; ++num)
+	{
+		if (labels[num] >= 0)
+		{
+			remap[labels[num]] = 0;
+		}
+	}
+	int used = 0;
+	for(int k=0; k < num_labels; ++k)
+	{
+		if (remap[k] == 0)
+		{
+			remap[k] = used++;
+		}
+	}
+	for(int num=0; num < n; ++num)
+	{
+		if (labels[num] >= 0)
+		{
+			labels[num] = remap[labels[num]];
+		}
 	}
-	return f;
+	return used;
 }
-// ieee 754 convert main function
-unsigned int ieee754_convert(int* ieee)
+//累加最近window_frames個frame的點, 開不了csv或記憶體不夠回傳-1
+int animal_ctx_init(animal_ctx_t *ctx, int mode, const char *csv_name, int window_frames)
 {
-	myfloat var;
-	unsigned f = convertToInt(ieee, 9, 31);
-	var.raw.mantissa = f;
-	f = convertToInt(ieee, 1, 8);
-	var.raw.exponent = f;
-	var.raw.sign = ieee[0];
-	return var.f;
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->mode = mode;
+	snprintf(ctx->filename, sizeof(ctx->filename), "%s", csv_name);
+	dashboard_region_init(&ctx->view, &dash, 0, DASHBOARD_ROWS);
+	if (frame_ring_init(&ctx->ring, window_frames, 6) != 0)
+		return -1;
+	if (dbscan_window_init(&ctx->window, DBSCAN_EPSILON, DBSCAN_MINPTS, DBSCAN_GRID_DIMS, ctx->ring.frames) != 0)
+	{
+		frame_ring_free(&ctx->ring);
+		return -1;
+	}
+	if (result_log_open(&ctx->csv, ctx->filename, "a") != 0)
+	{
+		dbscan_window_free(&ctx->window);
+		frame_ring_free(&ctx->ring);
+		return -1;
+	}
+	return 0;
 }
-// tlvTypeInfo的strust
-struct tlvTypeInfo{
-	int unitByte;
-	int stateString;
-	int sbyte;
-	int dataByte;
-	int retCnt;
-	float nPoint;
-	};
-//玖邦python SDK寫死unitByte, sbyte, dataByte, stateString數值
-struct tlvTypeInfo changeit(struct tlvTypeInfo, int state, int count);
-struct tlvTypeInfo changeit(struct tlvTypeInfo s, int state, int count)
+
+//frame_pos, window_labels, window_clusters放得下n個, 記憶體不夠回傳-1
+int animal_ctx_reserve(animal_ctx_t *ctx, int n)
 {
-	s.unitByte = 20;
-	s.sbyte = 8;
-	s.dataByte = 0;
-	s.stateString = 3;
-	if (state = 2) //相當於python sdk v6
+	if (n <= ctx->scratch_cap)
+		return 0;
+	float (*pos)[6] = realloc(ctx->frame_pos, n * sizeof(*pos));
+	if (pos != NULL)
+		ctx->frame_pos = pos;
+	int *labels = realloc(ctx->window_labels, n * sizeof(*labels));
+	if (labels != NULL)
+		ctx->window_labels = labels;
+	cluster_stats_t *clusters = realloc(ctx->window_clusters, n * sizeof(*clusters));
+	if (clusters != NULL)
+		ctx->window_clusters = clusters;
+	if (pos == NULL || labels == NULL || clusters == NULL)
 	{
-		s.unitByte = 20;
-		s.sbyte = 8;
-		s.dataByte = 8;
+		printf("Error allocating frame buffers\n");
+		return -1;
 	}
-	s.retCnt =  count - s.unitByte - s.sbyte;
-	s.nPoint =  s.retCnt / s.sbyte;
-	return (s);
+	ctx->scratch_cap = n;
+	return 0;
 }
-int main(int argc, char *argv[]) {
-  //++++++++++++++++++++++++++++++++++++//
-  int mode = atoi((argv[1])); //1:顯示mode 0:debug mode
-  //++++++++++++++++++++++++++++++++++++//
+
+void animal_ctx_free(animal_ctx_t *ctx)
+{
+	result_log_close(&ctx->csv);
+	result_log_report(&ctx->csv);
+	dbscan_window_free(&ctx->window);
+	frame_ring_free(&ctx->ring);
+	free(ctx->frame_pos);
+	free(ctx->window_labels);
+	free(ctx->window_clusters);
+	ctx->frame_pos = NULL;
+	ctx->window_labels = NULL;
+	ctx->window_clusters = NULL;
+	ctx->scratch_cap = 0;
+}
+
+//處理一個完整的frame, 點放進ctx->ring, 分群後跟上一frame的群比較寫進csv
+void animal_process_frame(animal_ctx_t *ctx, const unsigned char *read_buf, int size)
+{
   time_t rawtime;
   struct tm *info;
-  char buffer[80];
-  //獲取時間
-  time(&rawtime);
-  info = localtime(&rawtime);
-  //顯示時間
-  printf("現在時間%s\n", asctime(info));
-  char csv_name[10];
-  printf("輸入檔名+.csv：");
-  //輸入的檔名 變數=csv_name
-  scanf("%s", csv_name);
-  char *filename = csv_name;
-  //宣告PORT號
-  int serial_port = open("/dev/ttyTHS1", O_RDWR);
-  struct termios tty;
-  Struct output;
-  //如果沒有PORT 跳錯誤
-  if(tcgetattr(serial_port, &tty) != 0) {
-      printf("Error %i from tcgetattr: %s\n", errno, strerror(errno));
-      return 1;
-  }
-  //獲取時間
-  tty.c_cflag &= ~PARENB; 
-  tty.c_cflag &= ~CSTOPB;
-  tty.c_cflag &= ~CSIZE; 
-  tty.c_cflag |= CS8; 
-  tty.c_cflag &= ~CRTSCTS;
-  tty.c_cflag |= CREAD | CLOCAL; 
-  tty.c_lflag &= ~ICANON;
-  tty.c_lflag &= ~ECHO; 
-  tty.c_lflag &= ~ECHOE; 
-  tty.c_lflag &= ~ECHONL; 
-  tty.c_lflag &= ~ISIG; 
-  tty.c_iflag &= ~(IXON | IXOFF | IXANY); 
-  tty.c_iflag &= ~(IGNBRK|BRKINT|PARMRK|ISTRIP|INLCR|IGNCR|ICRNL); 
-  tty.c_oflag &= ~OPOST;
-  tty.c_oflag &= ~ONLCR;
-  tty.c_cc[VTIME] = 10;   
-  tty.c_cc[VMIN] = 0;
-  //Baudrate
-  cfsetispeed(&tty, B921600);
-  cfsetospeed(&tty, B921600);
-  //如果沒有PORT 跳錯誤
-  if (tcsetattr(serial_port, TCSANOW, &tty) != 0) {
-      printf("Error %i from tcsetattr: %s\n", errno, strerror(errno));
-      return 1;
-  }
-  //放讀入的byte
-  char read_buf [1024];
-  int size;
   //限制一開始讀入的magicWord
   int magicWord[8] = {2, 1, 4, 3, 6, 5, 8, 7};
-  unsigned long int header_reader_output[9];
-  unsigned long int byte[4];
-  unsigned int ieee[32];
-  int k=0;
-
-  while(1) 
+  pc_frame_t pc;
+  int total_point = 0;
+  stage_timer_poll();
+  if (ctx->mode == 0)
   {
-	  while ((size = read(serial_port, &read_buf, sizeof(read_buf)-1))>0)
+	printf("----------start-----------\n");
+	printf("magic_words\n");
+  }
+  //
+  //初始state設為0
+  int state = 0;
+  if (state == 0)
+  {
+	  int same = 0;
+	  //讀取8bytes
+	  for (int ix=0; ix< 8; ++ix) 
+	  {		
+			//讀入的值要跟magicWord一樣才可以達到20hz
+			if (read_buf[ix] == magicWord[ix])
+			{   
+				if (ctx->mode == 0)
+				{
+					printf("%d\n", read_buf[ix]);
+				}
+				same++;
+				if (same==8)
+				{   //讀滿8個magicWordstate轉成1
+					state = 1;
+				}
+			}
+	  }		  
+  }
+  
+  uint64_t t_stage = stage_begin(); //各階段耗時, --timing-every N 或 SIGUSR1 印出
+  if (state ==1)
+  {	
+	  //header之後的numTLVs個TLV全部走過一次, 6:點雲 7:target list 8:target index, 其他type照長度跳過
+	  //TLV長度超過10000或超出frame長度會被重來
+	  if (pc_parse_frame(read_buf, size, &pc) != 0)
 	  {
-		  struct tlvTypeInfo tlvTypeInfo_value;
-		  struct tlvTypeInfo tlvTypeInfo_value1;
-		  if (mode == 0)
-		  {
-			printf("----------start-----------\n");
-			printf("magic_words\n");
-	      } 
-		  //
-		  //初始state設為0
-		  int state = 0;
-		  if (state == 0)
+		  state = 0;
+	  }
+	  else
+	  {
+		  state = 2;
+	  }
+	  if (ctx->mode == 0 && state == 2)
+	  {
+		  printf("----------header-----------\n");		
+		  printf("%u\n%u\n%u\n%u\n%u\n%u\n%u\n%u\n%u\n", pc.header.version, pc.header.totalPackLen, pc.header.platform,
+				 pc.header.frameNumber, pc.header.subframeNumber, pc.header.chirpMargin, pc.header.frameMargin,
+				 pc.header.trackProcessTime, pc.header.uartSendTime);
+		  printf("%u\n%u\n", pc.header.numTLVs, pc.header.checksum);
+		  printf("----------TLV-----------\n");
+		  printf("TLVs:%d skipped:%d\n", pc.num_tlvs, pc.skipped_tlvs);
+		  printf("nPoint:%d\n", pc.num_points);
+		  printf("targets:%d\n", pc.num_targets);
+		  printf("target index:%d\n", pc.num_index);
+	  } 
+  }
+  
+  if (state ==2)
+  {
+	  total_point = pc.num_points;
+	  state = 4;
+  }
+  float v6_2d_output[total_point > 0 ? total_point : 1][5];		  
+  //(e,a,d,r,s) = struct.unpack('2b3h', sbuf)   
+  if (state == 4) //v6
+  {
+	  /*
+	  elv = e * self.u.elevationUnit
+	  azi = a * self.u.azimuthUnit
+	  dop = d * self.u.dopplerUnit
+	  ran = r * self.u.rangeUnit
+	  snr = s * self.u.snrUnit
+	  */
+	  decode_pc_points(pc.points, total_point, &pc.unit, v6_2d_output);
+	  stage_end(STAGE_DECODE, t_stage);
+	  if (ctx->mode == 0)
+	  {
+		  for (int id_point=0; id_point< total_point; ++id_point) 
 		  {
-			  int same = 0;
-			  //讀取8bytes
-			  for (int ix=0; ix< 8; ++ix) 
-			  {		
-					//讀入的值要跟magicWord一樣才可以達到20hz
-					if (read_buf[ix] == magicWord[ix])
-					{   
-						if (mode == 0)
-						{
-							printf("%d\n", read_buf[ix]);
-						}
-						same++;
-						if (same==8)
-						{   //讀滿8個magicWordstate轉成1
-							state = 1;
-						}
-					}
-			  }		  
+			  printf("elevation:%f azimuth:%f doppler:%f range:%f snr:%f\n", v6_2d_output[id_point][0], v6_2d_output[id_point][1], v6_2d_output[id_point][2], v6_2d_output[id_point][3], v6_2d_output[id_point][4]);
 		  }
-		  
-		  if (state ==1)
-		  {	
-			  if (mode == 0)
-			  {
-				  printf("----------header-----------\n");		
-			  } 
-			  //前8個已經被state=0讀過了，所以讀後40個bytes 1I=2H 1I=4Bytes
-			  for (int ix=8; ix< 48; ++ix) 
+	  }		  
+	  if (total_point > 0)
+	  {
+		  state = 5;		
+	  }
+  }
+  if (state == 5)
+  {
+	  if (ctx->mode == 0)
+	  {
+		  printf("現在第%d frame!\n", ctx->frame_number_inf);
+	  }
+	  
+	  int row = sizeof(v6_2d_output) / sizeof(v6_2d_output[0]); //二維陣列的大小
+	  //這frame的點濾掉snr太小的, 轉成x y z range doppler snr, 再濾掉0/NAN/太遠的, 每個點只做一次
+	  t_stage = stage_begin();
+	  int small_snr_count = 0;
+	  float snr_tr = 0.0; //太小的SNR刪除閥值! 可調整
+	  for(int num=0; num < row; ++num)//找snr小於8的
+	  {
+		  if (!(v6_2d_output[num][4]>snr_tr)) //跟下面放陣列的條件相反, snr剛好等於閥值或NAN也要算
+		  {    
+			  if (ctx->mode == 0)
 			  {
-				  if (ix<44)
-				  {
-				      //解self.hdr.version,self.hdr.totalPackLen,self.hdr.platform,self.hdr.frameNumber,self.hdr.subframeNumber,self.hdr.chirpMargin,self.hdr.frameMargin,self.hdr.trackProcessTime,self.hdr.uartSendTime,
-					  if (ix%4==0)
-					  {
-						  if (mode == 0)
-						  {
-							  printf("%d\n", ((read_buf[ix] << 0) + (read_buf[ix+1] << 8) + (read_buf[ix+2] << 16) + (read_buf[ix+3] << 24)) );
-						  }
-					  }	  
-				  }
-				  else
-				  {
-					  //解self.hdr.numTLVs,self.hdr.checksum
-					  
-					  if (ix%2==0)
-					  {	  
-						  if (mode == 0)
-						  {
-							  printf("%d\n", ((read_buf[ix] << 0) + (read_buf[ix+1] << 8)));
-						  }
-					  }  
-					  if (ix==47)
-					  {
-						  state = 2;
-						  //讀完40個byte後 state = 2
-					  }
-				  }
+				  printf("snr small detect!:%f\n", v6_2d_output[num][4]); //小於8會被PRINT出來
 			  }
+			  small_snr_count+=1;
 		  }
-		  
-		  if (state ==2)
+	  }
+	  if (ctx->mode == 0)
+	  {
+		  printf("small_snr_count%d\n", small_snr_count); //陣列大小變了 因為小於2的要刪掉
+	  }
+	  stage_end(STAGE_SNR_FILTER, t_stage);
+	  /*
+	  Python Code
+	  for i in range(len(pct)):
+		  zt = pct[i][3] * np.sin(pct[i][0]) + zOffSet
+		  xt = pct[i][3] * np.cos(pct[i][0]) * np.sin(pct[i][1])
+		  yt = pct[i][3] * np.cos(pct[i][0]) * np.cos(pct[i][1])
+		  pos1X[i] = (xt,yt,zt,pct[i][3],pct[i][2],pct[i][4]) # [x,y,z,range,Doppler,noise]
+	  */
+	  t_stage = stage_begin();
+	  int stored = animal_ctx_reserve(ctx, row) == 0; //記憶體不夠ring不變, 這frame不算
+	  int zero_nan_count = 0; 
+	  int frame_kept = 0; //frame_pos裡這frame留下的點數
+	  for(int num=0; stored && num < row; ++num)
+	  {
+		  if (!(v6_2d_output[num][4]>snr_tr))
 		  {
-			  int tlvLength;
-			  if (mode ==0)
+			  continue;
+		  }
+		  float *pos1X = ctx->frame_pos[frame_kept]; //寫在下一個空位, 被濾掉的下一個點會蓋過去
+		  pos1X[0] = v6_2d_output[num][3] * cos(v6_2d_output[num][0]) * sin(v6_2d_output[num][1]);
+		  pos1X[1] = v6_2d_output[num][3] * cos(v6_2d_output[num][0]) * cos(v6_2d_output[num][1]);
+		  pos1X[2] = 0.0;
+		  pos1X[3] = v6_2d_output[num][3];
+		  pos1X[4] = v6_2d_output[num][2];
+		  pos1X[5] = v6_2d_output[num][4];
+		  if (ctx->mode == 0)
+		  {
+			  printf("x:%f y:%f z:%f range:%f Doppler:%f noise:%f\n", pos1X[0], pos1X[1], pos1X[2], pos1X[3], pos1X[4], pos1X[5]);	
+		  }	
+		  //偵測0或是NAN或是INF
+		  if ((pos1X[0]==0.0 && pos1X[1]==0.0 && pos1X[3]==0.0) || pos1X[0]== -0.0 || pos1X[1]== -0.0 || pos1X[3]== -0.0 || pos1X[4] < -10.0 || pos1X[4] > 10 || pos1X[0]+pos1X[1]>30.0 || pos1X[0]+pos1X[1]<-30.0)
+		  {
+			  if (ctx->mode == 0)
 			  {
-				  printf("----------TLV Header-----------\n");
+				  printf("DETECT!:x:%f y:%f z:%f range:%f Doppler:%f noise:%f\n", pos1X[0], pos1X[1], pos1X[2], pos1X[3], pos1X[4], pos1X[5]);
 			  }
-			  for (int ix=48; ix< 56; ++ix) 
+			  zero_nan_count+=1;
+		  }
+		  else
+		  {
+			  frame_kept+=1;
+		  }
+	  }
+	  stage_end(STAGE_TRANSFORM, t_stage);
+	  //這frame接在ring最後面, 最舊的frame自己移出去, 前幾frame的點不用再搬也不用再轉
+	  stored = stored && frame_ring_push(&ctx->ring, &ctx->frame_pos[0][0], frame_kept) == 0;
+	  int window_points = frame_ring_points(&ctx->ring);
+	  
+	  //前N frame只累加點雲, labels跟clusters要放得下N frame的點跟ANIMAL_MAX_CLUSTERS群
+	  if (stored && frame_ring_full(&ctx->ring) && ctx->frame_number_inf >= ctx->ring.frames &&
+	      animal_ctx_reserve(ctx, window_points > ANIMAL_MAX_CLUSTERS ? window_points : ANIMAL_MAX_CLUSTERS) == 0)
+	  {
+		  //N frame濾好轉好的點直接在ring裡, 最舊的在前
+		  int wo_nan = window_points;
+		  const float (*pos1a_wo_nan)[6] = (const float (*)[6]) frame_ring_rows(&ctx->ring);
+		  int count_nan_normal = wo_nan;
+		  if (ctx->mode == 0)
+		  {
+			  printf("總共%d個點雲\n", wo_nan);
+		  }
+		  //雷達有送target list(type 7)就直接用target在list裡的順序(0 ~ num_targets-1)當label, 不用在host上跑dbscan
+		  //label超過上限(ANIMAL_MAX_CLUSTERS)的設-1, 一個點都沒被target認領才退回dbscan
+		  //labels[num]是pos1a_wo_nan第num個點的label, 不屬於任何群的是負的
+		  int *labels = ctx->window_labels;
+		  int num_labels = 0; //label是0 ~ num_labels-1
+		  int tracker = pc.num_targets > 0 && pc_targets_label_points(&pc, &pos1a_wo_nan[0][0], 6, wo_nan, ANIMAL_TARGET_GATE, labels) > 0;
+		  if (!tracker && !use_dbscan) //v1.0: 每個點的群就是range取整數, 1公尺一群
+		  {
+			  num_labels = cluster_range_bins(&pos1a_wo_nan[0][0], 6, wo_nan, 3, labels);
+			  num_labels = compact_labels(labels, wo_nan, num_labels);
+		  }
+		  if (tracker)
+		  {
+			  for(int num=0; num < wo_nan; ++num)
 			  {
-				  if (ix%4==0)
+				  if (labels[num] >= ANIMAL_MAX_CLUSTERS)
 				  {
-					  tlvLength = ((read_buf[ix] << 0) + (read_buf[ix+1] << 8) + (read_buf[ix+2] << 16) + (read_buf[ix+3] << 24)); 
-					  if (mode == 0)
-					  {
-						  printf("%d\n", ((read_buf[ix] << 0) + (read_buf[ix+1] << 8) + (read_buf[ix+2] << 16) + (read_buf[ix+3] << 24)));
-					  }
-					  if (ix == 48)
-					  {
-						  //ttype 這裡是後來發現的這個值只會有6, 7, 8，對應sdk的state 
-						  if (tlvLength != 6)
-						  {
-							  state = 0;
-							  break;
-						  }
-					  }
-					  if (ix == 52)
-					  {
-						  //tlvLength 超過10000會被重來
-						  if (tlvLength > 10000)
-						  {
-							  state = 0;
-							  break;
-						  }
-					  }
+					  labels[num] = -1;
 				  }
-				  
-				  if (ix==55)
+				  if (labels[num] >= num_labels)
 				  {
-					  //unitByteCount,lstate ,plen ,dataBytes,lenCount, numOfPoints = self.tlvTypeInfo(ttype,self.tlvLength,disp)丟進副程式tlvTypeInfo()
-					  tlvTypeInfo_value1 = changeit(tlvTypeInfo_value, state, tlvLength);
-					  // 會回傳以下值 供後續處理
-					  if (mode == 0)
-					  {
-						  printf("unitByte:%d\n", tlvTypeInfo_value1.unitByte);
-						  printf("stateString:%d\n", tlvTypeInfo_value1.stateString);
-						  printf("sbyte:%d\n", tlvTypeInfo_value1.sbyte);
-						  printf("dataByte:%d\n", tlvTypeInfo_value1.dataByte);
-						  printf("retCnt:%d\n", tlvTypeInfo_value1.retCnt);
-						  printf("nPoint:%f\n", tlvTypeInfo_value1.nPoint);						
-					  }				  
-					  state = tlvTypeInfo_value1.stateString;
+					  num_labels = labels[num] + 1;
 				  }
-				  
 			  }
 		  }
-		  float V6_unit[5];
-		  if (state == 3)
+		  cluster_stats_t *clusters = ctx->window_clusters; //放得下N frame的點跟ANIMAL_MAX_CLUSTERS群
+		  if (tracker)
 		  {
-			  //self.u.elevationUnit,self.u.azimuthUnit,self.u.dopplerUnit,self.u.rangeUnit,self.u.snrUnit = struct.unpack('5f', sbuf) 解5個float
-			  for (int ix2=0; ix2<5; ++ix2)  //5個float
-			  {
-				  for (int ix1=59+(ix2*4); ix1> 55+(ix2*4); --ix1) 
-				  {
-					  for (int ix=0; ix< 8; ++ix) 
-					  {
-						  ieee[k] = (read_buf[ix1] << ix & 0x80) >> 7; //把讀到的8個待處理的bytes位移存到陣列裡
-						  k++;
-					  }				  
-				  }
-				  //處理ieee 754
-				  k = 0;
-				  myfloat var;
-				  unsigned f = convertToInt(ieee, 9, 31);
-				  var.raw.mantissa = f;
-				  f = convertToInt(ieee, 1, 8);      
-				  var.raw.exponent = f;
-				  var.raw.sign = ieee[0];
-				  //V6_unit 存 self.u.elevationUnit,self.u.azimuthUnit,self.u.dopplerUnit,self.u.rangeUnit,self.u.snrUnit 
-				  V6_unit[ix2] = var.f;
-				  //printf("unit %f\n", var.f);				  
-			  }	
-			  state = 4;		  
+			  ctx->tracker_frames+=1;
+			  dbscan_window_clear(&ctx->window); //window少了這frame, 下次跑dbscan時3 frame重放
 		  }
-		  int total_point;
-		  total_point = (int) tlvTypeInfo_value1.retCnt/8.0;
-		  int v6_point_before[5];
-		  float v6_point_after[5];
-		  float v6_2d_output[total_point][5];		  
-		  //(e,a,d,r,s) = struct.unpack('2b3h', sbuf)   
-		  if (state == 4) //v6
+		  else if (use_dbscan) //range bins的label上面已經分好
 		  {
-			
-			  for (int id_point=0; id_point< total_point; ++id_point) 
+			  //送進dbscan, 座標已經在pos1a_wo_nan裡不用再拿一份
+			  //window裡有前N-1 frame的點就只放這frame的點, 分群結果跟整個N frame跑dbscan一樣
+			  t_stage = stage_begin();
+			  int pushed = 1;
+			  int last = ctx->ring.frames - 1;
+			  if (ctx->window.num_frames < ctx->ring.frames) //剛開始或上一frame沒跑dbscan, ring裡的N frame重放
 			  {
-				  //int index = 76;
-				  int index = 76+(8*id_point);
-				  for (int ix=index; ix< index+2; ++ix) //76-84 先解2b
+				  dbscan_window_clear(&ctx->window);
+				  int start = 0;
+				  for(int f=0; f < ctx->ring.frames && pushed; ++f)
 				  {
-					  if (read_buf[ix]>128)  //因為有正負號要先判斷
-					  {
-						  signed char aaa;
-						  aaa = read_buf[ix];
-						  v6_point_before[ix-index] = aaa;
-					  }
-					  else //因為有正負號要先判斷
-					  {
-						  char aaa;
-						  aaa = read_buf[ix];
-						  v6_point_before[ix-index] = aaa;
-					  }
-				  }//printf("%d\n", ((read_buf[ix] << 0) + (read_buf[ix+1] << 8)));
-				  for (int ix=index+2; ix< index+8; ix = ix+2) //76-84 再解3h
-				  {
-					  if (((read_buf[ix] << 0) + (read_buf[ix+1] << 8))>32768) //因為有正負號要先判斷
-					  {
-						  signed short bbb;
-						  bbb = ((read_buf[ix] << 0) + (read_buf[ix+1] << 8));
-						  v6_point_before[(ix-(index-2))/2] = bbb;
-					  }
-					  else //因為有正負號要先判斷
-					  {
-						  short bbb;
-						  bbb = ((read_buf[ix] << 0) + (read_buf[ix+1] << 8));
-						  v6_point_before[(ix-(index-2))/2] = bbb;
-					  }
-				  }
-				  //v6_point_before放的就是e,a,d,r,s
-				  /*
-				  elv = e * self.u.elevationUnit
-				  azi = a * self.u.azimuthUnit
-		    	  dop = d * self.u.dopplerUnit
-				  ran = r * self.u.rangeUnit
-				  snr = s * self.u.snrUnit
-				  */
-				  size_t len_v6_point = sizeof(v6_point_before)/sizeof(v6_point_before[0]);
-				  for(int num=0; num < len_v6_point; ++num)
-				  {
-					  v6_point_after[num] = v6_point_before[num]*V6_unit[num]; //相乘得到elv, azi, dop, ran, snr
-					  v6_2d_output[id_point][num] = v6_point_before[num]*V6_unit[num]; //相乘得到elv, azi, dop, ran, snr
-				  }
-				  if (mode == 0)
-				  {
-					  printf("elevation:%f azimuth:%f doppler:%f range:%f snr:%f\n", v6_point_after[0], v6_point_after[1], v6_point_after[2], v6_point_after[3], v6_point_after[4]);
-				  }		  
-			      if (id_point == total_point - 1)
-			      {
-					  state = 5;		
+					  pushed = dbscan_window_push(&ctx->window, &pos1a_wo_nan[start][0], 6, frame_ring_frame_rows(&ctx->ring, f)) == 0;
+					  start += frame_ring_frame_rows(&ctx->ring, f);
 				  }
 			  }
+			  else //ring最後面就是這frame
+			  {
+				  pushed = dbscan_window_push(&ctx->window, &pos1a_wo_nan[wo_nan - frame_ring_frame_rows(&ctx->ring, last)][0], 6, frame_ring_frame_rows(&ctx->ring, last)) == 0;
+			  }
+			  if (pushed)
+			  {
+				  num_labels = dbscan_window_labels(&ctx->window, &pos1a_wo_nan[0][0], 6, labels, NULL, 4, NULL);
+			  }
+			  else //記憶體不夠window已清空, 這frame整個跑dbscan
+			  {
+				  num_labels = dbscan_labels(&pos1a_wo_nan[0][0], 6, wo_nan, labels, NULL, NULL, 4, NULL);
+			  }
+			  stage_end(STAGE_DBSCAN, t_stage);
+			  ctx->dbscan_frames+=1;
 		  }
-		  if (state == 5)
+		  if (num_labels < 0) //記憶體不夠, 當作沒有群
 		  {
-			  if (mode == 0)
+			  num_labels = 0;
+		  }
+		  if (num_labels > ANIMAL_MAX_CLUSTERS) //dbscan也可能分出超過上限的群, temp_store_mean_xy放不下
+		  {
+			  num_labels = ANIMAL_MAX_CLUSTERS;
+		  }
+		  //每群的點數跟中心, xy在15公尺外的點照樣分群, 只是不算進中心跟點數(v1.0)
+		  cluster_stats_begin(clusters, num_labels);
+		  for(int num=0; num < wo_nan; ++num)
+		  {
+			  if (pos1a_wo_nan[num][0]<15 && pos1a_wo_nan[num][1]<15 && pos1a_wo_nan[num][0] > -15 && pos1a_wo_nan[num][1] > -15)
 			  {
-				  printf("現在第%d frame!\n", frame_number_inf);
+				  cluster_stats_add(clusters, num_labels, labels[num], pos1a_wo_nan[num], 4);
 			  }
-			  
-			  int row = sizeof(v6_2d_output) / sizeof(v6_2d_output[0]); //二維陣列的大小
-			  int column = sizeof(v6_2d_output[0])/sizeof(v6_2d_output[0][0]); //二維陣列的大小
-			  float v6_2d_output_bigdata[1000][5];	
-			  
-			  if (frame_number_inf>2) //前3frame會繼續累加點雲
+		  }
+		  cluster_stats_end(clusters, num_labels, labels, wo_nan, NULL);
+		  if (ctx->mode ==0)
+		  {
+			  for(int num=0; num < wo_nan; ++num)
 			  {
-				  int cnt_3 = point_cnt_array[1] + point_cnt_array[2] + row;
-				  if (mode == 0)
-				  {
-					  printf("總共%d個點雲\n", cnt_3);
-				  }
-				  //printf("總共%d個點雲\n", cnt_3);
-				  float pos1a[cnt_3][5];
-				  //放前2 FRAME到最終陣列
-				  for(int num=0; num < point_cnt_array[1] + point_cnt_array[2]; ++num)
-				  {
-					  //printf("%d\n", num);
-					  for(int num_1=0; num_1 < 5; ++num_1) // put number in array
-					  {
-						  pos1a[num][num_1] = v6_2d_output_bigdata[num+point_cnt_array[0]][num_1];
-					  }
-				  }	
-				  //放第3FRAME到最終陣列
-				  for(int num=0; num < row; ++num)
-				  {
-					  for(int num_1=0; num_1 < 5; ++num_1) // put number in array
-					  {
-						  pos1a[num+point_cnt_array[1] + point_cnt_array[2]][num_1] = v6_2d_output[num][num_1];
-					  }
-				  }	
-				  int small_snr_count = 0;
-				  float snr_tr = 0.0; //太小的SNR刪除閥值! 可調整
-				  for(int num=0; num < cnt_3; ++num)//找snr小於8的
-				  {
-					  if (pos1a[num][4]<snr_tr)
-					  {    
-						  if (mode == 0)
-						  {
-							  printf("snr small detect!:%f\n", pos1a[num][4]); //小於8會被PRINT出來
-						  }
-						  small_snr_count+=1;
-					  }
-				  }
-				  if (mode == 0)
-				  {
-					  printf("small_snr_count%d\n", small_snr_count); //陣列大小變了 因為小於2的要刪掉
-				  }
-				  int wo_snr = 	cnt_3 - small_snr_count;
-				  float pos1a_wo_snr[wo_snr][5];
-				  int count = 0;
-				  for(int num=0; num < cnt_3; ++num)//把snr大於8的放陣列
-				  {
-					  if (pos1a[num][4]>snr_tr)
-					  {
-						  pos1a_wo_snr[count][0] = pos1a[num][0]; //再放一遍
-						  pos1a_wo_snr[count][1] = pos1a[num][1]; //再放一遍
-						  pos1a_wo_snr[count][2] = pos1a[num][2]; //再放一遍
-						  pos1a_wo_snr[count][3] = pos1a[num][3]; //再放一遍
-						  pos1a_wo_snr[count][4] = pos1a[num][4]; //再放一遍
-						  count+=1;
-					  }
-				  } 
-				  int row_wo_snr = sizeof(pos1a_wo_snr) / sizeof(pos1a_wo_snr[0]); //二維陣列的大小
-				  int column_wo_snr = sizeof(pos1a_wo_snr[0])/sizeof(pos1a_wo_snr[0][0]); //二維陣列的大小
-				  //printf("row_wo_snr = %d\n", row_wo_snr);
-				  float pos1X[row_wo_snr][6];	
-				  int zero_nan_count = 0; 
-				  /*
-				  printf("Number of rows: %d\n", row_wo_snr);
-				  printf("Number of columns: %d\n", column_wo_snr);
-				  Python Code
-				  for i in range(len(pct)):
-				  	  zt = pct[i][3] * np.sin(pct[i][0]) + zOffSet
-					  xt = pct[i][3] * np.cos(pct[i][0]) * np.sin(pct[i][1])
-					  yt = pct[i][3] * np.cos(pct[i][0]) * np.cos(pct[i][1])
-					  pos1X[i] = (xt,yt,zt,pct[i][3],pct[i][2],pct[i][4]) # [x,y,z,range,Doppler,noise]
-				  */
-				  for(int num=0; num < row_wo_snr; ++num)
-				  {
-					  float zt, yt, xt;
-					  zt = 0.0;
-					  xt = pos1a_wo_snr[num][3] * cos(pos1a_wo_snr[num][0]) * sin(pos1a_wo_snr[num][1]);
-					  yt = pos1a_wo_snr[num][3] * cos(pos1a_wo_snr[num][0]) * cos(pos1a_wo_snr[num][1]);
-					  pos1X[num][0] = xt;
-					  pos1X[num][1] = yt;
-					  pos1X[num][2] = zt;
-					  pos1X[num][3] = pos1a_wo_snr[num][3];
-					  pos1X[num][4] = pos1a_wo_snr[num][2];
-					  pos1X[num][5] = pos1a_wo_snr[num][4];
-					  if (mode == 0)
-					  {
-						  printf("x:%f y:%f z:%f range:%f Doppler:%f noise:%f\n", pos1X[num][0], pos1X[num][1], pos1X[num][2], pos1X[num][3], pos1X[num][4], pos1X[num][5]);	
-					  }	
-					  
-					  //偵測0或是NAN或是INF
-					  if ((pos1X[num][0]==0.0 && pos1X[num][1]==0.0 && pos1X[num][3]==0.0) || pos1X[num][0]== -0.0 || pos1X[num][1]== -0.0 || pos1X[num][3]== -0.0 || pos1X[num][4] < -10.0 || pos1X[num][4] > 10 || pos1X[num][0]+pos1X[num][1]>30.0 || pos1X[num][0]+pos1X[num][1]<-30.0)
-					  {
-						  zero_nan_count+=1;
-					  }	  			  
-				  }	
-				  //偵測0或是NAN或是INF
-				  //printf("zero_nan_count%d\n", zero_nan_count);
-				  int wo_nan = row_wo_snr - zero_nan_count;
-				  //printf("wo_nan%d\n", wo_nan);
-				  float pos1a_wo_nan[wo_nan][6];
-				  int count_nan_normal = 0;
-				  for(int num=0; num < row_wo_snr; ++num)//偵測0或是NAN或是INF 不是的放新陣列
-				  {
-					  
-					  if ((pos1X[num][0]==0.0 && pos1X[num][1]==0.0 && pos1X[num][3]==0.0) || pos1X[num][0]== -0.0 || pos1X[num][1]== -0.0 || pos1X[num][3]== -0.0 || pos1X[num][4] < -10.0 || pos1X[num][4] > 10 || pos1X[num][0]+pos1X[num][1]>30.0 || pos1X[num][0]+pos1X[num][1]<-30.0)
-					  {
-						  //printf("pos1X[num][0] %f pos1X[num][1] %f pos1X[num][3] %f\n", pos1X[num][0], pos1X[num][1], pos1X[num][3]);
-					       if (mode == 0)
-						   {
-							  printf("DETECT!:x:%f y:%f z:%f range:%f Doppler:%f noise:%f\n", pos1X[num][0], pos1X[num][1], pos1X[num][2], pos1X[num][3], pos1X[num][4], pos1X[num][5]);
-						   }
-					  }
-					  
-					  else
-					  {
-						  pos1a_wo_nan[count_nan_normal][0] = pos1X[num][0];
-						  pos1a_wo_nan[count_nan_normal][1] = pos1X[num][1];
-						  pos1a_wo_nan[count_nan_normal][2] = pos1X[num][2];
-						  pos1a_wo_nan[count_nan_normal][3] = pos1X[num][3];
-						  pos1a_wo_nan[count_nan_normal][4] = pos1X[num][4];
-						  pos1a_wo_nan[count_nan_normal][5] = pos1X[num][5];
-						  count_nan_normal+=1;						  
-					  }
-				  } 
-				  //送進dbscan
-				  output = dbscan_output(pos1a_wo_nan, wo_nan);
-				  if (mode ==0)
-				  {
-					  for(int num=0; num < wo_nan; ++num)
-					  {
-						  printf("num = %d", num);
-						  printf("output dbscan x:%f y:%f z:%f index:%f\n", output.vsos[num][0], output.vsos[num][1], output.vsos[num][2], output.vsos[num][3]);	
-					  }					
-				  }
-
-				  
-				  float index_point[wo_nan];
+				  printf("num = %d", num);
+				  printf("output dbscan x:%f y:%f z:%f index:%d\n", pos1a_wo_nan[num][0], pos1a_wo_nan[num][1], pos1a_wo_nan[num][2], labels[num]);	
+			  }					
+		  }
 
-				  //計算每個label有多少個點
-				  for(int num=0; num < wo_nan; ++num)
-				  {
-					  index_point[num] = output.vsos[num][3];
-				  }
-				  //把所有資料放在sensorA裡
-				  float sensorA[wo_nan][4];	
-				  for(int num=0; num < wo_nan; ++num)
-				  {
-					  for(int num_1=0; num_1 < 3; ++num_1) // put number in array
-					  {
-						  sensorA[num][num_1] = output.vsos[num][num_1];
-					  }
-					  sensorA[num][3] = output.vsos[num][3];
-				  }
-				  if (mode == 0)
-				  {
-					for(int num=0; num < wo_nan; ++num)
-					{
-						printf("sensorA dbscan x:%f y:%f z:%f index:%f\n", sensorA[num][0], sensorA[num][1], sensorA[num][2], sensorA[num][3]);	
-					}					
-				  }
+		  ctx->animal_count+=1;
+		  int maxofindex = num_labels - 1; //最大的label, 沒有群是-1
+		  if (ctx->mode == 0)
+		  {
+			  printf("有%d個群\n\n", maxofindex);
+		  }
+		  float store_mean_xy [num_labels > 0 ? num_labels : 1][2];
+		  int numberofclude [num_labels > 0 ? num_labels : 1];
+		  int limitpoint = 20;
+		  //每群的中心點跟點數直接從clusters拿, 沒有點的label中心設0.0
+		  for(int num=0; num < maxofindex+1; ++num)
+		  {
+			  numberofclude[num] = clusters[num].count;
+			  store_mean_xy[num][0] = clusters[num].centroid[0];
+			  store_mean_xy[num][1] = clusters[num].centroid[1];
+			  if (ctx->mode == 0)
+			  {
+				  printf("index=%d mean x=%f mean y=%f\n", num, store_mean_xy[num][0], store_mean_xy[num][1]);
+			  }
+		  }
+		  int limit_count = 0;
+		  
 
+		  for(int num=0; num < maxofindex+1; ++num)
+		  {
+			  if (ctx->mode == 0)
+			  {
+				  printf("第%d個群 有%d個點\n", num, numberofclude[num]);
+			  }
+			  if (numberofclude[num]>limitpoint)
+			  {
+				  limit_count+=1;
+			  }
+		  } 					  
+		  
+		  
+		  if (ctx->animal_count==1) //如果是第1 frame沒得比較
+		  {
+			  ctx->temp_maxofindex = maxofindex;
+			  ctx->temp_count_nan_normal = count_nan_normal;
+			  //temp_store_mean_xy就放上一frame的資料	
+			  for(int num=0; num < ctx->temp_maxofindex+1; ++num)
+			  {
+				  ctx->temp_store_mean_xy[num][0] = store_mean_xy[num][0];
+				  ctx->temp_store_mean_xy[num][1] = store_mean_xy[num][1];
+			  }
+		  }
+		  else
+		  {	  
+			  if(ctx->mode == 0)
+			  {
+				printf("\n上一禎有%d個群\n", ctx->temp_maxofindex);
+				printf("上一禎有%d個點\n", ctx->temp_count_nan_normal);	
+				for(int num=0; num < ctx->temp_maxofindex+1; ++num)
+				{   //顯示上一frame 資訊
+					printf("上一禎 index = %d mean x = %f mean_y = %f\n", num, ctx->temp_store_mean_xy[num][0], ctx->temp_store_mean_xy[num][1]);
+				}
+				printf("\n現在禎有%d個群\n", maxofindex);
+				printf("現在禎有%d個點\n", count_nan_normal);
+					
+				for(int num=0; num < maxofindex+1; ++num)
+				{   //現在的資訊
+					printf("現在禎 index = %d mean x = %f mean_y = %f\n", num, store_mean_xy[num][0], store_mean_xy[num][1]);
+				}							
+			  } 
+			  //畫面只改有變的行, 最多--display-hz次/秒, debug mode照舊一行行印出
+			  dashboard_begin(&ctx->view);
+			  int limitnum = 0;
+			  if  (maxofindex == ctx->temp_maxofindex)
+			  {
+				  //printf("cal dis:\n"); //計算距離中
+				  dashboard_printf(&ctx->view, "==============================================\n");
+				  dashboard_printf(&ctx->view, "|      Version: V1.0                         |\n");
+				  dashboard_printf(&ctx->view, "==============================================\n");
+				  dashboard_printf(&ctx->view, "|                   總共%d個                  |\n", limit_count);
+				  dashboard_printf(&ctx->view, "==============================================\n");
 				  
-				  animal_count+=1;
-				  qsort(index_point, wo_nan, sizeof(float), cmpfunc);
-				  int maxofindex = (int) index_point[wo_nan-1];
-				  if (mode == 0)
-				  {
-					  printf("有%d個群\n\n", maxofindex);
-				  }
-				  float store_mean_xy [maxofindex][2];
-				  int numberofclude [maxofindex];
-				  int limitpoint = 20;
-				  for(int num=0; num < maxofindex+1; ++num)
-				  {
-					  float mean_number_x = 0;
-					  float mean_number_y = 0;
-					  int label_count = 0;
-					  for(int num_2=0; num_2 < wo_nan; ++num_2)
-					  { 	
-						  //temp_numberofclude = 0;
-						  if (num == (int) sensorA[num_2][3])
-						  {
-							  if (sensorA[num_2][0]<15 && sensorA[num_2][1]<15 && sensorA[num_2][0] > -15 && sensorA[num_2][1] > -15)
-							  {
-								if (mode == 0)
-								{
-									printf("index=%d x=%f y=%f\n", num, sensorA[num_2][0],sensorA[num_2][1]);
-								} 
-								label_count+=1;
-								mean_number_x += sensorA[num_2][0];
-								mean_number_y += sensorA[num_2][1];
-							  }
-							  //找出相同LABEL有幾個
-						  }
-						  numberofclude[num] = label_count;
-					  }
-					  if (mode == 0)
-					  {
-						  printf("計算中心點中\n\n");
-					  }
-					  if (isnan(mean_number_x / label_count) == 1 || isnan(mean_number_y / label_count) == 1)
-					  {
-						  store_mean_xy[num][0] = 0.0; //如果異常就設0.0
-						  store_mean_xy[num][1] = 0.0; //如果異常就設0.0				  
-					  }
-					  else
-					  {
-						  //printf("label_count = %d\n", label_count);
-						  store_mean_xy[num][0] = mean_number_x / label_count; //找到中心點
-						  store_mean_xy[num][1] = mean_number_y / label_count; //找到中心點
-					  }
-				  }
-				  int limit_count = 0;
-				  
-
 				  for(int num=0; num < maxofindex+1; ++num)
 				  {
-					  if (mode == 0)
-					  {
-						  printf("第%d個群 有%d個點\n", num, numberofclude[num]);
-					  }
 					  if (numberofclude[num]>limitpoint)
 					  {
-						  limit_count+=1;
-					  }
-				  } 					  
-				  
-				  
-				  if (animal_count==1) //如果是第1 frame沒得比較
-				  {
-					  temp_maxofindex = (int) index_point[wo_nan-1];
-					  temp_count_nan_normal = count_nan_normal;
-					  //temp_store_mean_xy就放上一frame的資料	
-					  for(int num=0; num < temp_maxofindex+1; ++num)
-					  {
-						  temp_store_mean_xy[num][0] = store_mean_xy[num][0];
-						  temp_store_mean_xy[num][1] = store_mean_xy[num][1];
-					  }
-				  }
-				  else
-				  {	  
-					  if(mode == 0)
-					  {
-						printf("\n上一禎有%d個群\n", temp_maxofindex);
-						printf("上一禎有%d個點\n", temp_count_nan_normal);	
-						for(int num=0; num < temp_maxofindex+1; ++num)
-						{   //顯示上一frame 資訊
-							printf("上一禎 index = %d mean x = %f mean_y = %f\n", num, temp_store_mean_xy[num][0], temp_store_mean_xy[num][1]);
-						}
-						printf("\n現在禎有%d個群\n", maxofindex);
-						printf("現在禎有%d個點\n", count_nan_normal);
-							
-						for(int num=0; num < maxofindex+1; ++num)
-						{   //現在的資訊
-							printf("現在禎 index = %d mean x = %f mean_y = %f\n", num, store_mean_xy[num][0], store_mean_xy[num][1]);
-						}							
-					  } 
-					  if (mode == 1)
-					  {
-						printf("\e[1;1H");
-						system("clear");							
-					  }
-					  int limitnum = 0;
-					  if  (maxofindex == temp_maxofindex)
-					  {
-						  //printf("cal dis:\n"); //計算距離中
-						  printf("==============================================\n");
-						  printf("|      Version: V1.0                         |\n");
-						  printf("==============================================\n");
-						  printf("|                   總共%d個                  |\n", limit_count);
-						  printf("==============================================\n");
-						  
-						  for(int num=0; num < maxofindex+1; ++num)
+						  limitnum+=1;
+						  float temp_dis_x, temp_dis_y, dis;
+						  temp_dis_x = pow((store_mean_xy[num][0] - ctx->temp_store_mean_xy[num][0]), 2);
+						  temp_dis_y = pow((store_mean_xy[num][1] - ctx->temp_store_mean_xy[num][1]), 2);
+						  dis = sqrt(temp_dis_x+temp_dis_y); //計算l1 dis
+						  dashboard_printf(&ctx->view, "|                  index = %d                 |\n", limitnum);
+						  dashboard_printf(&ctx->view, "==============================================\n");
+						  time(&rawtime);
+						  info = localtime(&rawtime);		
+						  //用l1 dis判斷狀態					  
+						  if (dis<=0.04) //可調整
 						  {
-							  if (numberofclude[num]>limitpoint)
-							  {
-								  limitnum+=1;
-								  float temp_dis_x, temp_dis_y, dis;
-								  temp_dis_x = pow((store_mean_xy[num][0] - temp_store_mean_xy[num][0]), 2);
-								  temp_dis_y = pow((store_mean_xy[num][1] - temp_store_mean_xy[num][1]), 2);
-								  dis = sqrt(temp_dis_x+temp_dis_y); //計算l1 dis
-								  printf("|                  index = %d                 |\n", limitnum);
-								  printf("==============================================\n");
-								  time(&rawtime);
-								  info = localtime(&rawtime);		
-								  //用l1 dis判斷狀態					  
-								  if (dis<=0.04) //可調整
-								  {
-									  FILE *fp = fopen(filename, "a");
-									  if (fp == NULL)
-									  {
-										  //printf("error");
-										  return -1;
-									  }
-									  printf("|          停止 %s", asctime(info));
-									  printf("==============================================\n");
-									  fprintf(fp, "%d | %d, 停止, %s", limitnum, limit_count, asctime(info));
-									  fclose(fp);
-								  }
-								  else if(dis>=0.04 || dis<0.15) //可調整
-								  {
-									  FILE *fp = fopen(filename, "a");
-									  if (fp == NULL)
-									  {
-										  printf("error");
-										  return -1;
-									  }
-									  printf("|          慢移 %s", asctime(info));
-									  printf("==============================================\n");
-									  fprintf(fp, "%d | %d, 慢移, %s", limitnum, limit_count, asctime(info));
-									  fclose(fp);
-								  } 
-								  else
-								  {
-									  FILE *fp = fopen(filename, "a");
-									  if (fp == NULL)
-									  {
-										  printf("error");
-										  return -1;
-									  }
-									  printf("|          快移 %s", asctime(info));
-									  printf("==============================================\n");
-									  fprintf(fp, "%d | %d, 快移, %s", limitnum, limit_count, asctime(info));
-									  fclose(fp);
-								  }							  
-							  }
-
+							  uint64_t t_io = stage_begin();
+							  dashboard_printf(&ctx->view, "|          停止 %s", asctime(info));
+							  dashboard_printf(&ctx->view, "==============================================\n");
+							  result_log_printf(&ctx->csv, "%d | %d, 停止, %s", limitnum, limit_count, asctime(info));
+							  stage_end(STAGE_FILE_IO, t_io);
 						  }
-						  FILE *fp = fopen(filename, "a");
-						  if (fp == NULL)
+						  else if(dis>=0.04 || dis<0.15) //可調整
 						  {
-						  	  printf("error");
-							  return -1;
-						  }
-						  fprintf(fp, "end\n");
-						  fclose(fp);
-					  }
-					  else
-					  {
-						  //printf("else!\n");
-						  printf("==============================================\n");
-						  printf("|      Version: V1.0                         |\n");						  
-						  printf("==============================================\n");
-						  printf("|                   總共%d個                  |\n", limit_count);
-						  printf("==============================================\n");
-						  for(int num=0; num < maxofindex+1; ++num)
+							  uint64_t t_io = stage_begin();
+							  dashboard_printf(&ctx->view, "|          慢移 %s", asctime(info));
+							  dashboard_printf(&ctx->view, "==============================================\n");
+							  result_log_printf(&ctx->csv, "%d | %d, 慢移, %s", limitnum, limit_count, asctime(info));
+							  stage_end(STAGE_FILE_IO, t_io);
+						  } 
+						  else
 						  {
-							  if (numberofclude[num]>limitpoint)
-							  {
-								  limitnum+=1;
-								  FILE *fp = fopen(filename, "a");
-								  if (fp == NULL)
-								  {
-									  printf("error");
-									  return -1;
-								  }
-								  printf("|                  index = %d                 |\n", limitnum);
-								  printf("==============================================\n");
-								  //printf("x = %f y = %f\n", store_mean_xy[num][0], store_mean_xy[num][1]);
-								  printf("|          慢移 %s", asctime(info));
-								  printf("==============================================\n");
-								  fprintf(fp, "%d | %d, 慢移, %s", limitnum, limit_count, asctime(info));
-								  
-								  fclose(fp);								  
-							  }
-
-						  }
-						  FILE *fp = fopen(filename, "a");
-						  if (fp == NULL)
-						  {
-						  	  printf("error");
-							  return -1;
-						  }
-						  fprintf(fp, "end\n");
-						  fclose(fp);
-						  //printf("=====================結束=========================\n");
-						  //printf("=====================結束=========================\n\n");
-						  
-						  
-					  }
-					  //全部處裡完之後 把store_mean_xy的點雲放到temp_store_mean_xy
-					  temp_maxofindex = maxofindex;		
-					  temp_count_nan_normal = count_nan_normal;  
-					  for(int num=0; num < 100; ++num) //動物上限100
-					  {
-						  temp_store_mean_xy[num][0] = 0.0;
-						  temp_store_mean_xy[num][1] = 0.0;
-					  }
-					  for(int num=0; num < temp_maxofindex+1; ++num)
-					  {
-						  temp_store_mean_xy[num][0] = store_mean_xy[num][0];
-						  temp_store_mean_xy[num][1] = store_mean_xy[num][1];
+							  uint64_t t_io = stage_begin();
+							  dashboard_printf(&ctx->view, "|          快移 %s", asctime(info));
+							  dashboard_printf(&ctx->view, "==============================================\n");
+							  result_log_printf(&ctx->csv, "%d | %d, 快移, %s", limitnum, limit_count, asctime(info));
+							  stage_end(STAGE_FILE_IO, t_io);
+						  }							  
 					  }
-				  }
 
-				  //---------------------------------------------
-				  for(int num=0; num < 1000; ++num) // v6_2d_output_bigdata歸0
-				  {
-					  for(int num_1=0; num_1 < 5; ++num_1) // put number in array
-					  {
-						  v6_2d_output_bigdata[num][num_1] = 0;
-					  }
-				  }		
-				  for(int num=0; num < cnt_3; ++num) // pos1a放回v6_2d_output_bigdata
-				  {
-					  for(int num_1=0; num_1 < 5; ++num_1) // put number in array
-					  {
-						  v6_2d_output_bigdata[num][num_1] = pos1a[num][num_1];
-					  }
 				  }
-				  point_cnt_array[0] = point_cnt_array[1];
-				  point_cnt_array[1] = point_cnt_array[2];
-				  point_cnt_array[2] = row;
-
-				  
+				  uint64_t t_io = stage_begin();
+				  result_log_printf(&ctx->csv, "end\n");
+				  stage_end(STAGE_FILE_IO, t_io);
 			  }
 			  else
 			  {
-				  //point_cnt_array這個陣列是放點雲數量的
-				  point_cnt_array[frame_number] = row;
-				  if (mode == 0)
-				  {
-					  printf("row%d\n", row);
-					  printf("row_temp%d\n", row_temp);
-				  }
-				  //printf("row%d\n", row);
-				  //printf("row_temp%d\n", row_temp);
-				  for(int num=0+row_temp; num < row+row_temp; ++num)
+				  //printf("else!\n");
+				  time(&rawtime); //info不再是main裡的, 這裡也取這frame的時間
+				  info = localtime(&rawtime);
+				  dashboard_printf(&ctx->view, "==============================================\n");
+				  dashboard_printf(&ctx->view, "|      Version: V1.0                         |\n");						  
+				  dashboard_printf(&ctx->view, "==============================================\n");
+				  dashboard_printf(&ctx->view, "|                   總共%d個                  |\n", limit_count);
+				  dashboard_printf(&ctx->view, "==============================================\n");
+				  for(int num=0; num < maxofindex+1; ++num)
 				  {
-					  if (mode == 0)
-					  {
-						  printf("上一個frame的數量%d\n", row_temp);
-					  }
-					  //printf("上一個frame的數量%d\n", row_temp);
-					  for(int num_1=0; num_1 < 5; ++num_1) // put number in array
-					  {
-						  v6_2d_output_bigdata[num][num_1] = v6_2d_output[num-row_temp][num_1];
-					  }
-					  if (mode == 0)
+					  if (numberofclude[num]>limitpoint)
 					  {
-						  printf("第%d個frame, 共有%d個點雲\n",num, point_cnt_array[num]);		
+						  limitnum+=1;
+						  uint64_t t_io = stage_begin();
+						  dashboard_printf(&ctx->view, "|                  index = %d                 |\n", limitnum);
+						  dashboard_printf(&ctx->view, "==============================================\n");
+						  //printf("x = %f y = %f\n", store_mean_xy[num][0], store_mean_xy[num][1]);
+						  dashboard_printf(&ctx->view, "|          慢移 %s", asctime(info));
+						  dashboard_printf(&ctx->view, "==============================================\n");
+						  result_log_printf(&ctx->csv, "%d | %d, 慢移, %s", limitnum, limit_count, asctime(info));
+						  
+						  stage_end(STAGE_FILE_IO, t_io);								  
 					  }
-					  //printf("第%d個frame, 共有%d個點雲\n",num, point_cnt_array[num]);		
+
 				  }
-				  row_temp = row+row_temp;
+				  uint64_t t_io = stage_begin();
+				  result_log_printf(&ctx->csv, "end\n");
+				  stage_end(STAGE_FILE_IO, t_io);
+				  //printf("=====================結束=========================\n");
+				  //printf("=====================結束=========================\n\n");
+				  
+				  
 			  }
-			  if (mode == 0)
-			  { 
-				  for(int num=0; num < 3; ++num)  //顯示累積3FRAME的點雲數量
-				  {
-					  printf("第%d個frame, 共有%d個點雲\n",num, point_cnt_array[num]);		
-				  }				  
+			  dashboard_end(&ctx->view);
+			  //全部處裡完之後 把store_mean_xy的點雲放到temp_store_mean_xy
+			  ctx->temp_maxofindex = maxofindex;		
+			  ctx->temp_count_nan_normal = count_nan_normal;  
+			  for(int num=0; num < ANIMAL_MAX_CLUSTERS; ++num) //動物上限100
+			  {
+				  ctx->temp_store_mean_xy[num][0] = 0.0;
+				  ctx->temp_store_mean_xy[num][1] = 0.0;
 			  }
-
-			  
-			  if (frame_number == 3) //重製frame_number
+			  for(int num=0; num < ctx->temp_maxofindex+1; ++num)
 			  {
-				  frame_number = 0;
+				  ctx->temp_store_mean_xy[num][0] = store_mean_xy[num][0];
+				  ctx->temp_store_mean_xy[num][1] = store_mean_xy[num][1];
 			  }
-			  frame_number += 1;
-			  frame_number_inf+=1;
-			  
 		  }
 
+	  }
+	  else if (ctx->mode == 0)
+	  {
+		  printf("row%d\n", row);
+	  }
+	  if (ctx->mode == 0)
+	  { 
+		  for(int num=0; num < ctx->ring.num_frames; ++num)  //顯示累積N FRAME的點雲數量
+		  {
+			  printf("第%d個frame, 共有%d個點雲\n",num, frame_ring_frame_rows(&ctx->ring, num));		
+		  }				  
+	  }
+
+	  ctx->frame_number_inf+=1;
+	  
+	  }
+}
+//--xxx N的N, 不是lo ~ hi的整數印出錯誤回傳-1
+int int_option(int argc, char *argv[], int i, int lo, int hi)
+{
+	if (i + 1 >= argc)
+	{
+		printf("%s expects an argument\n", argv[i]);
+		return -1;
+	}
+	char *end;
+	long v = strtol(argv[i + 1], &end, 10);
+	if (end == argv[i + 1] || *end != '\0' || v < lo || v > hi)
+	{
+		printf("%s expects %d to %d, got %s\n", argv[i], lo, hi, argv[i + 1]);
+		return -1;
+	}
+	return (int) v;
+}
+//--dbscan-threads N: N frame的點雲有DBSCAN_PARALLEL_MIN_POINTS個以上時dbscan用N個thread, 預設1, N不對回傳-1
+int dbscan_threads_arg(int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++)
+		if (strcmp(argv[i], "--dbscan-threads") == 0)
+			return int_option(argc, argv, i, 1, TASK_POOL_MAX_THREADS);
+	return 1;
+}
+//--window-frames N: 累加最近N frame的點雲一起分群, 預設3, N不對回傳-1
+int window_frames_arg(int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++)
+		if (strcmp(argv[i], "--window-frames") == 0)
+			return int_option(argc, argv, i, 1, ANIMAL_MAX_WINDOW_FRAMES);
+	return 3;
+}
+//--dbscan: 用dbscan分群, 預設照v1.0每個點的群就是range取整數(1公尺一群), 門檻還沒對dbscan的群調過
+int dbscan_arg(int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++)
+		if (strcmp(argv[i], "--dbscan") == 0)
+			return 1;
+	return 0;
+}
+int main(int argc, char *argv[]) {
+  //++++++++++++++++++++++++++++++++++++//
+  int mode = atoi((argv[1])); //1:顯示mode 0:debug mode
+  //++++++++++++++++++++++++++++++++++++//
+  int dbscan_threads = dbscan_threads_arg(argc, argv); //先檢查, 不對就不用輸入檔名
+  int window_frames = window_frames_arg(argc, argv);
+  if (dbscan_threads < 0 || window_frames < 0)
+  {
+      printf("usage: %s <0:debug|1:顯示> [--window-frames 1-%d] [--dbscan-threads 1-%d]\n", argv[0], ANIMAL_MAX_WINDOW_FRAMES, TASK_POOL_MAX_THREADS);
+      return 1;
+  }
+  time_t rawtime;
+  struct tm *info;
+  char buffer[80];
+  //獲取時間
+  time(&rawtime);
+  info = localtime(&rawtime);
+  //顯示時間
+  printf("現在時間%s\n", asctime(info));
+  char csv_name[10];
+  printf("輸入檔名+.csv：");
+  //輸入的檔名 變數=csv_name
+  scanf("%s", csv_name);
+  stage_timer_init(argc, argv);
+  result_log_config(argc, argv);
+  //--headless 不顯示, --display-hz N 畫面更新率
+  dashboard_init(&dash, argc, argv, mode == 0);
+  dbscan_set_threads(dbscan_threads);
+  use_dbscan = dbscan_arg(argc, argv);
+  static animal_ctx_t ctx; //ring, window跟上一frame的群都在裡面, 不放stack
+  if (animal_ctx_init(&ctx, mode, csv_name, window_frames) != 0) {
+      return 1;
+  }
+  //宣告PORT號
+  //--record <檔名> 錄下UART原始資料, --replay <檔名> [--speed N|max] 不接雷達重播
+  capture_t capture;
+  if (capture_parse_args(&capture, argc, argv) != 0) {
+      return 1;
+  }
+  int serial_port = -1;
+  if (capture.mode != CAPTURE_REPLAY) {
+      serial_port = serial_open(serial_device_arg(argc, argv));
+      if (serial_port < 0) {
+          return 1;
+      }
+  }
+  //放讀入的byte 由frame_reader重組成完整的frame
+  frame_reader_t reader;
+  if (frame_reader_init(&reader, serial_port) != 0) {
+      printf("Error from frame_reader_init\n");
+      return 1;
+  }
+  frame_reader_set_capture(&reader, &capture);
+  reader.verify_checksum = 1; //people counting header有checksum, 錯誤數會在結束時印出
+  const unsigned char *read_buf;
+  int size;
+
+  stop_signal_init(); //Ctrl+C 或 kill 結束迴圈, 照樣寫完 csv 並印出統計
+  while (!stop_requested) 
+  {
+	  while (!stop_requested && (size = frame_reader_read(&reader, &read_buf))>0)
+	  {
+		  animal_process_frame(&ctx, read_buf, size);
+	  }
+		if (reader.eof) //重播結束
+		{
+			break;
 		}
   }
-  close(serial_port);
+  dashboard_close(&dash); //統計印在畫面下面
+  frame_reader_report(&reader);
+  stage_timer_report();
+  printf("label: tracker %lu frames, dbscan %lu frames\n", ctx.tracker_frames, ctx.dbscan_frames);
+  animal_ctx_free(&ctx);
+  frame_reader_free(&reader);
+  capture_close(&capture);
+  if (serial_port >= 0)
+      close(serial_port);
   return 0; // success
 }
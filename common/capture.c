@@ -0,0 +1,229 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "capture.h"
+#include "mono_clock.h"
+
+static void capture_reset(capture_t *c)
+{
+    memset(c, 0, sizeof(*c));
+    c->mode = CAPTURE_OFF;
+    c->fd = -1;
+    c->speed = 1.0;
+}
+
+static int write_all(int fd, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *) data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int capture_parse_args(capture_t *c, int argc, char *argv[])
+{
+    const char *record = NULL;
+    const char *replay = NULL;
+    double speed = 1.0;
+
+    capture_reset(c);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            record = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replay = argv[++i];
+        else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            const char *s = argv[++i];
+            if (strcmp(s, "max") == 0)
+                speed = 0;
+            else {
+                speed = atof(s);
+                if (speed <= 0) {
+                    printf("--speed expects a positive factor or max, got %s\n", s);
+                    return -1;
+                }
+            }
+        }
+        else if (strcmp(argv[i], "--record") == 0 || strcmp(argv[i], "--replay") == 0 || strcmp(argv[i], "--speed") == 0) {
+            printf("%s expects an argument\n", argv[i]);
+            return -1;
+        }
+    }
+
+    if (record != NULL && replay != NULL) {
+        printf("--record and --replay cannot be used together\n");
+        return -1;
+    }
+    if (record != NULL)
+        return capture_open_record(c, record);
+    if (replay != NULL)
+        return capture_open_replay(c, replay, speed);
+    return 0;
+}
+
+int capture_open_record(capture_t *c, const char *path)
+{
+    capture_file_header_t h;
+    struct timespec ts;
+
+    capture_reset(c);
+    c->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (c->fd < 0) {
+        printf("Error %i opening %s: %s\n", errno, path, strerror(errno));
+        return -1;
+    }
+    clock_gettime(CLOCK_REALTIME, &ts);
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    h.start_realtime_ns = (int64_t) ts.tv_sec * 1000000000ll + ts.tv_nsec;
+    if (write_all(c->fd, &h, sizeof(h)) != 0) {
+        printf("Error %i writing %s: %s\n", errno, path, strerror(errno));
+        close(c->fd);
+        c->fd = -1;
+        return -1;
+    }
+    c->mode = CAPTURE_RECORD;
+    c->path = path;
+    c->start_realtime_ns = h.start_realtime_ns;
+    c->start_ns = mono_ns();
+    return 0;
+}
+
+int capture_open_replay(capture_t *c, const char *path, double speed)
+{
+    capture_file_header_t h;
+    struct stat st;
+
+    capture_reset(c);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("Error %i opening %s: %s\n", errno, path, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(h)) {
+        printf("%s is not a capture file\n", path);
+        close(fd);
+        return -1;
+    }
+    // The whole capture is mapped, replay copies straight from the page cache
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        printf("Error %i mapping %s: %s\n", errno, path, strerror(errno));
+        return -1;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    memcpy(&h, map, sizeof(h));
+    if (memcmp(h.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0) {
+        printf("%s is not a capture file\n", path);
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    c->mode = CAPTURE_REPLAY;
+    c->path = path;
+    c->speed = speed;
+    c->map = (const uint8_t *) map;
+    c->map_len = st.st_size;
+    c->pos = sizeof(h);
+    c->start_realtime_ns = h.start_realtime_ns;
+    if (c->pos + sizeof(capture_record_t) <= c->map_len) {
+        capture_record_t rec;
+        memcpy(&rec, c->map + c->pos, sizeof(rec));
+        c->first_t_ns = rec.t_ns;
+    }
+    c->start_ns = mono_ns();
+    return 0;
+}
+
+void capture_write(capture_t *c, const uint8_t *data, size_t len, uint64_t t_ns)
+{
+    capture_record_t rec;
+
+    if (c->mode != CAPTURE_RECORD || len == 0)
+        return;
+    rec.t_ns = t_ns - c->start_ns;
+    rec.len = (uint32_t) len;
+    if (write_all(c->fd, &rec, sizeof(rec)) != 0 || write_all(c->fd, data, len) != 0) {
+        printf("Error %i writing %s: %s, recording stopped\n", errno, c->path, strerror(errno));
+        close(c->fd);
+        c->fd = -1;
+        c->mode = CAPTURE_OFF;
+    }
+}
+
+// Sleep until the recorded time t_ns is due on the playback clock.
+static void capture_pace(const capture_t *c, uint64_t t_ns)
+{
+    if (c->speed <= 0 || t_ns <= c->first_t_ns)
+        return;
+    uint64_t due = c->start_ns + (uint64_t) ((t_ns - c->first_t_ns) / c->speed);
+    uint64_t now = mono_ns();
+    if (due <= now)
+        return;
+    uint64_t wait = due - now;
+    struct timespec ts = { (time_t) (wait / 1000000000ull), (long) (wait % 1000000000ull) };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        ;
+}
+
+size_t capture_read(capture_t *c, uint8_t *dst, size_t cap)
+{
+    capture_record_t rec;
+
+    if (c->mode != CAPTURE_REPLAY)
+        return 0;
+    if (c->pos + sizeof(rec) > c->map_len)
+        return 0;
+    memcpy(&rec, c->map + c->pos, sizeof(rec));
+    const uint8_t *data = c->map + c->pos + sizeof(rec);
+    size_t avail = c->map_len - c->pos - sizeof(rec);
+    if (rec.len > avail)
+        rec.len = (uint32_t) avail;   // truncated capture, deliver what is there
+
+    if (c->rec_off == 0) {
+        capture_pace(c, rec.t_ns);
+        c->cur_t_ns = rec.t_ns;
+    }
+    // A record larger than the free space of the receive buffer is delivered in pieces
+    size_t n = rec.len - c->rec_off;
+    if (n > cap)
+        n = cap;
+    memcpy(dst, data + c->rec_off, n);
+    c->rec_off += n;
+    if (c->rec_off >= rec.len) {
+        c->pos += sizeof(rec) + rec.len;
+        c->rec_off = 0;
+    }
+    return n;
+}
+
+time_t capture_wall_time(const capture_t *c)
+{
+    if (c == NULL || c->mode != CAPTURE_REPLAY)
+        return time(NULL);
+    return (time_t) ((c->start_realtime_ns + (int64_t) c->cur_t_ns) / 1000000000ll);
+}
+
+void capture_close(capture_t *c)
+{
+    if (c->mode == CAPTURE_RECORD && c->fd >= 0)
+        close(c->fd);
+    if (c->mode == CAPTURE_REPLAY && c->map != NULL)
+        munmap((void *) c->map, c->map_len);
+    capture_reset(c);
+}
@@ -0,0 +1,82 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+Raw UART capture files, so a session can be replayed without the radar.
+File layout (little-endian):
+    capture_file_header_t
+    { capture_record_t, len bytes } ...   one record per read() on the port
+t_ns is the monotonic receive time relative to the start of the recording.
+*/
+
+#define CAPTURE_OFF 0
+#define CAPTURE_RECORD 1
+#define CAPTURE_REPLAY 2
+
+#define CAPTURE_MAGIC "MMWCAP1"
+
+typedef struct __attribute__((packed)) {
+    char magic[8];
+    int64_t start_realtime_ns;   // CLOCK_REALTIME when the recording started
+} capture_file_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint64_t t_ns;
+    uint32_t len;
+} capture_record_t;
+
+_Static_assert(sizeof(capture_file_header_t) == 16, "capture_file_header_t must be 16 bytes");
+_Static_assert(sizeof(capture_record_t) == 12, "capture_record_t must be 12 bytes");
+
+typedef struct capture_s capture_t;
+struct capture_s {
+    int mode;                 // CAPTURE_OFF, CAPTURE_RECORD or CAPTURE_REPLAY
+    const char *path;
+    double speed;             // replay speed factor, 0 = as fast as possible ("max")
+    int fd;                   // record: output file
+    const uint8_t *map;       // replay: mmap'd capture
+    size_t map_len;
+    size_t pos;               // replay: offset of the next record
+    size_t rec_off;           // replay: bytes of the current record already delivered
+    int64_t start_realtime_ns;
+    uint64_t start_ns;        // monotonic start of recording / playback
+    uint64_t first_t_ns;      // replay: t_ns of the first record
+    uint64_t cur_t_ns;        // replay: t_ns of the record being delivered
+};
+
+/*
+Read --record <file>, --replay <file> and --speed N|max from the command line
+and open the capture. Other arguments are left to the caller.
+return = 0 on success, -1 on a bad argument or when the file cannot be opened
+*/
+int capture_parse_args(capture_t *c, int argc, char *argv[]);
+
+int capture_open_record(capture_t *c, const char *path);
+int capture_open_replay(capture_t *c, const char *path, double speed);
+
+/*
+Append bytes received from the port.
+t_ns = monotonic receive time (mono_ns())
+*/
+void capture_write(capture_t *c, const uint8_t *data, size_t len, uint64_t t_ns);
+
+/*
+Deliver the next recorded bytes, sleeping to keep the recorded pace unless speed is max.
+dst = destination, cap = its size
+return = number of bytes, 0 at the end of the capture
+*/
+size_t capture_read(capture_t *c, uint8_t *dst, size_t cap);
+
+/*
+Wall clock seconds of the data being processed: now for a live port, the recorded time for a replay.
+The once per second pipelines use it so --speed max also speeds up their schedule.
+*/
+time_t capture_wall_time(const capture_t *c);
+
+void capture_close(capture_t *c);
+
+#endif // CAPTURE_H
@@ -0,0 +1,70 @@
+#include <string.h>
+
+#include "cluster_stats.h"
+
+void cluster_stats_begin(cluster_stats_t *c, int num_clusters)
+{
+    if (num_clusters > 0)
+        memset(c, 0, (size_t) num_clusters * sizeof(*c));
+}
+
+void cluster_stats_end(cluster_stats_t *c, int num_clusters, const int *labels, unsigned int n, unsigned int *members)
+{
+    unsigned int first = 0;
+
+    for (int k = 0; k < num_clusters; k++) {
+        c[k].first = first;
+        first += c[k].count;
+        if (c[k].count == 0)
+            continue;
+        c[k].z_sum = c[k].centroid[2];
+        for (int d = 0; d < 3; d++)
+            c[k].centroid[d] /= c[k].count;
+        c[k].doppler_mean /= c[k].count;
+    }
+    if (members == NULL)
+        return;
+    // first is the next free slot while placing, then moved back to the start
+    for (unsigned int i = 0; i < n; i++)
+        if (labels[i] >= 0 && labels[i] < num_clusters)
+            members[c[labels[i]].first++] = i;
+    for (int k = 0; k < num_clusters; k++)
+        c[k].first -= c[k].count;
+}
+
+void cluster_stats_build(cluster_stats_t *c, int num_clusters, const float *pos, int stride, unsigned int n,
+                         const int *labels, int doppler_col, unsigned int *members)
+{
+    cluster_stats_begin(c, num_clusters);
+    for (unsigned int i = 0; i < n; i++)
+        cluster_stats_add(c, num_clusters, labels[i], pos + (size_t) i * stride, doppler_col);
+    cluster_stats_end(c, num_clusters, labels, n, members);
+}
+
+int cluster_stats_largest(const cluster_stats_t *c, int num_clusters)
+{
+    int best = -1;
+
+    for (int k = 0; k < num_clusters; k++)
+        if (best < 0 || c[k].count >= c[best].count)
+            best = k;
+    return best;
+}
+
+int cluster_range_bins(const float *pos, int stride, unsigned int n, int range_col, int *labels)
+{
+    int num_labels = 0;
+
+    for (unsigned int i = 0; i < n; i++) {
+        float r = pos[(size_t) i * stride + range_col];
+        // written so that a NaN fails it
+        if (!(r >= 0 && r < CLUSTER_RANGE_BINS_MAX)) {
+            labels[i] = -1;
+            continue;
+        }
+        labels[i] = (int) r;
+        if (labels[i] >= num_labels)
+            num_labels = labels[i] + 1;
+    }
+    return num_labels;
+}
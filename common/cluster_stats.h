@@ -0,0 +1,80 @@
+#ifndef CLUSTER_STATS_H
+#define CLUSTER_STATS_H
+
+/*
+Per-cluster aggregates of a labelled point cloud (DBSCAN or radar tracker labels).
+Points are rows of floats [x, y, z, ...]; a label below 0 is noise. Sums, bounds and
+counts are gathered in one pass over the points, so a main reads the largest
+cluster, centroids and heights off the clusters instead of rescanning the points
+once per label. With a members buffer the point indices are also grouped by
+cluster (counting sort), the members of cluster k being
+members[c[k].first .. c[k].first + c[k].count).
+*/
+
+typedef struct {
+    unsigned int count;         // member points, 0 for a label nobody carries
+    unsigned int first;         // start of the members in the members buffer
+    float centroid[3];          // mean x, y, z, 0 when count is 0
+    float min[3];               // bounding box
+    float max[3];
+    float z_sum;
+    float doppler_mean;         // 0 without a doppler column
+} cluster_stats_t;
+
+/*
+Start aggregating labels 0 .. num_clusters - 1.
+c = room for num_clusters
+*/
+void cluster_stats_begin(cluster_stats_t *c, int num_clusters);
+
+// Add point p with label to its cluster, labels outside 0 .. num_clusters - 1 are ignored.
+static inline void cluster_stats_add(cluster_stats_t *c, int num_clusters, int label, const float *p, int doppler_col)
+{
+    if (label < 0 || label >= num_clusters)
+        return;
+    cluster_stats_t *k = &c[label];
+    for (int d = 0; d < 3; d++) {
+        k->centroid[d] += p[d];
+        if (k->count == 0 || p[d] < k->min[d])
+            k->min[d] = p[d];
+        if (k->count == 0 || p[d] > k->max[d])
+            k->max[d] = p[d];
+    }
+    if (doppler_col >= 0)
+        k->doppler_mean += p[doppler_col];
+    k->count++;
+}
+
+/*
+Turn the sums into means and lay out the member ranges.
+labels, n = labels of the points added, by point index
+members = room for n point indices, NULL to skip grouping
+*/
+void cluster_stats_end(cluster_stats_t *c, int num_clusters, const int *labels, unsigned int n, unsigned int *members);
+
+/*
+All of the above for labels computed elsewhere (radar tracker).
+pos = n rows of stride floats, x y z first
+doppler_col = column of the doppler in a row, -1 if none
+*/
+void cluster_stats_build(cluster_stats_t *c, int num_clusters, const float *pos, int stride, unsigned int n,
+                         const int *labels, int doppler_col, unsigned int *members);
+
+// Label of the cluster with the most points, the last one on a tie, -1 if there is none.
+int cluster_stats_largest(const cluster_stats_t *c, int num_clusters);
+
+#define CLUSTER_RANGE_BINS_MAX 64   // 1 m bins, farther points are noise
+
+/*
+Labels of the original dbscan_output() path, the mains' default without --dbscan and for comparing
+against DBSCAN (tools/bench_cluster): it seeded every point's cluster id with its
+range, so no point was unclassified, DBSCAN never ran, and each point kept its 1 m
+range bin as its cluster.
+pos = n rows of stride floats, range_col = column of the range
+labels = output, the range truncated to an int, -1 for a negative, non-finite or
+         too far range
+return = number of labels, the largest bin + 1, 0 if every point is noise
+*/
+int cluster_range_bins(const float *pos, int stride, unsigned int n, int range_col, int *labels);
+
+#endif // CLUSTER_STATS_H
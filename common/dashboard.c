@@ -0,0 +1,190 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dashboard.h"
+#include "mono_clock.h"
+
+// Changed rows into d->out, under lock; returns the bytes to write.
+static size_t render(dashboard_t *d)
+{
+    size_t n = 0;
+
+    if (!d->cleared) {
+        n += (size_t) snprintf(d->out + n, sizeof(d->out) - n, "\033[H\033[2J");
+        d->cleared = 1;
+    }
+    for (int row = 0; row < d->height; row++) {
+        if (strcmp(d->want[row], d->shown[row]) == 0)
+            continue;
+        n += (size_t) snprintf(d->out + n, sizeof(d->out) - n, "\033[%d;1H%s\033[K", row + 1, d->want[row]);
+        memcpy(d->shown[row], d->want[row], DASHBOARD_COLS);
+    }
+    if (n > 0)
+        n += (size_t) snprintf(d->out + n, sizeof(d->out) - n, "\033[%d;1H", d->height + 1);
+    return n;
+}
+
+static void *display_thread(void *arg)
+{
+    dashboard_t *d = arg;
+
+    pthread_mutex_lock(&d->lock);
+    while (!d->stop) {
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_nsec += (long) d->interval_ns;
+        while (until.tv_nsec >= 1000000000L) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&d->wake, &d->lock, &until);
+        size_t n = render(d);
+        // out is only touched by this thread, the rows can change meanwhile
+        pthread_mutex_unlock(&d->lock);
+        if (n > 0) {
+            fwrite(d->out, 1, n, stdout);
+            fflush(stdout);
+        }
+        pthread_mutex_lock(&d->lock);
+    }
+    pthread_mutex_unlock(&d->lock);
+    return NULL;
+}
+
+int dashboard_init(dashboard_t *d, int argc, char *argv[], int passthrough)
+{
+    int headless = 0;
+    double hz = 10;
+
+    memset(d, 0, sizeof(*d));
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0)
+            headless = 1;
+        else if (strcmp(argv[i], "--display-hz") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0)
+            hz = atof(argv[++i]);
+    }
+    d->interval_ns = (uint64_t) (1e9 / hz);
+    if (headless)
+        return 0;
+    if (passthrough) {
+        d->passthrough = 1;
+        return 0;
+    }
+    pthread_mutex_init(&d->lock, NULL);
+    pthread_cond_init(&d->wake, NULL);
+    if (pthread_create(&d->thread, NULL, display_thread, d) != 0) {
+        printf("Error starting display thread\n");
+        pthread_mutex_destroy(&d->lock);
+        pthread_cond_destroy(&d->wake);
+        return -1;
+    }
+    d->enabled = 1;
+    return 0;
+}
+
+void dashboard_region_init(dashboard_region_t *r, dashboard_t *d, int first, int rows)
+{
+    if (first < 0)
+        first = 0;
+    if (first > DASHBOARD_ROWS)
+        first = DASHBOARD_ROWS;
+    if (rows > DASHBOARD_ROWS - first)
+        rows = DASHBOARD_ROWS - first;
+    r->screen = d;
+    r->first = first;
+    r->rows = rows;
+    r->row = 0;
+    r->drawing = 0;
+    r->last_ns = 0;
+}
+
+int dashboard_begin(dashboard_region_t *r)
+{
+    dashboard_t *d = r->screen;
+
+    r->row = 0;
+    r->drawing = 0;
+    if (d->passthrough) {
+        r->drawing = 1;
+        return 1;
+    }
+    if (!d->enabled)
+        return 0;
+    uint64_t now = mono_ns();
+    if (r->last_ns != 0 && now - r->last_ns < d->interval_ns)
+        return 0;
+    r->last_ns = now;
+    r->drawing = 1;
+    return 1;
+}
+
+void dashboard_printf(dashboard_region_t *r, const char *fmt, ...)
+{
+    dashboard_t *d = r->screen;
+    char text[DASHBOARD_COLS * 4];
+    va_list ap;
+
+    if (!r->drawing)
+        return;
+    va_start(ap, fmt);
+    if (d->passthrough) {
+        vprintf(fmt, ap);
+        va_end(ap);
+        return;
+    }
+    vsnprintf(text, sizeof(text), fmt, ap);
+    va_end(ap);
+    pthread_mutex_lock(&d->lock);
+    for (char *line = text; *line != '\0' && r->row < r->rows;) {
+        char *nl = strchr(line, '\n');
+        size_t len = nl != NULL ? (size_t) (nl - line) : strlen(line);
+        size_t keep = len < DASHBOARD_COLS - 1 ? len : DASHBOARD_COLS - 1;
+        // do not cut a UTF-8 character in two
+        while (keep < len && keep > 0 && ((unsigned char) line[keep] & 0xC0) == 0x80)
+            keep--;
+        int row = r->first + r->row++;
+        memcpy(d->want[row], line, keep);
+        d->want[row][keep] = '\0';
+        if (row + 1 > d->height)
+            d->height = row + 1;
+        if (nl == NULL)
+            break;
+        line = nl + 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+}
+
+void dashboard_end(dashboard_region_t *r)
+{
+    dashboard_t *d = r->screen;
+
+    if (!r->drawing)
+        return;
+    r->drawing = 0;
+    if (!d->enabled)
+        return;
+    pthread_mutex_lock(&d->lock);
+    for (int row = r->first + r->row; row < r->first + r->rows && row < d->height; row++)
+        d->want[row][0] = '\0';
+    pthread_mutex_unlock(&d->lock);
+}
+
+void dashboard_close(dashboard_t *d)
+{
+    if (!d->enabled)
+        return;
+    pthread_mutex_lock(&d->lock);
+    d->stop = 1;
+    pthread_cond_signal(&d->wake);
+    pthread_mutex_unlock(&d->lock);
+    pthread_join(d->thread, NULL);
+    size_t n = render(d);
+    fwrite(d->out, 1, n, stdout);
+    fflush(stdout);
+    pthread_mutex_destroy(&d->lock);
+    pthread_cond_destroy(&d->wake);
+    d->enabled = 0;
+}
@@ -0,0 +1,73 @@
+#ifndef DASHBOARD_H
+#define DASHBOARD_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+/*
+Terminal display redrawn in place instead of system("clear") per result.
+The screen is a fixed grid of text rows; each pipeline owns a region of it
+(one per sensor in the hub) and fills its rows between dashboard_begin() and
+dashboard_end(). A display thread compares the rows with what is on the terminal
+and rewrites only the rows that changed, with ANSI cursor positioning, at most
+--display-hz times a second (default 10). Regions are refreshed at the same rate,
+so a frame that is not due costs one clock read and formats nothing; terminal
+writes never run on the frame path.
+--headless turns the display off: nothing is printed and nothing formatted.
+In passthrough mode (debug output) lines are printed as they come, as before.
+*/
+
+#define DASHBOARD_ROWS 80
+#define DASHBOARD_COLS 160          // bytes per row, longer rows are cut
+
+typedef struct {
+    int enabled;                    // drawing to the terminal
+    int passthrough;                // printing lines as they come instead
+    uint64_t interval_ns;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;            // stop
+    int stop;
+    int height;                     // rows used so far
+    int cleared;                    // screen cleared before the first draw
+    char want[DASHBOARD_ROWS][DASHBOARD_COLS];
+    char shown[DASHBOARD_ROWS][DASHBOARD_COLS];
+    char out[DASHBOARD_ROWS * (DASHBOARD_COLS + 16) + 32];
+} dashboard_t;
+
+typedef struct {
+    dashboard_t *screen;
+    int first;                      // first row of the region
+    int rows;
+    int row;                        // next row of this refresh
+    int drawing;                    // between a dashboard_begin() that returned 1 and dashboard_end()
+    uint64_t last_ns;               // last refresh
+} dashboard_region_t;
+
+/*
+Read --headless and --display-hz N, start the display thread.
+passthrough = print lines as they come (debug mode) unless headless
+return = 0, -1 if the thread cannot be started (printed, the display is off)
+*/
+int dashboard_init(dashboard_t *d, int argc, char *argv[], int passthrough);
+
+// A region of rows first .. first + rows - 1.
+void dashboard_region_init(dashboard_region_t *r, dashboard_t *d, int first, int rows);
+
+/*
+Start refreshing a region.
+return = 1 if the lines of this refresh should be produced, 0 if it is not due
+or the display is off (dashboard_printf() would drop them)
+*/
+int dashboard_begin(dashboard_region_t *r);
+
+// Next row(s) of the region, a '\n' in the text starts another row.
+void dashboard_printf(dashboard_region_t *r, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// Blank the rows not written this refresh and hand the region to the display thread.
+void dashboard_end(dashboard_region_t *r);
+
+// Draw what is pending, stop the thread and leave the cursor below the display.
+void dashboard_close(dashboard_t *d);
+
+#endif // DASHBOARD_H
@@ -0,0 +1,500 @@
+/* Copyright 2015 Gagarine Yaikhom (MIT License) */
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dbscan.h"
+#include "dbscan_arena.h"
+#include "dbscan_kernel.h"
+#include "grid_index.h"
+#include "task_pool.h"
+
+#define CORE_POINT 1
+#define NOT_CORE_POINT 0
+
+#define SUCCESS 0
+#define FAILURE -3
+
+#define DBSCAN_PARALLEL_CHUNK 16        // points a thread takes at a time
+
+typedef struct epsilon_neighbours_s epsilon_neighbours_t;
+struct epsilon_neighbours_s {
+    unsigned int num_members;
+    unsigned int *members;      /* slice of the arena, room for every point */
+};
+
+/*
+Per-thread clustering state (radar hub workers cluster in parallel).
+dbscan() resets the arena once per call and slices it into the seed list, the
+neighbour list of spread() and the grid candidates, so no list node is ever
+allocated and, once the largest cloud has been seen, nothing at all.
+*/
+static __thread dbscan_arena_t dbscan_arena;
+static __thread unsigned int *dbscan_seed_buf;
+static __thread unsigned int *dbscan_spread_buf;
+static __thread unsigned int *dbscan_candidates;
+static __thread grid_index_t dbscan_grid;
+static __thread point_t *dbscan_grid_points;
+static __thread dbscan_soa_t dbscan_soa;     /* float copy in grid order, dist == NULL only */
+static __thread float dbscan_eps2;
+static __thread point_t *dbscan_work;       /* dbscan_labels() input, grows to the largest cloud */
+static __thread unsigned int *dbscan_work_index;
+static __thread unsigned int dbscan_work_cap;
+
+static int get_epsilon_neighbours(
+    unsigned int index,
+    point_t *points,
+    unsigned int num_points,
+    double epsilon,
+    double (*dist)(point_t *a, point_t *b),
+    epsilon_neighbours_t *en);
+static int expand(
+    unsigned int index,
+    unsigned int cluster_id,
+    point_t *points,
+    unsigned int num_points,
+    double epsilon,
+    unsigned int minpts,
+    double (*dist)(point_t *a, point_t *b));
+static int spread(
+    unsigned int index,
+    epsilon_neighbours_t *seeds,
+    unsigned int cluster_id,
+    point_t *points,
+    unsigned int num_points,
+    double epsilon,
+    unsigned int minpts,
+    double (*dist)(point_t *a, point_t *b));
+
+/*
+Neighbours of points[index] with the compiled-in metric: squared distance over
+whole runs of the float copy s in grid order, z left out on a 2D grid. Only reads g and s, so the threads
+of dbscan_parallel() query at the same time.
+return = number of neighbours written to out
+*/
+static unsigned int euclidean_neighbours(
+    const grid_index_t *g,
+    const dbscan_soa_t *s,
+    point_t *points,
+    unsigned int index,
+    double epsilon,
+    float eps2,
+    unsigned int *out)
+{
+    unsigned int ranges[GRID_INDEX_MAX_RANGES][2];
+    unsigned int count = 0;
+    point_t *q = &points[index];
+    unsigned int nranges = grid_index_ranges(g, q->x, q->y, q->z, ranges);
+    for (unsigned int r = 0; r < nranges; ++r) {
+        if (g->dims == 3)
+            count = dbscan_within_3d(s, ranges[r][0], ranges[r][1],
+                (float) q->x, (float) q->y, (float) q->z, eps2, index, out, count);
+        else
+            count = dbscan_within_2d(s, ranges[r][0], ranges[r][1],
+                (float) q->x, (float) q->y, (float) q->z, eps2, index, out, count);
+    }
+    /* non-finite points are not in the copy */
+    for (unsigned int k = 0; k < g->nwild; ++k) {
+        unsigned int i = g->wild[k];
+        if (i == index)
+            continue;
+        if (euclidean_dist(q, &points[i]) > epsilon)
+            continue;
+        out[count++] = i;
+    }
+    return count;
+}
+
+static int get_epsilon_neighbours(
+    unsigned int index,
+    point_t *points,
+    unsigned int num_points,
+    double epsilon,
+    double (*dist)(point_t *a, point_t *b),
+    epsilon_neighbours_t *en)
+{
+    en->num_members = 0;
+    if (dist == NULL) {
+        en->num_members = euclidean_neighbours(&dbscan_grid, &dbscan_soa, points, index,
+                                               epsilon, dbscan_eps2, en->members);
+        return SUCCESS;
+    }
+    if (points != dbscan_grid_points || num_points != dbscan_grid.num_points) {
+        for (unsigned int i = 0; i < num_points; ++i) {
+            if (i == index)
+                continue;
+            if (dist(&points[index], &points[i]) > epsilon)
+                continue;
+            en->members[en->num_members++] = i;
+        }
+        return SUCCESS;
+    }
+    /* only the cells around the point can hold neighbours */
+    unsigned int num_candidates = grid_index_query(&dbscan_grid,
+        points[index].x, points[index].y, points[index].z, dbscan_candidates);
+    for (unsigned int k = 0; k < num_candidates; ++k) {
+        unsigned int i = dbscan_candidates[k];
+        if (i == index)
+            continue;
+        if (dist(&points[index], &points[i]) > epsilon)
+            continue;
+        en->members[en->num_members++] = i;
+    }
+    return SUCCESS;
+}
+
+unsigned int dbscan(
+    point_t *points,
+    unsigned int num_points,
+    double epsilon,
+    unsigned int minpts,
+    int dims,
+    double (*dist)(point_t *a, point_t *b))
+{
+    unsigned int i, cluster_id = 0;
+    /* a point enters the seed list at most once, so every slice needs num_points */
+    if (dbscan_arena_reset(&dbscan_arena, 3 * (size_t) num_points) != 0)
+        return 0;
+    dbscan_seed_buf = dbscan_arena_alloc(&dbscan_arena, num_points);
+    dbscan_spread_buf = dbscan_arena_alloc(&dbscan_arena, num_points);
+    dbscan_candidates = dbscan_arena_alloc(&dbscan_arena, num_points);
+    /* cell edge = epsilon, without the grid get_epsilon_neighbours falls back to a full scan */
+    dbscan_grid_points = NULL;
+    if (grid_index_build(&dbscan_grid, &points[0].x, sizeof(point_t), num_points, epsilon, dims) == 0)
+        dbscan_grid_points = points;
+    if (dist == NULL) {
+        dbscan_eps2 = (float) (epsilon * epsilon);
+        if (dbscan_grid_points == NULL ||
+            dbscan_soa_fill(&dbscan_soa, &dbscan_grid, &points[0].x, sizeof(point_t)) != 0)
+            dist = euclidean_dist;
+    }
+    for (i = 0; i < num_points; ++i) {
+        if (points[i].cluster_id == UNCLASSIFIED) {
+            if (expand(i, cluster_id, points,
+                       num_points, epsilon, minpts,
+                       dist) == CORE_POINT)
+                ++cluster_id;
+        }
+    }
+    dbscan_grid_points = NULL;
+    return cluster_id;
+}
+
+unsigned int dbscan_euclidean(
+    point_t *points,
+    unsigned int num_points,
+    double epsilon,
+    unsigned int minpts,
+    int dims)
+{
+    return dbscan(points, num_points, epsilon, minpts, dims, NULL);
+}
+
+/*
+Parallel dbscan_euclidean(), the same labels and cluster ids, on the threads of
+dbscan_pool (--dbscan-threads). Each step splits the points over the threads:
+1. core points: at least minpts neighbours
+2. neighbouring core points are merged in a lock-free union-find; a root is only
+   ever linked below a smaller index, so a cluster's root is its lowest core
+   point, the one the serial loop starts that cluster from
+3. (caller) clusters are numbered by root in point order, like the serial loop
+4. a border point takes the last cluster whose root is its neighbour (serial
+   expand() relabels every neighbour of the root), otherwise the first cluster
+   with a core neighbour (the first spread() that reached it), else NOISE
+*/
+typedef struct {
+    point_t *points;
+    unsigned int num_points;
+    unsigned int minpts;
+    double epsilon;
+    float eps2;
+    const grid_index_t *grid;
+    const dbscan_soa_t *soa;
+    unsigned int *parent;       /* union-find over point indices */
+    unsigned int *core;         /* 1 for core points */
+    unsigned int *cluster;      /* id of each root */
+    unsigned int *scratch;      /* room for num_points neighbours per thread */
+    unsigned int next;          /* first point of the next chunk */
+    int step;
+} dbscan_job_t;
+
+static task_pool_t dbscan_pool;
+
+int dbscan_set_threads(int threads)
+{
+    if (dbscan_pool.nthreads > 0)
+        task_pool_free(&dbscan_pool);
+    dbscan_pool.nthreads = 0;
+    if (threads < 2)
+        return 0;
+    if (task_pool_init(&dbscan_pool, threads) != 0) {
+        dbscan_pool.nthreads = 0;
+        return -1;
+    }
+    return 0;
+}
+
+static unsigned int uf_find(unsigned int *parent, unsigned int x)
+{
+    for (;;) {
+        unsigned int p = __atomic_load_n(&parent[x], __ATOMIC_RELAXED);
+        if (p == x)
+            return x;
+        /* path halving, a failed CAS only means someone else shortened it */
+        unsigned int gp = __atomic_load_n(&parent[p], __ATOMIC_RELAXED);
+        if (gp != p)
+            __atomic_compare_exchange_n(&parent[x], &p, gp, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        x = gp;
+    }
+}
+
+static void uf_union(unsigned int *parent, unsigned int a, unsigned int b)
+{
+    for (;;) {
+        a = uf_find(parent, a);
+        b = uf_find(parent, b);
+        if (a == b)
+            return;
+        if (a < b) {
+            unsigned int t = a;
+            a = b;
+            b = t;
+        }
+        /* a is a root unless another thread linked it meanwhile, then retry */
+        unsigned int expected = a;
+        if (__atomic_compare_exchange_n(&parent[a], &expected, b, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            return;
+    }
+}
+
+static void dbscan_parallel_step(void *arg, int thread, int nthreads)
+{
+    dbscan_job_t *job = (dbscan_job_t *) arg;
+    unsigned int *out = job->scratch + (size_t) thread * job->num_points;
+    unsigned int begin;
+    (void) nthreads;
+
+    while ((begin = __atomic_fetch_add(&job->next, DBSCAN_PARALLEL_CHUNK, __ATOMIC_RELAXED)) < job->num_points) {
+        unsigned int end = begin + DBSCAN_PARALLEL_CHUNK < job->num_points ? begin + DBSCAN_PARALLEL_CHUNK : job->num_points;
+        for (unsigned int i = begin; i < end; ++i) {
+            if (job->step == 0) {
+                unsigned int n = euclidean_neighbours(job->grid, job->soa, job->points, i,
+                                                      job->epsilon, job->eps2, out);
+                job->core[i] = n >= job->minpts;
+                job->parent[i] = i;
+            } else if (job->step == 1) {
+                if (!job->core[i])
+                    continue;
+                unsigned int n = euclidean_neighbours(job->grid, job->soa, job->points, i,
+                                                      job->epsilon, job->eps2, out);
+                for (unsigned int k = 0; k < n; ++k)
+                    if (out[k] < i && job->core[out[k]])
+                        uf_union(job->parent, i, out[k]);
+            } else if (job->core[i]) {
+                job->points[i].cluster_id = (int) job->cluster[uf_find(job->parent, i)];
+            } else {
+                int first = -1, last = -1;
+                unsigned int n = euclidean_neighbours(job->grid, job->soa, job->points, i,
+                                                      job->epsilon, job->eps2, out);
+                for (unsigned int k = 0; k < n; ++k) {
+                    unsigned int j = out[k];
+                    if (!job->core[j])
+                        continue;
+                    unsigned int r = uf_find(job->parent, j);
+                    int id = (int) job->cluster[r];
+                    if (first < 0 || id < first)
+                        first = id;
+                    if (r == j && id > last)
+                        last = id;
+                }
+                job->points[i].cluster_id = last >= 0 ? last : first >= 0 ? first : NOISE;
+            }
+        }
+    }
+}
+
+/* run one step on the pool, or alone when another thread holds the pool */
+static void dbscan_parallel_run(dbscan_job_t *job, int step)
+{
+    job->step = step;
+    job->next = 0;
+    if (task_pool_run(&dbscan_pool, dbscan_parallel_step, job) != 0)
+        dbscan_parallel_step(job, 0, 1);
+}
+
+unsigned int dbscan_parallel(
+    point_t *points,
+    unsigned int num_points,
+    double epsilon,
+    unsigned int minpts,
+    int dims)
+{
+    dbscan_job_t job;
+    unsigned int i, num_clusters = 0;
+    int nthreads = dbscan_pool.nthreads;
+
+    if (nthreads < 2)
+        return dbscan_euclidean(points, num_points, epsilon, minpts, dims);
+    if (dbscan_arena_reset(&dbscan_arena, (3 + (size_t) nthreads) * num_points) != 0)
+        return 0;
+    if (grid_index_build(&dbscan_grid, &points[0].x, sizeof(point_t), num_points, epsilon, dims) != 0 ||
+        dbscan_soa_fill(&dbscan_soa, &dbscan_grid, &points[0].x, sizeof(point_t)) != 0)
+        return dbscan_euclidean(points, num_points, epsilon, minpts, dims);
+    job.points = points;
+    job.num_points = num_points;
+    job.minpts = minpts;
+    job.epsilon = epsilon;
+    job.eps2 = (float) (epsilon * epsilon);
+    job.grid = &dbscan_grid;
+    job.soa = &dbscan_soa;
+    job.parent = dbscan_arena_alloc(&dbscan_arena, num_points);
+    job.core = dbscan_arena_alloc(&dbscan_arena, num_points);
+    job.cluster = dbscan_arena_alloc(&dbscan_arena, num_points);
+    job.scratch = dbscan_arena_alloc(&dbscan_arena, (size_t) nthreads * num_points);
+
+    dbscan_parallel_run(&job, 0);
+    dbscan_parallel_run(&job, 1);
+    for (i = 0; i < num_points; ++i)
+        if (job.core[i] && job.parent[i] == i)
+            job.cluster[i] = num_clusters++;
+    dbscan_parallel_run(&job, 2);
+    return num_clusters;
+}
+
+static int expand(
+    unsigned int index,
+    unsigned int cluster_id,
+    point_t *points,
+    unsigned int num_points,
+    double epsilon,
+    unsigned int minpts,
+    double (*dist)(point_t *a, point_t *b))
+{
+    epsilon_neighbours_t seeds = { 0, dbscan_seed_buf };
+    get_epsilon_neighbours(index, points, num_points, epsilon, dist, &seeds);
+
+    if (seeds.num_members < minpts) {
+        points[index].cluster_id = NOISE;
+        return NOT_CORE_POINT;
+    }
+    points[index].cluster_id = cluster_id;
+    for (unsigned int k = 0; k < seeds.num_members; ++k)
+        points[seeds.members[k]].cluster_id = cluster_id;
+
+    /* spread() appends to seeds, the loop also visits what it adds */
+    for (unsigned int k = 0; k < seeds.num_members; ++k)
+        spread(seeds.members[k], &seeds, cluster_id, points,
+               num_points, epsilon, minpts, dist);
+    return CORE_POINT;
+}
+
+static int spread(
+    unsigned int index,
+    epsilon_neighbours_t *seeds,
+    unsigned int cluster_id,
+    point_t *points,
+    unsigned int num_points,
+    double epsilon,
+    unsigned int minpts,
+    double (*dist)(point_t *a, point_t *b))
+{
+    epsilon_neighbours_t spread = { 0, dbscan_spread_buf };
+    get_epsilon_neighbours(index, points, num_points, epsilon, dist, &spread);
+    if (spread.num_members >= minpts) {
+        for (unsigned int k = 0; k < spread.num_members; ++k) {
+            point_t *d = &points[spread.members[k]];
+            if (d->cluster_id == NOISE ||
+                d->cluster_id == UNCLASSIFIED) {
+                if (d->cluster_id == UNCLASSIFIED)
+                    seeds->members[seeds->num_members++] = spread.members[k];
+                d->cluster_id = cluster_id;
+            }
+        }
+    }
+    return SUCCESS;
+}
+
+double euclidean_dist(point_t *a, point_t *b)
+{
+    double dx = a->x - b->x, dy = a->y - b->y, dz = a->z - b->z;
+    return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+void print_points(point_t *points, unsigned int num_points)
+{
+    unsigned int i = 0;
+    
+    printf("Number of points: %u\n"
+        " x     y     z     cluster_id\n"
+        "-----------------------------\n"
+        , num_points);
+        
+    while (i < num_points) {
+          printf("%5.2lf %5.2lf %5.2lf: %d\n", points[i].x, points[i].y, points[i].z, points[i].cluster_id);
+          ++i;
+    }
+}
+
+int dbscan_cluster(
+    const float *pos,
+    int stride,
+    unsigned int num_points,
+    double epsilon,
+    unsigned int minpts,
+    int dims,
+    int *labels,
+    float *xyz,
+    cluster_stats_t *stats,
+    int doppler_col,
+    unsigned int *members)
+{
+    unsigned int i, n = 0;
+    int num_clusters = 0;
+    if (num_points > dbscan_work_cap) {
+        point_t *w = (point_t *) realloc(dbscan_work, num_points * sizeof(point_t));
+        if (w == NULL) {
+            printf("Error allocating the DBSCAN points\n");
+            return -1;
+        }
+        dbscan_work = w;
+        unsigned int *wi = (unsigned int *) realloc(dbscan_work_index, num_points * sizeof(unsigned int));
+        if (wi == NULL) {
+            printf("Error allocating the DBSCAN points\n");
+            return -1;
+        }
+        dbscan_work_index = wi;
+        dbscan_work_cap = num_points;
+    }
+    for (i = 0; i < num_points; ++i) {
+        const float *p = pos + (size_t) i * stride;
+        labels[i] = NOISE;
+        if (xyz != NULL) {
+            xyz[3 * i] = p[0];
+            xyz[3 * i + 1] = p[1];
+            xyz[3 * i + 2] = p[2];
+        }
+        if (!isfinite(p[0]) || !isfinite(p[1]) || !isfinite(p[2]))
+            continue;
+        dbscan_work[n].x = p[0];
+        dbscan_work[n].y = p[1];
+        dbscan_work[n].z = p[2];
+        dbscan_work[n].cluster_id = UNCLASSIFIED;
+        dbscan_work_index[n++] = i;
+    }
+    if (n >= DBSCAN_PARALLEL_MIN_POINTS)
+        num_clusters = (int) dbscan_parallel(dbscan_work, n, epsilon, minpts, dims);
+    else if (n > 0)
+        num_clusters = (int) dbscan_euclidean(dbscan_work, n, epsilon, minpts, dims);
+    if (stats != NULL)
+        cluster_stats_begin(stats, num_clusters);
+    for (i = 0; i < n; ++i) {
+        unsigned int k = dbscan_work_index[i];
+        labels[k] = dbscan_work[i].cluster_id;
+        if (stats != NULL)
+            cluster_stats_add(stats, num_clusters, labels[k], pos + (size_t) k * stride, doppler_col);
+    }
+    if (stats != NULL)
+        cluster_stats_end(stats, num_clusters, labels, num_points, members);
+    return num_clusters;
+}
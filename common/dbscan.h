@@ -0,0 +1,100 @@
+#ifndef DBSCAN_H
+#define DBSCAN_H
+
+#include "cluster_stats.h"
+
+/*
+DBSCAN of people and animal (Gagarine Yaikhom's, MIT License), shared by both.
+Each program keeps only its parameters in its own dbscan file (epsilon, minpts and
+the grid dims: 3 for people, 2 for animal whose z is always 0) and passes them in.
+Neighbour queries go through a voxel grid (grid_index) and, for the euclidean
+metric, the float kernel of dbscan_kernel.h; the lists live in a per-thread arena,
+so the radar hub's workers cluster at the same time and, once the largest cloud has
+been seen, without allocating. Clouds of DBSCAN_PARALLEL_MIN_POINTS or more can be
+clustered on a thread pool (dbscan_set_threads) with the same labels.
+*/
+
+#define UNCLASSIFIED -1
+#define NOISE -2
+
+#define DBSCAN_PARALLEL_MIN_POINTS 256  // smaller clouds are clustered serially, see tools/bench_dbscan
+
+typedef struct point_s point_t;
+struct point_s {
+    double x, y, z;
+    int cluster_id;
+};
+
+/*
+Cluster points whose cluster_id is UNCLASSIFIED, the others are left as they are.
+dims = 3, or 2 for a grid that ignores z
+dist = metric, NULL for the compiled-in euclidean kernel (see dbscan_euclidean)
+return = number of clusters, ids 0 .. return - 1, NOISE for points in no cluster
+*/
+unsigned int dbscan(
+    point_t *points,
+    unsigned int num_points,
+    double epsilon,
+    unsigned int minpts,
+    int dims,
+    double (*dist)(point_t *a, point_t *b));
+
+/*
+dbscan() with the euclidean metric compiled in (dbscan_within_2d / 3d), the same
+labels as dbscan(..., euclidean_dist) up to float rounding at exactly epsilon.
+*/
+unsigned int dbscan_euclidean(
+    point_t *points,
+    unsigned int num_points,
+    double epsilon,
+    unsigned int minpts,
+    int dims);
+
+/*
+Threads dbscan_parallel() and dbscan_cluster() may use, caller included; 1 is the
+serial dbscan_euclidean(). Call before clustering starts.
+return = 0, -1 if the threads cannot be started (stays serial)
+*/
+int dbscan_set_threads(int threads);
+
+// dbscan_euclidean() on the dbscan_set_threads() threads, the same labels and cluster ids.
+unsigned int dbscan_parallel(
+    point_t *points,
+    unsigned int num_points,
+    double epsilon,
+    unsigned int minpts,
+    int dims);
+
+/*
+Cluster the points of a frame, on the dbscan_set_threads() threads when there are
+DBSCAN_PARALLEL_MIN_POINTS or more.
+Nothing is capped or copied out beyond what the caller asks for: the buffers are
+the caller's, sized for its own num_points. Points with a non-finite coordinate
+are not clustered (a NaN would be a neighbour of every point) and get NOISE.
+The cluster aggregates are gathered while the labels are written back.
+pos = rows of stride floats starting with x, y, z
+labels = num_points cluster ids 0 .. return - 1, NOISE for points in no cluster
+xyz = num_points rows of x, y, z as clustered, NULL when the caller has them already
+stats = room for num_points clusters (the most there can be), NULL to skip
+doppler_col = column of the doppler in a row for stats, -1 if none
+members = room for num_points indices grouped by cluster (see cluster_stats.h), NULL to skip
+return = number of clusters, -1 if the work buffer cannot grow (printed)
+*/
+int dbscan_cluster(
+    const float *pos,
+    int stride,
+    unsigned int num_points,
+    double epsilon,
+    unsigned int minpts,
+    int dims,
+    int *labels,
+    float *xyz,
+    cluster_stats_t *stats,
+    int doppler_col,
+    unsigned int *members);
+
+double euclidean_dist(point_t *a, point_t *b);
+
+void print_points(point_t *points, unsigned int num_points);
+
+#endif // DBSCAN_H
@@ -0,0 +1,59 @@
+#ifndef DBSCAN_ARENA_H
+#define DBSCAN_ARENA_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+Bump allocator of point indices for DBSCAN.
+Reserved once per clustering call for the worst case of that cloud and handed out
+in slices (seed list, neighbour list, grid candidates); everything is released
+together by the next reset. The buffer only grows, so once the largest cloud has
+been seen clustering does no heap allocation at all.
+*/
+
+typedef struct {
+    unsigned int *buf;
+    size_t cap;     // indices allocated
+    size_t used;    // indices handed out since the last reset
+} dbscan_arena_t;
+
+/*
+Drop every slice and make room for n indices.
+return = 0, -1 if the buffer cannot grow (printed)
+*/
+static inline int dbscan_arena_reset(dbscan_arena_t *a, size_t n)
+{
+    a->used = 0;
+    if (n <= a->cap)
+        return 0;
+    unsigned int *p = (unsigned int *) realloc(a->buf, n * sizeof(*p));
+    if (p == NULL) {
+        printf("Error allocating the DBSCAN arena\n");
+        return -1;
+    }
+    a->buf = p;
+    a->cap = n;
+    return 0;
+}
+
+// n indices from the reserved room, NULL if the reset reserved less
+static inline unsigned int *dbscan_arena_alloc(dbscan_arena_t *a, size_t n)
+{
+    if (a->used + n > a->cap)
+        return NULL;
+    unsigned int *p = a->buf + a->used;
+    a->used += n;
+    return p;
+}
+
+static inline void dbscan_arena_free(dbscan_arena_t *a)
+{
+    free(a->buf);
+    a->buf = NULL;
+    a->cap = 0;
+    a->used = 0;
+}
+
+#endif // DBSCAN_ARENA_H
@@ -0,0 +1,140 @@
+#ifndef DBSCAN_KERNEL_H
+#define DBSCAN_KERNEL_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "grid_index.h"
+
+/*
+Euclidean range query of DBSCAN with the metric fixed at compile time.
+The coordinates are copied once per clustering call into float arrays (structure
+of arrays) in the grid's bucket order, so the points of one cell are contiguous and
+a query tests a whole bucket range 8 points at a time with GCC vector extensions
+(SSE or AVX, whatever the target has). Distances are compared squared against
+epsilon squared, no sqrt, no call per pair. dbscan_within_2d ignores z (animal),
+dbscan_within_3d does not (people).
+A pair is a neighbour unless its distance is greater than epsilon, so a NaN
+coordinate is a neighbour of everything, as with the double precision metric.
+*/
+
+#define DBSCAN_LANES 8
+
+typedef float dbscan_vf_t __attribute__((vector_size(DBSCAN_LANES * sizeof(float))));
+typedef int dbscan_vi_t __attribute__((vector_size(DBSCAN_LANES * sizeof(int))));
+
+typedef struct {
+    float *x, *y, *z;             // bucket order, x[j] belongs to point index[j]
+    const unsigned int *index;    // grid order
+    unsigned int num_points;      // points in buckets, non-finite ones are in the grid's wild list
+    size_t cap;
+} dbscan_soa_t;
+
+/*
+Copy the finite points of the last grid build into s in bucket order.
+xyz, stride = as given to grid_index_build
+return = 0, -1 if the arrays cannot grow (printed)
+*/
+static inline int dbscan_soa_fill(dbscan_soa_t *s, const grid_index_t *g, const double *xyz, size_t stride)
+{
+    unsigned int n = g->num_points - g->nwild;
+    if (n > s->cap) {
+        float *p = (float *) realloc(s->x, 3 * (size_t) n * sizeof(*p));
+        if (p == NULL) {
+            printf("Error allocating the DBSCAN coordinates\n");
+            return -1;
+        }
+        s->x = p;
+        s->y = p + n;
+        s->z = p + 2 * (size_t) n;
+        s->cap = n;
+    }
+    const char *base = (const char *) xyz;
+    for (unsigned int j = 0; j < n; j++) {
+        const double *p = (const double *) (base + g->order[j] * stride);
+        s->x[j] = (float) p[0];
+        s->y[j] = (float) p[1];
+        s->z[j] = (float) p[2];
+    }
+    s->index = g->order;
+    s->num_points = n;
+    return 0;
+}
+
+static inline void dbscan_soa_free(dbscan_soa_t *s)
+{
+    free(s->x);
+    memset(s, 0, sizeof(*s));
+}
+
+/*
+Append to out the points of [begin, end) (bucket order) within epsilon of q, self excluded.
+Appending is branchless: every lane is stored and the count only advances for a
+neighbour, so out needs one slot past the last neighbour, which exists because
+self is never counted.
+return = new count
+*/
+static inline __attribute__((always_inline)) unsigned int dbscan_within(
+    const dbscan_soa_t *s, int dims, unsigned int begin, unsigned int end,
+    float qx, float qy, float qz, float eps2, unsigned int self,
+    unsigned int *out, unsigned int count)
+{
+    const unsigned int *index = s->index;
+    unsigned int j = begin;
+    dbscan_vf_t vqx = qx - (dbscan_vf_t) {0}, vqy = qy - (dbscan_vf_t) {0};
+    dbscan_vf_t vqz = qz - (dbscan_vf_t) {0}, veps2 = eps2 - (dbscan_vf_t) {0};
+
+    for (; j + DBSCAN_LANES <= end; j += DBSCAN_LANES) {
+        dbscan_vf_t vx, vy, vz;
+        memcpy(&vx, s->x + j, sizeof(vx));
+        memcpy(&vy, s->y + j, sizeof(vy));
+        vx -= vqx;
+        vy -= vqy;
+        dbscan_vf_t d2 = vx * vx + vy * vy;
+        if (dims == 3) {
+            memcpy(&vz, s->z + j, sizeof(vz));
+            vz -= vqz;
+            d2 += vz * vz;
+        }
+        dbscan_vi_t far = d2 > veps2;
+        // whole block out of range, the common case for neighbouring cells
+        int all_far = 1;
+        for (int l = 0; l < DBSCAN_LANES; l++)
+            all_far &= far[l] != 0;
+        if (all_far)
+            continue;
+        for (int l = 0; l < DBSCAN_LANES; l++) {
+            unsigned int i = index[j + l];
+            out[count] = i;
+            count += (far[l] == 0) & (i != self);
+        }
+    }
+    for (; j < end; j++) {
+        float dx = s->x[j] - qx, dy = s->y[j] - qy;
+        float d2 = dx * dx + dy * dy;
+        if (dims == 3) {
+            float dz = s->z[j] - qz;
+            d2 += dz * dz;
+        }
+        unsigned int i = index[j];
+        out[count] = i;
+        count += !(d2 > eps2) & (i != self);
+    }
+    return count;
+}
+
+static inline unsigned int dbscan_within_2d(const dbscan_soa_t *s, unsigned int begin, unsigned int end,
+    float qx, float qy, float qz, float eps2, unsigned int self, unsigned int *out, unsigned int count)
+{
+    return dbscan_within(s, 2, begin, end, qx, qy, qz, eps2, self, out, count);
+}
+
+static inline unsigned int dbscan_within_3d(const dbscan_soa_t *s, unsigned int begin, unsigned int end,
+    float qx, float qy, float qz, float eps2, unsigned int self, unsigned int *out, unsigned int count)
+{
+    return dbscan_within(s, 3, begin, end, qx, qy, qz, eps2, self, out, count);
+}
+
+#endif // DBSCAN_KERNEL_H
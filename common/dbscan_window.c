@@ -0,0 +1,515 @@
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbscan_window.h"
+
+#define WINDOW_CELL_LIMIT (1 << 30)  // cell coordinates are clamped, far points share the edge cells
+#define WINDOW_CELL_MARGIN 0.999     // cell diagonal below epsilon even after float rounding
+#define WINDOW_NONE UINT_MAX
+
+static int cell_of(float v, double inv_cell)
+{
+    double c = floor(v * inv_cell);
+    if (c > WINDOW_CELL_LIMIT)
+        return WINDOW_CELL_LIMIT;
+    if (c < -WINDOW_CELL_LIMIT)
+        return -WINDOW_CELL_LIMIT;
+    return (int) c;
+}
+
+static unsigned int hash_cell(int cx, int cy, int cz, unsigned int mask)
+{
+    uint32_t h = (uint32_t) cy * 19349663u ^ (uint32_t) cz * 83492791u;
+    return (h + (uint32_t) cx * 73856093u) & mask;
+}
+
+// position of a sequence number in the window, dbscan_window_points() or more once it has left
+static unsigned int rank_of(const dbscan_window_t *w, unsigned int seq)
+{
+    return seq - w->first;
+}
+
+static unsigned int seq_of(const dbscan_window_t *w, unsigned int slot)
+{
+    return w->first + ((slot - w->first) & w->mask);
+}
+
+static int grow(void **p, size_t n, size_t size)
+{
+    void *q = realloc(*p, n * size);
+    if (q == NULL) {
+        printf("Error allocating the DBSCAN window\n");
+        return -1;
+    }
+    *p = q;
+    return 0;
+}
+
+static void point_cell(const dbscan_window_t *w, unsigned int slot, int *c)
+{
+    c[0] = cell_of(w->x[slot], w->inv_cell);
+    c[1] = cell_of(w->y[slot], w->inv_cell);
+    c[2] = w->dims == 3 ? cell_of(w->z[slot], w->inv_cell) : 0;
+}
+
+// the squared distance as dbscan_within() takes it
+static int within(const dbscan_window_t *w, unsigned int j, float x, float y, float z)
+{
+    float dx = w->x[j] - x, dy = w->y[j] - y;
+    float d2 = dx * dx + dy * dy;
+    if (w->dims == 3) {
+        float dz = w->z[j] - z;
+        d2 += dz * dz;
+    }
+    return !(d2 > w->eps2);
+}
+
+// index of the cell, WINDOW_NONE if it holds no point
+static unsigned int cell_lookup(const dbscan_window_t *w, int cx, int cy, int cz)
+{
+    for (unsigned int i = hash_cell(cx, cy, cz, w->cell_mask);; i = (i + 1) & w->cell_mask) {
+        const dbscan_window_cell_t *c = &w->cells[i];
+        if (!c->used)
+            return WINDOW_NONE;
+        if (c->cx == cx && c->cy == cy && c->cz == cz)
+            return i;
+    }
+}
+
+// index of the point's cell, opened if new: empty, so its counts are exact
+static unsigned int cell_open(dbscan_window_t *w, unsigned int slot)
+{
+    int k[3];
+    point_cell(w, slot, k);
+    for (unsigned int i = hash_cell(k[0], k[1], k[2], w->cell_mask);; i = (i + 1) & w->cell_mask) {
+        dbscan_window_cell_t *c = &w->cells[i];
+        if (!c->used) {
+            c->used = 1;
+            c->exact = 1;
+            c->cx = k[0];
+            c->cy = k[1];
+            c->cz = k[2];
+            c->n = 0;
+            return i;
+        }
+        if (c->cx == k[0] && c->cy == k[1] && c->cz == k[2])
+            return i;
+    }
+}
+
+static void cell_append(dbscan_window_t *w, unsigned int c, unsigned int slot)
+{
+    dbscan_window_cell_t *cell = &w->cells[c];
+    w->cell[slot] = c;
+    w->next_in_cell[slot] = WINDOW_NONE;
+    if (cell->n++ == 0)
+        cell->head = slot;
+    else
+        w->next_in_cell[cell->tail] = slot;
+    cell->tail = slot;
+}
+
+// Close an emptied cell, moving later cells of the probe back into the hole.
+static void cell_close(dbscan_window_t *w, unsigned int hole)
+{
+    for (unsigned int i = (hole + 1) & w->cell_mask; w->cells[i].used; i = (i + 1) & w->cell_mask) {
+        const dbscan_window_cell_t *c = &w->cells[i];
+        unsigned int home = hash_cell(c->cx, c->cy, c->cz, w->cell_mask);
+        // stays unless the hole lies between its home and it
+        if (((i - home) & w->cell_mask) < ((i - hole) & w->cell_mask))
+            continue;
+        w->cells[hole] = *c;
+        for (unsigned int s = c->head; s != WINDOW_NONE; s = w->next_in_cell[s])
+            w->cell[s] = hole;
+        hole = i;
+    }
+    w->cells[hole].used = 0;
+}
+
+// New table of the live points, no cell has exact counts until settle() redoes them.
+static void cells_rebuild(dbscan_window_t *w)
+{
+    memset(w->cells, 0, ((size_t) w->cell_mask + 1) * sizeof(*w->cells));
+    for (unsigned int seq = w->first; seq != w->next; seq++) {
+        unsigned int slot = seq & w->mask;
+        if (w->cell[slot] == WINDOW_NONE)
+            continue;
+        unsigned int c = cell_open(w, slot);
+        w->cells[c].exact = 0;
+        cell_append(w, c, slot);
+    }
+}
+
+/*
+Make room for n points, moving the live ones to their slots in the larger ring.
+return = 0, -1 if the buffers cannot grow (printed)
+*/
+static int reserve(dbscan_window_t *w, unsigned int n)
+{
+    if (n <= w->cap)
+        return 0;
+    unsigned int cap = w->cap ? w->cap : 256;
+    while (cap < n)
+        cap <<= 1;
+    unsigned int mask = cap - 1;
+    float *x = NULL, *y = NULL, *z = NULL;
+    unsigned int *cell = NULL;
+    // no more cells than points, the table stays at most a quarter full
+    if (grow((void **) &x, cap, sizeof(*x)) != 0 || grow((void **) &y, cap, sizeof(*y)) != 0 ||
+        grow((void **) &z, cap, sizeof(*z)) != 0 || grow((void **) &cell, cap, sizeof(*cell)) != 0 ||
+        grow((void **) &w->cross, cap, sizeof(*w->cross)) != 0 ||
+        grow((void **) &w->next_in_cell, cap, sizeof(*w->next_in_cell)) != 0 ||
+        grow((void **) &w->cluster, cap, sizeof(*w->cluster)) != 0 ||
+        grow((void **) &w->core, cap, sizeof(*w->core)) != 0 ||
+        grow((void **) &w->core_cells, cap, sizeof(*w->core_cells)) != 0 ||
+        grow((void **) &w->cells, 4 * (size_t) cap, sizeof(*w->cells)) != 0) {
+        free(x);
+        free(y);
+        free(z);
+        free(cell);
+        return -1;
+    }
+    for (unsigned int seq = w->first; seq != w->next; seq++) {
+        unsigned int s = seq & w->mask, t = seq & mask;
+        x[t] = w->x[s];
+        y[t] = w->y[s];
+        z[t] = w->z[s];
+        cell[t] = w->cell[s];
+    }
+    free(w->x);
+    free(w->y);
+    free(w->z);
+    free(w->cell);
+    w->x = x;
+    w->y = y;
+    w->z = z;
+    w->cell = cell;
+    w->cap = cap;
+    w->mask = mask;
+    w->cell_mask = 4 * cap - 1;
+    cells_rebuild(w);
+    return 0;
+}
+
+int dbscan_window_init(dbscan_window_t *w, double epsilon, unsigned int minpts, int dims, int frames)
+{
+    double cell = WINDOW_CELL_MARGIN * epsilon / sqrt(dims);
+    int reach = (int) ceil(epsilon / cell);
+    int side = 2 * reach + 1;
+
+    memset(w, 0, sizeof(*w));
+    w->eps2 = (float) (epsilon * epsilon);
+    w->inv_cell = 1.0 / cell;
+    w->minpts = minpts;
+    w->dims = dims;
+    w->frames = frames > 0 ? frames : 1;
+    if (grow((void **) &w->frame_end, w->frames, sizeof(*w->frame_end)) != 0 ||
+        grow((void **) &w->offsets, (size_t) side * side * side, sizeof(*w->offsets)) != 0 ||
+        reserve(w, 1) != 0) {
+        dbscan_window_free(w);
+        return -1;
+    }
+    // cells whose nearest corners are within epsilon, nearest first (insertion sort)
+    double gap[side * side * side];
+    int dz_reach = dims == 3 ? reach : 0;
+    for (int dz = -dz_reach; dz <= dz_reach; dz++)
+        for (int dy = -reach; dy <= reach; dy++)
+            for (int dx = -reach; dx <= reach; dx++) {
+                int d[3] = {dx, dy, dz};
+                double g = 0;
+                for (int a = 0; a < 3; a++) {
+                    double e = abs(d[a]) > 0 ? (abs(d[a]) - 1) * cell : 0;
+                    g += e * e;
+                }
+                if (g > epsilon * epsilon)
+                    continue;
+                int k = w->num_offsets++;
+                for (; k > 0 && gap[k - 1] > g; k--) {
+                    gap[k] = gap[k - 1];
+                    memcpy(w->offsets[k], w->offsets[k - 1], sizeof(w->offsets[k]));
+                }
+                gap[k] = g;
+                memcpy(w->offsets[k], d, sizeof(d));
+            }
+    return 0;
+}
+
+// neighbours of a point in the other cells around it
+static unsigned int count_cross(const dbscan_window_t *w, unsigned int slot)
+{
+    const dbscan_window_cell_t *own = &w->cells[w->cell[slot]];
+    unsigned int n = 0;
+
+    for (int o = 0; o < w->num_offsets; o++) {
+        unsigned int c = cell_lookup(w, own->cx + w->offsets[o][0], own->cy + w->offsets[o][1],
+                                     own->cz + w->offsets[o][2]);
+        if (c == WINDOW_NONE || c == w->cell[slot])
+            continue;
+        for (unsigned int j = w->cells[c].head; j != WINDOW_NONE; j = w->next_in_cell[j])
+            n += within(w, j, w->x[slot], w->y[slot], w->z[slot]);
+    }
+    return n;
+}
+
+/*
+Take the oldest frame out: each leaving point is the head of its cell and takes
+one off the counts of its neighbours in the exact cells around.
+*/
+static void expire_oldest(dbscan_window_t *w)
+{
+    unsigned int end = w->frame_end[w->oldest_frame];
+
+    for (unsigned int seq = w->first; seq != end; seq++) {
+        unsigned int slot = seq & w->mask, c = w->cell[slot];
+        if (c == WINDOW_NONE)
+            continue;
+        dbscan_window_cell_t *own = &w->cells[c];
+        for (int o = 0; o < w->num_offsets; o++) {
+            unsigned int b = cell_lookup(w, own->cx + w->offsets[o][0], own->cy + w->offsets[o][1],
+                                         own->cz + w->offsets[o][2]);
+            if (b == WINDOW_NONE || b == c || !w->cells[b].exact)
+                continue;
+            for (unsigned int j = w->cells[b].head; j != WINDOW_NONE; j = w->next_in_cell[j])
+                w->cross[j] -= within(w, j, w->x[slot], w->y[slot], w->z[slot]);
+        }
+        own->head = w->next_in_cell[slot];
+        if (--own->n == 0)
+            cell_close(w, c);
+    }
+    w->first = end;
+    w->oldest_frame = (w->oldest_frame + 1) % w->frames;
+    w->num_frames--;
+}
+
+/*
+Add one point. In an exact cell it counts its neighbours in the other cells,
+elsewhere it only adds itself to the counts of the exact cells around.
+*/
+static void insert_point(dbscan_window_t *w, const float *p)
+{
+    unsigned int slot = w->next++ & w->mask;
+
+    w->x[slot] = p[0];
+    w->y[slot] = p[1];
+    w->z[slot] = p[2];
+    w->cell[slot] = WINDOW_NONE;
+    if (!isfinite(p[0]) || !isfinite(p[1]) || !isfinite(p[2]))
+        return;
+
+    unsigned int c = cell_open(w, slot);
+    dbscan_window_cell_t *own = &w->cells[c];
+    unsigned int cross = 0;
+    for (int o = 0; o < w->num_offsets; o++) {
+        unsigned int b = cell_lookup(w, own->cx + w->offsets[o][0], own->cy + w->offsets[o][1],
+                                     own->cz + w->offsets[o][2]);
+        if (b == WINDOW_NONE || b == c || (!own->exact && !w->cells[b].exact))
+            continue;
+        int exact = w->cells[b].exact;
+        for (unsigned int j = w->cells[b].head; j != WINDOW_NONE; j = w->next_in_cell[j]) {
+            if (!within(w, j, p[0], p[1], p[2]))
+                continue;
+            cross++;
+            if (exact)
+                w->cross[j]++;
+        }
+    }
+    w->cross[slot] = cross;
+    cell_append(w, c, slot);
+    // all core now, the counts of its points are left to go stale
+    if (own->n > w->minpts)
+        own->exact = 0;
+}
+
+static unsigned int cell_find(dbscan_window_t *w, unsigned int c)
+{
+    while (w->cells[c].parent != c) {
+        unsigned int p = w->cells[c].parent;
+        w->cells[c].parent = w->cells[p].parent;
+        c = p;
+    }
+    return c;
+}
+
+// any core point of cell a within epsilon of a core point of cell b
+static int cells_linked(const dbscan_window_t *w, unsigned int a, unsigned int b)
+{
+    for (unsigned int i = w->cells[a].head; i != WINDOW_NONE; i = w->next_in_cell[i]) {
+        if (!w->core[i])
+            continue;
+        for (unsigned int j = w->cells[b].head; j != WINDOW_NONE; j = w->next_in_cell[j]) {
+            if (!w->core[j])
+                continue;
+            if (within(w, j, w->x[i], w->y[i], w->z[i]))
+                return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+Core flags, then the clusters as components of the cells with core points. A
+sparse cell whose counts went stale while it was full has them counted again.
+Nearest cells are joined first, so most farther pairs are found joined already
+and cost no distance at all.
+*/
+static void settle(dbscan_window_t *w)
+{
+    unsigned int ncells = 0;
+
+    for (unsigned int seq = w->first; seq != w->next; seq++) {
+        unsigned int slot = seq & w->mask;
+        w->core[slot] = 0;
+        if (w->cell[slot] == WINDOW_NONE)
+            continue;
+        dbscan_window_cell_t *c = &w->cells[w->cell[slot]];
+        c->parent = WINDOW_NONE;
+        if (c->n > w->minpts) {
+            w->core[slot] = 1;
+            continue;
+        }
+        if (!c->exact) {
+            for (unsigned int j = c->head; j != WINDOW_NONE; j = w->next_in_cell[j])
+                w->cross[j] = count_cross(w, j);
+            c->exact = 1;
+        }
+        // the other points of the cell are all neighbours
+        w->core[slot] = c->n - 1 + w->cross[slot] >= w->minpts;
+    }
+    for (unsigned int seq = w->first; seq != w->next; seq++) {
+        unsigned int slot = seq & w->mask, c = w->cell[slot];
+        // the first core point met in a cell is its oldest
+        if (!w->core[slot] || w->cells[c].parent != WINDOW_NONE)
+            continue;
+        w->cells[c].parent = c;
+        w->cells[c].root = seq;
+        w->core_cells[ncells++] = c;
+    }
+    for (int o = 0; o < w->num_offsets; o++) {
+        const int *d = w->offsets[o];
+        // each pair of cells once
+        if (d[2] < 0 || (d[2] == 0 && (d[1] < 0 || (d[1] == 0 && d[0] <= 0))))
+            continue;
+        for (unsigned int k = 0; k < ncells; k++) {
+            const dbscan_window_cell_t *a = &w->cells[w->core_cells[k]];
+            unsigned int b = cell_lookup(w, a->cx + d[0], a->cy + d[1], a->cz + d[2]);
+            if (b == WINDOW_NONE || w->cells[b].parent == WINDOW_NONE)
+                continue;
+            unsigned int ra = cell_find(w, w->core_cells[k]), rb = cell_find(w, b);
+            if (ra == rb || !cells_linked(w, w->core_cells[k], b))
+                continue;
+            // the root with the older core point stays
+            if (rank_of(w, w->cells[rb].root) < rank_of(w, w->cells[ra].root)) {
+                unsigned int t = ra;
+                ra = rb;
+                rb = t;
+            }
+            w->cells[rb].parent = ra;
+        }
+    }
+}
+
+int dbscan_window_push(dbscan_window_t *w, const float *pos, int stride, unsigned int n)
+{
+    // room before anything moves, the leaving frame's slots are still in use
+    if (reserve(w, dbscan_window_points(w) + n) != 0) {
+        dbscan_window_clear(w);
+        return -1;
+    }
+    if (w->num_frames == w->frames)
+        expire_oldest(w);
+    for (unsigned int i = 0; i < n; i++)
+        insert_point(w, pos + (size_t) i * stride);
+    w->frame_end[(w->oldest_frame + w->num_frames) % w->frames] = w->next;
+    w->num_frames++;
+    settle(w);
+    return 0;
+}
+
+// oldest core point of the cluster of a core point
+static unsigned int root_of(dbscan_window_t *w, unsigned int slot)
+{
+    return w->cells[cell_find(w, w->cell[slot])].root;
+}
+
+int dbscan_window_labels(dbscan_window_t *w, const float *pos, int stride, int *labels,
+                         cluster_stats_t *stats, int doppler_col, unsigned int *members)
+{
+    unsigned int n = dbscan_window_points(w);
+    int num_clusters = 0;
+
+    // ids in the order of the roots, as the serial loop starts clusters
+    for (unsigned int seq = w->first; seq != w->next; seq++) {
+        unsigned int slot = seq & w->mask;
+        if (w->core[slot] && root_of(w, slot) == seq)
+            w->cluster[slot] = num_clusters++;
+    }
+    if (stats != NULL)
+        cluster_stats_begin(stats, num_clusters);
+    for (unsigned int i = 0; i < n; i++) {
+        unsigned int seq = w->first + i, slot = seq & w->mask;
+        int label = DBSCAN_WINDOW_NOISE;
+        if (w->core[slot]) {
+            label = w->cluster[root_of(w, slot) & w->mask];
+        } else if (w->cell[slot] != WINDOW_NONE) {
+            // border point: the last cluster grown from a neighbour, else the first to reach it
+            const dbscan_window_cell_t *own = &w->cells[w->cell[slot]];
+            int first = INT_MAX, last = -1;
+            for (int o = 0; o < w->num_offsets; o++) {
+                unsigned int c = cell_lookup(w, own->cx + w->offsets[o][0], own->cy + w->offsets[o][1],
+                                             own->cz + w->offsets[o][2]);
+                if (c == WINDOW_NONE || w->cells[c].parent == WINDOW_NONE)
+                    continue;
+                for (unsigned int j = w->cells[c].head; j != WINDOW_NONE; j = w->next_in_cell[j]) {
+                    if (!w->core[j] || !within(w, j, w->x[slot], w->y[slot], w->z[slot]))
+                        continue;
+                    unsigned int root = root_of(w, j);
+                    int id = w->cluster[root & w->mask];
+                    if (id < first)
+                        first = id;
+                    if (root == seq_of(w, j) && id > last)
+                        last = id;
+                }
+            }
+            if (last >= 0)
+                label = last;
+            else if (first != INT_MAX)
+                label = first;
+        }
+        labels[i] = label;
+        if (stats != NULL)
+            cluster_stats_add(stats, num_clusters, label, pos + (size_t) i * stride, doppler_col);
+    }
+    if (stats != NULL)
+        cluster_stats_end(stats, num_clusters, labels, n, members);
+    return num_clusters;
+}
+
+void dbscan_window_clear(dbscan_window_t *w)
+{
+    w->first = w->next;
+    w->num_frames = 0;
+    w->oldest_frame = 0;
+    if (w->cells != NULL)
+        cells_rebuild(w);
+}
+
+void dbscan_window_free(dbscan_window_t *w)
+{
+    free(w->frame_end);
+    free(w->offsets);
+    free(w->x);
+    free(w->y);
+    free(w->z);
+    free(w->cross);
+    free(w->cell);
+    free(w->next_in_cell);
+    free(w->cluster);
+    free(w->core);
+    free(w->core_cells);
+    free(w->cells);
+    memset(w, 0, sizeof(*w));
+}
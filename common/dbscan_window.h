@@ -0,0 +1,101 @@
+#ifndef DBSCAN_WINDOW_H
+#define DBSCAN_WINDOW_H
+
+#include "cluster_stats.h"
+
+/*
+Incremental DBSCAN over a sliding window of the last few frames (animal keeps 3).
+Points live in cells of edge epsilon / sqrt(dims), joined at the tail and left
+from the head, oldest first. Two points of a cell are always neighbours, so a
+cell holding more than minpts points is all core points and needs no distance at
+all; only the points of sparser cells keep a count of their neighbours in other
+cells, updated by the points that come and go near them. A new frame therefore
+costs range queries for its own points against the sparse cells around them, and
+the oldest frame the same when it leaves, instead of a query for every point of
+the window. The core points of a cell are one cluster, and clusters are the
+connected components of the cells, two cells being linked by any one pair of core
+points within epsilon; only that graph of occupied cells is redone per frame.
+The labels are those of the serial DBSCAN of the dbscan files run on the window's
+points oldest first, cluster ids included: a cluster's id is the rank of its
+oldest core point, a border point takes the last cluster whose oldest core point
+is its neighbour, otherwise the first cluster with a core neighbour.
+Points with a non-finite coordinate belong to no cluster and are nobody's neighbour.
+*/
+
+#define DBSCAN_WINDOW_NOISE -2      // label of a point in no cluster, NOISE of the dbscan files
+
+typedef struct {
+    int cx, cy, cz;
+    int used;                       // holds points, 0 ends a probe
+    int exact;                      // the cross counts of its points are kept up to date
+    unsigned int n;                 // points
+    unsigned int head, tail;        // oldest and newest point (slots), linked by next_in_cell
+    unsigned int parent;            // union-find over cells with core points
+    unsigned int root;              // oldest core point of the cell, of the cluster at a union-find root
+} dbscan_window_cell_t;
+
+typedef struct {
+    float eps2;
+    double inv_cell;
+    unsigned int minpts;
+    int dims;                       // 2 ignores z
+    int frames;                     // frames kept
+    int num_frames;
+    int oldest_frame;               // index into frame_end
+    unsigned int *frame_end;        // sequence number after the last point of each frame
+    unsigned int first;             // sequence number of the oldest point
+    unsigned int next;              // sequence number of the next point pushed
+    int (*offsets)[3];              // cells that can hold neighbours, nearest first
+    int num_offsets;
+    // per point, at slot seq & mask
+    unsigned int cap;               // slots, a power of two
+    unsigned int mask;
+    float *x, *y, *z;
+    unsigned int *cross;            // neighbours in other cells, see exact
+    unsigned int *cell;             // cell index, UINT_MAX for a non-finite point
+    unsigned int *next_in_cell;
+    int *cluster;                   // cluster id of a root, while labelling
+    unsigned char *core;
+    // cells, open addressing
+    dbscan_window_cell_t *cells;
+    unsigned int cell_mask;
+    unsigned int *core_cells;       // cells with core points, per push
+} dbscan_window_t;
+
+/*
+w = window to set up, zero-initialised or freed
+epsilon, minpts = DBSCAN parameters
+dims = 3, or 2 to ignore z
+frames = frames kept, the oldest leaves when one more is pushed
+return = 0, -1 if the buffers cannot be allocated (printed)
+*/
+int dbscan_window_init(dbscan_window_t *w, double epsilon, unsigned int minpts, int dims, int frames);
+
+/*
+Add a frame, dropping the oldest when the window is full.
+pos = n rows of stride floats starting with x, y, z
+return = 0, -1 if the buffers cannot grow (printed, the window is emptied)
+*/
+int dbscan_window_push(dbscan_window_t *w, const float *pos, int stride, unsigned int n);
+
+/*
+Labels of the window's points, oldest frame first, in the order they were pushed.
+pos = the same points as rows of stride floats for stats, NULL without stats
+labels = room for dbscan_window_points(w) cluster ids, DBSCAN_WINDOW_NOISE for noise
+stats, doppler_col, members = as for dbscan_labels(), stats NULL to skip
+return = number of clusters
+*/
+int dbscan_window_labels(dbscan_window_t *w, const float *pos, int stride, int *labels,
+                         cluster_stats_t *stats, int doppler_col, unsigned int *members);
+
+static inline unsigned int dbscan_window_points(const dbscan_window_t *w)
+{
+    return w->next - w->first;
+}
+
+// Drop every frame, the buffers are kept.
+void dbscan_window_clear(dbscan_window_t *w);
+
+void dbscan_window_free(dbscan_window_t *w);
+
+#endif // DBSCAN_WINDOW_H
@@ -0,0 +1,96 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fall_alert.h"
+#include "stage_timer.h"
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static const char *fifo_path;
+static int fifo_fd = -1;
+static fall_alert_fn callback;
+static void *callback_arg;
+static unsigned long events, written, dropped;
+
+void fall_alert_init(int argc, char *argv[])
+{
+    for (int i = 1; i + 1 < argc; i++)
+        if (strcmp(argv[i], "--fall-fifo") == 0)
+            fifo_path = argv[i + 1];
+    if (fifo_path != NULL && mkfifo(fifo_path, 0644) != 0 && errno != EEXIST) {
+        printf("Error %i from mkfifo %s: %s\n", errno, fifo_path, strerror(errno));
+        fifo_path = NULL;
+    }
+    if (fifo_path != NULL)
+        signal(SIGPIPE, SIG_IGN);   // a reader that goes away must not kill the pipeline
+}
+
+void fall_alert_set_callback(fall_alert_fn fn, void *arg)
+{
+    pthread_mutex_lock(&lock);
+    callback = fn;
+    callback_arg = arg;
+    pthread_mutex_unlock(&lock);
+}
+
+// Under lock. A reader may come and go, so the pipe is (re)opened on demand.
+static void fifo_write(const fall_event_t *e)
+{
+    char line[96];
+    int n = snprintf(line, sizeof(line), "fall %d %d %llu %llu\n", e->sensor, e->track,
+                     (unsigned long long) e->rx_ns, (unsigned long long) e->decided_ns);
+
+    if (fifo_fd < 0)
+        fifo_fd = open(fifo_path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fifo_fd < 0) {
+        dropped++;          // ENXIO: nobody is reading
+        return;
+    }
+    if (write(fifo_fd, line, (size_t) n) == n) {
+        written++;
+        return;
+    }
+    dropped++;
+    if (errno == EPIPE) {   // the reader went away
+        close(fifo_fd);
+        fifo_fd = -1;
+    }
+}
+
+void fall_alert_fire(const fall_event_t *e)
+{
+    stage_record(STAGE_FALL_RX_POSTURE, e->decided_ns - e->rx_ns);
+    pthread_mutex_lock(&lock);
+    events++;
+    fall_alert_fn fn = callback;
+    void *arg = callback_arg;
+    if (fifo_path != NULL)
+        fifo_write(e);
+    pthread_mutex_unlock(&lock);
+    if (fn != NULL)
+        fn(e, arg);
+    stage_end(STAGE_FALL_RX_ALERT, e->rx_ns);
+}
+
+void fall_alert_report(void)
+{
+    pthread_mutex_lock(&lock);
+    if (events > 0 || fifo_path != NULL)
+        fprintf(stderr, "fall alerts: %lu events, %lu written to %s, %lu dropped\n",
+                events, written, fifo_path != NULL ? fifo_path : "(no fifo)", dropped);
+    pthread_mutex_unlock(&lock);
+}
+
+void fall_alert_close(void)
+{
+    pthread_mutex_lock(&lock);
+    if (fifo_fd >= 0)
+        close(fifo_fd);
+    fifo_fd = -1;
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,42 @@
+#ifndef FALL_ALERT_H
+#define FALL_ALERT_H
+
+#include <stdint.h>
+
+/*
+Hook run the moment a pipeline decides that someone fell, ahead of the csv and
+the display: an optional callback in the process, and with --fall-fifo <path> one
+line per event written to a named pipe for another program to wait on
+("fall <sensor> <track> <rx_ns> <decided_ns>\n", CLOCK_MONOTONIC nanoseconds).
+The pipe is created if missing and opened without blocking; while nobody reads
+it, or when its buffer is full, events are counted as dropped rather than
+holding up the frame. Each line is a single write() below PIPE_BUF, so events of
+different sensors never interleave.
+The latency from the frame's receive time to the decision and to the end of the
+hook go to the stage timer (fall rx->posture, fall rx->alert).
+*/
+
+typedef struct {
+    int sensor;                     // -1 for a single sensor
+    int track;                      // persistent id of the person
+    uint64_t rx_ns;                 // receive time of the frame
+    uint64_t decided_ns;            // when the posture was decided
+} fall_event_t;
+
+typedef void (*fall_alert_fn)(const fall_event_t *e, void *arg);
+
+// Read --fall-fifo <path>.
+void fall_alert_init(int argc, char *argv[]);
+
+// Called on the pipeline's thread for every event, NULL to remove.
+void fall_alert_set_callback(fall_alert_fn fn, void *arg);
+
+// Run the hook for one event.
+void fall_alert_fire(const fall_event_t *e);
+
+// Events, pipe writes and drops to stderr.
+void fall_alert_report(void);
+
+void fall_alert_close(void);
+
+#endif // FALL_ALERT_H
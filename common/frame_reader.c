@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "frame_reader.h"
+#include "mono_clock.h"
+#include "radar_decode.h"
+
+static uint32_t load_le32(const uint8_t *p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+// Single writer, so a relaxed store is enough for frame_reader_stats() on another thread.
+static void count(uint64_t *c, uint64_t n)
+{
+    __atomic_store_n(c, *c + n, __ATOMIC_RELAXED);
+}
+
+int frame_reader_init(frame_reader_t *r, int fd)
+{
+    r->fd = fd;
+    r->head = 0;
+    r->tail = 0;
+    r->pending = 0;
+    r->capture = NULL;
+    r->eof = 0;
+    r->rx_ns = 0;
+    r->verify_checksum = 0;
+    r->in_sync = 0;
+    r->have_frame_number = 0;
+    r->frame_number = 0;
+    memset(&r->stats, 0, sizeof(r->stats));
+    r->frames = 0;
+    r->first_ns = 0;
+    r->handout_ns = 0;
+    r->busy_ns_total = 0;
+    r->busy_ns_max = 0;
+    r->buf = (uint8_t *) malloc(FRAME_READER_BUF_SIZE);
+    if (r->buf == NULL)
+        return -1;
+    return 0;
+}
+
+void frame_reader_free(frame_reader_t *r)
+{
+    free(r->buf);
+    r->buf = NULL;
+}
+
+void frame_reader_set_capture(frame_reader_t *r, capture_t *c)
+{
+    r->capture = (c != NULL && c->mode != CAPTURE_OFF) ? c : NULL;
+}
+
+static void count_received(frame_reader_t *r, ssize_t n)
+{
+    if (n <= 0)
+        return;
+    if (r->stats.bytes == 0)
+        __atomic_store_n(&r->stats.first_rx_ns, r->rx_ns, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->stats.last_rx_ns, r->rx_ns, __ATOMIC_RELAXED);
+    count(&r->stats.bytes, n);
+}
+
+// Fill the receive buffer from the port or the replayed capture.
+static ssize_t fill(frame_reader_t *r)
+{
+    uint8_t *dst = r->buf + r->tail;
+    size_t cap = FRAME_READER_BUF_SIZE - r->tail;
+    ssize_t n;
+
+    if (r->capture != NULL && r->capture->mode == CAPTURE_REPLAY) {
+        n = (ssize_t) capture_read(r->capture, dst, cap);
+        if (n == 0)
+            r->eof = 1;
+        r->rx_ns = mono_ns();
+        count_received(r, n);
+        return n;
+    }
+    n = read(r->fd, dst, cap);
+    r->rx_ns = mono_ns();
+    if (n > 0 && r->capture != NULL)
+        capture_write(r->capture, dst, n, r->rx_ns);
+    count_received(r, n);
+    return n;
+}
+
+// Bytes dropped in front of a frame: the first drop after a good frame is one resync event.
+static void skip(frame_reader_t *r, size_t n)
+{
+    if (n == 0)
+        return;
+    r->head += n;
+    count(&r->stats.skipped_bytes, n);
+    if (r->in_sync) {
+        r->in_sync = 0;
+        count(&r->stats.resyncs, 1);
+    }
+}
+
+/*
+Header checksum and frameNumber continuity of a frame about to be handed out.
+return = 0, -1 if the checksum is wrong (counted, the frame number is not used)
+*/
+static int check_frame(frame_reader_t *r, const uint8_t *frame, uint32_t len)
+{
+    uint32_t number = load_le32(frame + FRAME_NUMBER_OFFSET);
+
+    if (r->verify_checksum && len >= PC_HEADER_LEN && !pc_header_checksum_ok(frame)) {
+        count(&r->stats.checksum_errors, 1);
+        return -1;
+    }
+    if (r->have_frame_number) {
+        uint32_t step = number - r->frame_number;   // wraps like the radar's counter
+        if (step == 0 || step > 0x80000000u) {
+            count(&r->stats.restarts, 1);
+        }
+        else if (step > 1) {
+            count(&r->stats.gaps, 1);
+            count(&r->stats.lost_frames, step - 1);
+        }
+    }
+    r->frame_number = number;
+    r->have_frame_number = 1;
+    r->in_sync = 1;
+    count(&r->stats.frames, 1);
+    return 0;
+}
+
+// Look for a complete frame in the received bytes, dropping garbage in front of it.
+static int find_frame(frame_reader_t *r, const uint8_t **frame)
+{
+    for (;;) {
+        size_t avail = r->tail - r->head;
+        if (avail < FRAME_MAGIC_LEN)
+            return 0;
+
+        // memchr is vectorised by libc (NEON on the Jetson), so the scan runs many bytes per cycle
+        const uint8_t *p = r->buf + r->head;
+        const uint8_t *m = memchr(p, frame_magic_word[0], avail - FRAME_MAGIC_LEN + 1);
+        if (m == NULL) {
+            // keep the last bytes, they may be the start of a magic word
+            skip(r, r->tail - (FRAME_MAGIC_LEN - 1) - r->head);
+            return 0;
+        }
+        skip(r, m - p);
+        if (memcmp(m, frame_magic_word, FRAME_MAGIC_LEN) != 0) {
+            skip(r, 1);
+            continue;
+        }
+
+        avail = r->tail - r->head;
+        if (avail < FRAME_LEN_OFFSET + 4)
+            return 0;
+        uint32_t len = load_le32(m + FRAME_LEN_OFFSET);
+        if (len < FRAME_MIN_LEN || len > FRAME_MAX_LEN) {
+            skip(r, 1);  // magic word inside payload, keep scanning
+            continue;
+        }
+        if (avail < len)
+            return 0;
+
+        if (check_frame(r, m, len) != 0) {
+            skip(r, 1);  // damaged header, its length and frame number cannot be trusted
+            continue;
+        }
+        *frame = m;
+        r->pending = len;
+        return (int) len;
+    }
+}
+
+int frame_reader_read(frame_reader_t *r, const uint8_t **frame)
+{
+    // The previous frame is released only now, so the caller could use it without a copy.
+    if (r->pending > 0) {
+        uint64_t busy = mono_ns() - r->handout_ns;
+        r->busy_ns_total += busy;
+        if (busy > r->busy_ns_max)
+            r->busy_ns_max = busy;
+    }
+    r->head += r->pending;
+    r->pending = 0;
+
+    for (;;) {
+        int len = find_frame(r, frame);
+        if (len > 0) {
+            r->handout_ns = mono_ns();
+            if (r->frames++ == 0)
+                r->first_ns = r->handout_ns;
+            return len;
+        }
+
+        if (r->head == r->tail) {
+            r->head = 0;
+            r->tail = 0;
+        }
+        else if (FRAME_READER_BUF_SIZE - r->tail < FRAME_MAX_LEN) {
+            // only the unfinished frame is moved, never more than FRAME_MAX_LEN bytes
+            memmove(r->buf, r->buf + r->head, r->tail - r->head);
+            r->tail -= r->head;
+            r->head = 0;
+        }
+
+        ssize_t n = fill(r);
+        if (n <= 0)
+            return (int) n;
+        r->tail += n;
+    }
+}
+
+void frame_reader_stats(const frame_reader_t *r, frame_stats_t *out)
+{
+    const uint64_t *src = (const uint64_t *) &r->stats;
+    uint64_t *dst = (uint64_t *) out;
+    for (size_t i = 0; i < sizeof(*out) / sizeof(uint64_t); i++)
+        dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+}
+
+void frame_reader_report_stats(const frame_reader_t *r)
+{
+    frame_stats_t st;
+    frame_reader_stats(r, &st);
+    double elapsed = (st.last_rx_ns - st.first_rx_ns) / 1e9;
+
+    printf("link: %.1f kB/s  %.1f frames/s  frame number gaps %llu (lost %llu)  restarts %llu  "
+           "resyncs %llu (skipped %llu B)  checksum errors %llu\n",
+           elapsed > 0 ? st.bytes / elapsed / 1e3 : 0.0, elapsed > 0 ? st.frames / elapsed : 0.0,
+           (unsigned long long) st.gaps, (unsigned long long) st.lost_frames, (unsigned long long) st.restarts,
+           (unsigned long long) st.resyncs, (unsigned long long) st.skipped_bytes,
+           (unsigned long long) st.checksum_errors);
+}
+
+void frame_reader_report(const frame_reader_t *r)
+{
+    double elapsed = r->frames > 1 ? (r->handout_ns - r->first_ns) / 1e9 : 0;
+    double busy_frames = r->frames > 0 ? (double) r->frames : 1;
+
+    printf("frames %llu  %.1f frames/s  processing per frame: mean %.1f us  max %.1f us\n",
+           (unsigned long long) r->frames, elapsed > 0 ? (r->frames - 1) / elapsed : 0.0,
+           r->busy_ns_total / busy_frames / 1e3, r->busy_ns_max / 1e3);
+    frame_reader_report_stats(r);
+}
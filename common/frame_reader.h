@@ -0,0 +1,113 @@
+#ifndef FRAME_READER_H
+#define FRAME_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "capture.h"
+
+/*
+Streaming reassembler for TI mmWave UART frames.
+Bytes are read from the port into one receive buffer, the magic word
+{2, 1, 4, 3, 6, 5, 8, 7} is searched at any offset and a frame is handed out
+only after totalPackLen bytes (header offset 12) have arrived.
+Frames that straddle two read() calls are therefore kept instead of dropped.
+With a capture attached the received bytes are also recorded, or the port is
+replaced by a recorded session (see capture.h).
+Every handed-out frame is also checked against the previous one for frameNumber
+continuity, so dropped frames can be told apart from pipeline problems. People
+counting frames whose header checksum is wrong are counted and not handed out:
+the reader skips past the magic word and keeps scanning.
+*/
+
+#define FRAME_MAGIC_LEN 8
+#define FRAME_LEN_OFFSET 12                         // magic word + version
+#define FRAME_NUMBER_OFFSET 20                      // magic word + version, length, platform (both demos)
+#define FRAME_MIN_LEN 40                            // smallest header (vital signs)
+#define FRAME_MAX_LEN 65536                         // larger totalPackLen is treated as a false magic word
+#define FRAME_READER_BUF_SIZE (4 * FRAME_MAX_LEN)
+
+// static so tools that only build frames (radar_sim) can use it without linking frame_reader.c
+static const uint8_t frame_magic_word[FRAME_MAGIC_LEN] = {2, 1, 4, 3, 6, 5, 8, 7};
+
+/*
+Link and stream integrity counters of one reader.
+Written by the thread that calls frame_reader_read(), read with frame_reader_stats()
+from any thread. Only uint64_t fields, the snapshot copies them one by one.
+*/
+typedef struct {
+    uint64_t frames;            // frames handed out
+    uint64_t bytes;             // bytes received from the port or the replay
+    uint64_t resyncs;           // times the stream lost the frame boundary and bytes had to be skipped
+    uint64_t skipped_bytes;     // bytes dropped while looking for a magic word
+    uint64_t checksum_errors;   // people counting header checksum did not match, frame dropped
+    uint64_t gaps;              // frameNumber jumped forward by more than 1
+    uint64_t lost_frames;       // frame numbers missing in those gaps
+    uint64_t restarts;          // frameNumber went backwards or did not move (radar reset, repeated frame)
+    uint64_t first_rx_ns;       // monotonic time of the first and the latest received bytes
+    uint64_t last_rx_ns;
+} frame_stats_t;
+
+typedef struct frame_reader_s frame_reader_t;
+struct frame_reader_s {
+    int fd;
+    uint8_t *buf;
+    size_t head;      // first byte not yet consumed
+    size_t tail;      // end of received bytes
+    size_t pending;   // length of the frame handed out by the last call
+    capture_t *capture;   // NULL for a plain port
+    int eof;              // replay reached the end of the capture
+    uint64_t rx_ns;       // monotonic time of the last read() from the port
+    int verify_checksum;  // people counting frames: check the header checksum
+    int in_sync;          // a frame was found and no byte skipped since
+    int have_frame_number;
+    uint32_t frame_number;   // frameNumber of the last frame handed out
+    frame_stats_t stats;
+
+    // frame rate and per-frame processing time (hand-out to the next call)
+    uint64_t frames;
+    uint64_t first_ns;
+    uint64_t handout_ns;
+    uint64_t busy_ns_total;
+    uint64_t busy_ns_max;
+};
+
+/*
+r = reader to initialise
+fd = opened serial port (or any readable descriptor)
+return = 0 on success, -1 if the receive buffer cannot be allocated
+*/
+int frame_reader_init(frame_reader_t *r, int fd);
+
+void frame_reader_free(frame_reader_t *r);
+
+/*
+Record what is read from the port, or read from a replay instead of the port.
+c = opened capture (capture_parse_args), CAPTURE_OFF leaves the reader unchanged
+*/
+void frame_reader_set_capture(frame_reader_t *r, capture_t *c);
+
+/*
+Returns the next complete frame, calling read() on the port as often as needed.
+r = reader
+frame = output, points at the magic word of the frame inside the receive buffer.
+        It stays valid until the next call, no copy is made.
+return = frame length in bytes, 0 when read() timed out (VTIME) or hit EOF, -1 on error.
+         At the end of a replay 0 is returned and r->eof is set.
+*/
+int frame_reader_read(frame_reader_t *r, const uint8_t **frame);
+
+/*
+Snapshot of the integrity counters, safe while another thread reads frames.
+Rates over an interval are the difference of two snapshots divided by the
+difference of their last_rx_ns.
+*/
+void frame_reader_stats(const frame_reader_t *r, frame_stats_t *out);
+
+// Print frames, frames/s and the mean / max processing time per frame, then frame_reader_report_stats().
+void frame_reader_report(const frame_reader_t *r);
+
+// Print bytes/s, frames/s, frameNumber gaps and lost frames, resyncs and checksum errors.
+void frame_reader_report_stats(const frame_reader_t *r);
+
+#endif // FRAME_READER_H
@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_ring.h"
+
+#define FRAME_RING_MIN_ROWS 256
+
+int frame_ring_init(frame_ring_t *r, int frames, int cols)
+{
+    memset(r, 0, sizeof(*r));
+    r->frames = frames > 0 ? frames : 1;
+    r->cols = cols > 0 ? cols : 1;
+    r->frame_rows = calloc(r->frames, sizeof(*r->frame_rows));
+    r->buf = malloc((size_t) FRAME_RING_MIN_ROWS * r->cols * sizeof(float));
+    if (r->frame_rows == NULL || r->buf == NULL) {
+        printf("Error allocating the frame ring\n");
+        frame_ring_free(r);
+        return -1;
+    }
+    r->cap = FRAME_RING_MIN_ROWS;
+    return 0;
+}
+
+int frame_ring_push(frame_ring_t *r, const float *rows, unsigned int n)
+{
+    // rows of the oldest frame, leaving if the ring is full
+    unsigned int drop = frame_ring_full(r) ? r->frame_rows[r->oldest_frame] : 0;
+    unsigned int start = r->first + drop;
+    unsigned int keep = r->rows - drop;
+    size_t row_size = (size_t) r->cols * sizeof(float);
+
+    if (start + keep + n > r->cap) {
+        // move the kept rows to the front, growing first if that leaves less than half free
+        if (2 * (keep + n) > r->cap) {
+            unsigned int cap = r->cap;
+            while (cap < 2 * (keep + n))
+                cap <<= 1;
+            float *buf = realloc(r->buf, cap * row_size);
+            if (buf == NULL) {
+                printf("Error allocating the frame ring\n");
+                return -1;
+            }
+            r->buf = buf;
+            r->cap = cap;
+        }
+        memmove(r->buf, r->buf + (size_t) start * r->cols, keep * row_size);
+        start = 0;
+    }
+    if (frame_ring_full(r)) {
+        r->oldest_frame = (r->oldest_frame + 1) % r->frames;
+        r->num_frames--;
+    }
+    memcpy(r->buf + (size_t) (start + keep) * r->cols, rows, n * row_size);
+    r->first = start;
+    r->rows = keep + n;
+    r->frame_rows[(r->oldest_frame + r->num_frames) % r->frames] = n;
+    r->num_frames++;
+    return 0;
+}
+
+void frame_ring_clear(frame_ring_t *r)
+{
+    r->first = 0;
+    r->rows = 0;
+    r->num_frames = 0;
+    r->oldest_frame = 0;
+}
+
+void frame_ring_free(frame_ring_t *r)
+{
+    free(r->frame_rows);
+    free(r->buf);
+    memset(r, 0, sizeof(*r));
+}
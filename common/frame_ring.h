@@ -0,0 +1,68 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+/*
+The point rows of the last N frames (animal clusters the last 3 together), kept
+oldest first in one contiguous block so the window is read in place: a push
+copies the new frame behind the newest one and forgets the oldest by moving the
+start past it, nothing is zeroed or copied back. When the new rows do not fit
+behind the block it is moved to the front of the buffer, which is kept at least
+twice the rows it holds, so that move happens at most once per buffer's worth of
+rows pushed. The buffer grows as needed.
+*/
+
+typedef struct {
+    int cols;                       // floats per row
+    int frames;                     // frames kept
+    int num_frames;
+    int oldest_frame;               // index into frame_rows
+    unsigned int *frame_rows;       // rows of each frame
+    unsigned int first;             // row of the buffer holding the oldest point
+    unsigned int rows;              // rows in the window
+    unsigned int cap;               // rows of the buffer
+    float *buf;
+} frame_ring_t;
+
+/*
+r = ring to set up, zero-initialised or freed
+frames = frames kept, the oldest leaves when one more is pushed
+cols = floats per row
+return = 0, -1 if the buffers cannot be allocated (printed)
+*/
+int frame_ring_init(frame_ring_t *r, int frames, int cols);
+
+/*
+Add a frame, dropping the oldest when the ring is full.
+rows = n rows of cols floats
+return = 0, -1 if the buffer cannot grow (printed, the ring is unchanged)
+*/
+int frame_ring_push(frame_ring_t *r, const float *rows, unsigned int n);
+
+// The window's rows, oldest frame first; valid until the next push.
+static inline const float *frame_ring_rows(const frame_ring_t *r)
+{
+    return r->buf + (size_t) r->first * r->cols;
+}
+
+static inline unsigned int frame_ring_points(const frame_ring_t *r)
+{
+    return r->rows;
+}
+
+static inline int frame_ring_full(const frame_ring_t *r)
+{
+    return r->num_frames == r->frames;
+}
+
+// Rows of the i-th frame held, 0 the oldest.
+static inline unsigned int frame_ring_frame_rows(const frame_ring_t *r, int i)
+{
+    return r->frame_rows[(r->oldest_frame + i) % r->frames];
+}
+
+// Drop every frame, the buffer is kept.
+void frame_ring_clear(frame_ring_t *r);
+
+void frame_ring_free(frame_ring_t *r);
+
+#endif // FRAME_RING_H
@@ -0,0 +1,165 @@
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "grid_index.h"
+
+#define GRID_CELL_LIMIT (1L << 30)   // cell coordinates are clamped, far points share the edge cells
+#define GRID_NO_BUCKET UINT_MAX
+
+static long cell_of(double v, double inv_cell)
+{
+    double c = floor(v * inv_cell);
+    if (c > GRID_CELL_LIMIT)
+        return GRID_CELL_LIMIT;
+    if (c < -GRID_CELL_LIMIT)
+        return -GRID_CELL_LIMIT;
+    return (long) c;
+}
+
+// Rows (y, z) are hashed, the cells of a row take consecutive buckets.
+static unsigned int hash_cell(long cx, long cy, long cz, unsigned int mask)
+{
+    uint32_t h = (uint32_t) cy * 19349663u ^ (uint32_t) cz * 83492791u;
+    return (h + (uint32_t) cx) & mask;
+}
+
+static int grow(unsigned int **p, size_t n)
+{
+    unsigned int *q = (unsigned int *) realloc(*p, n * sizeof(**p));
+    if (q == NULL) {
+        printf("Error allocating the DBSCAN grid\n");
+        return -1;
+    }
+    *p = q;
+    return 0;
+}
+
+int grid_index_build(grid_index_t *g, const double *xyz, size_t stride, unsigned int n, double cell, int dims)
+{
+    size_t nbuckets = 16;
+    while (nbuckets < 2 * (size_t) n)
+        nbuckets <<= 1;
+
+    if (n > g->cap_points) {
+        if (grow(&g->order, n) != 0 || grow(&g->bucket_of, n) != 0 || grow(&g->wild, n) != 0)
+            return -1;
+        g->cap_points = n;
+    }
+    if (nbuckets + 1 > g->cap_buckets) {
+        if (grow(&g->bucket_start, nbuckets + 1) != 0)
+            return -1;
+        g->cap_buckets = nbuckets + 1;
+    }
+    g->num_points = n;
+    g->mask = (unsigned int) nbuckets - 1;
+    g->inv_cell = 1.0 / cell;
+    g->dims = dims;
+    g->nwild = 0;
+    memset(g->bucket_start, 0, (nbuckets + 1) * sizeof(*g->bucket_start));
+
+    // count the points of each bucket
+    const char *base = (const char *) xyz;
+    for (unsigned int i = 0; i < n; i++) {
+        const double *p = (const double *) (base + i * stride);
+        if (!isfinite(p[0]) || !isfinite(p[1]) || (dims == 3 && !isfinite(p[2]))) {
+            g->bucket_of[i] = GRID_NO_BUCKET;
+            g->wild[g->nwild++] = i;
+            continue;
+        }
+        long cz = dims == 3 ? cell_of(p[2], g->inv_cell) : 0;
+        unsigned int b = hash_cell(cell_of(p[0], g->inv_cell), cell_of(p[1], g->inv_cell), cz, g->mask);
+        g->bucket_of[i] = b;
+        g->bucket_start[b]++;
+    }
+    // running sum gives the end of each bucket, filling backwards turns it into the start
+    for (size_t b = 1; b < nbuckets; b++)
+        g->bucket_start[b] += g->bucket_start[b - 1];
+    g->bucket_start[nbuckets] = n - g->nwild;
+    for (unsigned int i = n; i-- > 0;)
+        if (g->bucket_of[i] != GRID_NO_BUCKET)
+            g->order[--g->bucket_start[g->bucket_of[i]]] = i;
+    return 0;
+}
+
+unsigned int grid_index_ranges(const grid_index_t *g, double x, double y, double z, unsigned int (*ranges)[2])
+{
+    unsigned int runs[GRID_INDEX_MAX_RANGES][2];
+    unsigned int nruns = 0, nranges = 0;
+    unsigned int nbuckets = g->mask + 1;
+
+    if (!isfinite(x) || !isfinite(y) || (g->dims == 3 && !isfinite(z))) {
+        ranges[0][0] = 0;
+        ranges[0][1] = g->num_points - g->nwild;
+        return 1;
+    }
+
+    // buckets [b, b + 3) of each row around the query, split where they wrap
+    long cx = cell_of(x, g->inv_cell), cy = cell_of(y, g->inv_cell);
+    long cz = g->dims == 3 ? cell_of(z, g->inv_cell) : 0;
+    int dz_max = g->dims == 3 ? 1 : 0;
+    for (int dz = -dz_max; dz <= dz_max; dz++)
+        for (int dy = -1; dy <= 1; dy++) {
+            unsigned int b = hash_cell(cx - 1, cy + dy, cz + dz, g->mask);
+            runs[nruns][0] = b;
+            runs[nruns++][1] = b + 3 < nbuckets ? b + 3 : nbuckets;
+            if (b + 3 > nbuckets) {
+                runs[nruns][0] = 0;
+                runs[nruns++][1] = b + 3 - nbuckets;
+            }
+        }
+    // two rows can share buckets, merge the sorted runs so every bucket is listed once
+    for (unsigned int i = 1; i < nruns; i++) {
+        unsigned int lo = runs[i][0], hi = runs[i][1], j = i;
+        for (; j > 0 && runs[j - 1][0] > lo; j--) {
+            runs[j][0] = runs[j - 1][0];
+            runs[j][1] = runs[j - 1][1];
+        }
+        runs[j][0] = lo;
+        runs[j][1] = hi;
+    }
+    for (unsigned int i = 0; i < nruns;) {
+        unsigned int lo = runs[i][0], hi = runs[i][1];
+        for (i++; i < nruns && runs[i][0] <= hi; i++)
+            if (runs[i][1] > hi)
+                hi = runs[i][1];
+        if (g->bucket_start[lo] == g->bucket_start[hi])
+            continue;
+        ranges[nranges][0] = g->bucket_start[lo];
+        ranges[nranges][1] = g->bucket_start[hi];
+        nranges++;
+    }
+    return nranges;
+}
+
+unsigned int grid_index_query(const grid_index_t *g, double x, double y, double z, unsigned int *out)
+{
+    unsigned int ranges[GRID_INDEX_MAX_RANGES][2];
+    unsigned int count = 0;
+
+    if (!isfinite(x) || !isfinite(y) || (g->dims == 3 && !isfinite(z))) {
+        for (unsigned int i = 0; i < g->num_points; i++)
+            out[i] = i;
+        return g->num_points;
+    }
+
+    unsigned int nranges = grid_index_ranges(g, x, y, z, ranges);
+    for (unsigned int r = 0; r < nranges; r++)
+        for (unsigned int j = ranges[r][0]; j < ranges[r][1]; j++)
+            out[count++] = g->order[j];
+    for (unsigned int k = 0; k < g->nwild; k++)
+        out[count++] = g->wild[k];
+    return count;
+}
+
+void grid_index_free(grid_index_t *g)
+{
+    free(g->bucket_start);
+    free(g->order);
+    free(g->bucket_of);
+    free(g->wild);
+    memset(g, 0, sizeof(*g));
+}
@@ -0,0 +1,64 @@
+#ifndef GRID_INDEX_H
+#define GRID_INDEX_H
+
+#include <stddef.h>
+
+/*
+Uniform voxel-hash grid for fixed-radius neighbour queries (DBSCAN).
+The cell edge is the query radius, so every point within the radius of a query
+lies in the 27 cells around it (9 in 2D, z ignored). Rows of cells along x are
+hashed into buckets and the cells of a row take consecutive buckets; the point
+indices are counting-sorted by bucket, which makes a build O(n) with no per-point
+allocation, and the 3 cells of a row around a query are one run of the order. A query returns candidates, the caller still
+applies its exact distance test: hash collisions only add candidates.
+The buffers grow to the largest cloud seen and are reused by the next build.
+*/
+
+#define GRID_INDEX_MAX_RANGES 18   // 9 rows, each split at most once where the buckets wrap
+
+typedef struct {
+    unsigned int *bucket_start;   // nbuckets + 1 offsets into order
+    unsigned int *order;          // point indices grouped by bucket
+    unsigned int *bucket_of;      // bucket of each point, build scratch
+    unsigned int *wild;           // non-finite points, candidates of every query
+    unsigned int nwild;
+    unsigned int num_points;
+    unsigned int mask;            // nbuckets - 1
+    size_t cap_points;
+    size_t cap_buckets;
+    double inv_cell;
+    int dims;
+} grid_index_t;
+
+/*
+g = grid, zero-initialised before the first build
+xyz = first x coordinate, y and z follow it as doubles
+stride = bytes from one point's x to the next
+n = number of points
+cell = cell edge, the query radius
+dims = 3, or 2 to ignore z
+return = 0, -1 if the buffers cannot be allocated (printed)
+*/
+int grid_index_build(grid_index_t *g, const double *xyz, size_t stride, unsigned int n, double cell, int dims);
+
+/*
+Indices of the points in the cells around (x, y, z), each at most once, in no particular order.
+A non-finite query gets every point, like a linear scan where no distance test can reject it.
+out = room for the n points of the last build
+return = number of candidates
+*/
+unsigned int grid_index_query(const grid_index_t *g, double x, double y, double z, unsigned int *out);
+
+/*
+The same cells as order ranges [ranges[r][0], ranges[r][1]), one per row (3 in 2D)
+unless rows share buckets, empty ones left out. A caller can keep per-point data
+in this order and scan a run without indirection. The wild points are not included.
+A non-finite query gets the single range of every finite point.
+ranges = room for GRID_INDEX_MAX_RANGES ranges
+return = number of ranges
+*/
+unsigned int grid_index_ranges(const grid_index_t *g, double x, double y, double z, unsigned int (*ranges)[2]);
+
+void grid_index_free(grid_index_t *g);
+
+#endif // GRID_INDEX_H
@@ -0,0 +1,15 @@
+#ifndef MONO_CLOCK_H
+#define MONO_CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Monotonic time in nanoseconds, used for receive timestamps and stage timing.
+static inline uint64_t mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+#endif // MONO_CLOCK_H
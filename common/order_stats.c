@@ -0,0 +1,102 @@
+#include <stdlib.h>
+
+#include "order_stats.h"
+
+static void swap(float *a, int i, int j)
+{
+    float t = a[i];
+    a[i] = a[j];
+    a[j] = t;
+}
+
+static int compare_float(const void *a, const void *b)
+{
+    float fa = *(const float *) a, fb = *(const float *) b;
+    return (fa > fb) - (fa < fb);
+}
+
+float order_select(float *a, unsigned int n, unsigned int k)
+{
+    int lo = 0, hi = (int) n - 1, target = (int) k;
+    int depth = 8;
+
+    for (unsigned int m = n; m > 1; m >>= 1)
+        depth += 2;
+    while (lo < hi) {
+        if (depth-- == 0) {
+            qsort(a + lo, hi - lo + 1, sizeof(*a), compare_float);
+            break;
+        }
+        // median of three, which also leaves a sentinel at each end
+        int mid = lo + (hi - lo) / 2;
+        if (a[mid] < a[lo])
+            swap(a, lo, mid);
+        if (a[hi] < a[lo])
+            swap(a, lo, hi);
+        if (a[hi] < a[mid])
+            swap(a, mid, hi);
+        float pivot = a[mid];
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (a[i] < pivot)
+                i++;
+            while (pivot < a[j])
+                j--;
+            if (i <= j)
+                swap(a, i++, j--);
+        }
+        // a[lo .. j] <= pivot, a[i .. hi] >= pivot, anything between equals it
+        if (target <= j)
+            hi = j;
+        else if (target >= i)
+            lo = i;
+        else
+            break;
+    }
+    return a[target];
+}
+
+// largest of a[0 .. n), n > 0
+static float max_of(const float *a, unsigned int n)
+{
+    float m = a[0];
+    for (unsigned int i = 1; i < n; i++)
+        if (a[i] > m)
+            m = a[i];
+    return m;
+}
+
+void order_quartiles(float *a, unsigned int n, order_quartiles_t *q)
+{
+    float sum = 0;
+    for (unsigned int i = 0; i < n; i++)
+        sum += a[i];
+    q->mean = sum / n;
+
+    unsigned int floor_q1 = n / 4, ceil_q1 = (n + 3) / 4;
+    unsigned int floor_q3 = 3 * n / 4, ceil_q3 = (3 * n + 3) / 4;
+    if (ceil_q1 > n - 1)
+        ceil_q1 = n - 1;
+    if (floor_q3 > n - 1)
+        floor_q3 = n - 1;
+    if (ceil_q3 > n - 1)
+        ceil_q3 = n - 1;
+    // the highest rank first, every lower one is then on its left; a floor one
+    // below its ceiling is the largest value left of the ceiling
+    float c3 = order_select(a, n, ceil_q3);
+    float f3 = floor_q3 < ceil_q3 ? max_of(a, ceil_q3) : c3;
+    float c1 = ceil_q1 < ceil_q3 ? order_select(a, ceil_q3, ceil_q1) : c3;
+    float f1 = floor_q1 < ceil_q1 ? max_of(a, ceil_q1) : c1;
+    q->q1 = (c1 + f1) / 2;
+    q->q3 = (c3 + f3) / 2;
+}
+
+void order_quartiles_rows(const float *pos, int stride, const unsigned int *index, unsigned int n,
+                          int cols, float *scratch, order_quartiles_t *q)
+{
+    for (int c = 0; c < cols; c++) {
+        for (unsigned int i = 0; i < n; i++)
+            scratch[i] = pos[(size_t) (index != NULL ? index[i] : i) * stride + c];
+        order_quartiles(scratch, n, &q[c]);
+    }
+}
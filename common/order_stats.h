@@ -0,0 +1,43 @@
+#ifndef ORDER_STATS_H
+#define ORDER_STATS_H
+
+/*
+Order statistics of the few hundred values a frame looks at (the largest
+cluster's x, y and z) without sorting them: quickselect puts just the wanted
+ranks in place, expected O(n), falling back to a sort of what is left when the
+pivots keep coming out bad, so the worst case stays O(n log n).
+Quartiles follow the rule the pipelines always used on the sorted values a[]:
+with q = n / 4 (3n / 4 for Q3), Q = (a[ceil(q)] + a[floor(q)]) / 2, indices
+past the end taken as n - 1 (only happens below 4 values). The values equal
+those read off a qsort, the order statistics being the same numbers.
+*/
+
+typedef struct {
+    float q1;
+    float q3;
+    float mean;
+} order_quartiles_t;
+
+/*
+k-th smallest of a[0 .. n), k < n. a is reordered so that nothing left of k is
+larger and nothing right of k is smaller.
+*/
+float order_select(float *a, unsigned int n, unsigned int k);
+
+/*
+Quartiles and mean of n > 0 values.
+a = the values, reordered
+*/
+void order_quartiles(float *a, unsigned int n, order_quartiles_t *q);
+
+/*
+order_quartiles() of the first cols columns of some rows, one column at a time.
+pos = rows of stride floats
+index = the n rows to use, NULL for rows 0 .. n - 1
+scratch = room for n floats
+q = cols results
+*/
+void order_quartiles_rows(const float *pos, int stride, const unsigned int *index, unsigned int n,
+                          int cols, float *scratch, order_quartiles_t *q);
+
+#endif // ORDER_STATS_H
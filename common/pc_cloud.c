@@ -0,0 +1,52 @@
+#define _GNU_SOURCE               // sincosf
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pc_cloud.h"
+
+int pc_cloud_build(pc_cloud_t *c, const pc_frame_t *pc, float snr_min, float z_offset)
+{
+    const pc_point_unit_t *u = &pc->unit;
+    unsigned int n = 0;
+
+    c->num_points = 0;
+    c->dropped = 0;
+    if (pc->num_points > 0 && (unsigned int) pc->num_points > c->cap) {
+        void *rows = realloc(c->rows, pc->num_points * sizeof(*c->rows));
+        if (rows == NULL) {
+            printf("Error allocating the point cloud\n");
+            return -1;
+        }
+        c->rows = rows;
+        c->cap = pc->num_points;
+    }
+    for (int i = 0; i < pc->num_points; i++) {
+        pc_point_t pt;
+        memcpy(&pt, pc->points + i * sizeof(pt), sizeof(pt));
+        float snr = pt.snr * u->snrUnit;
+        if (!(snr > snr_min))
+            continue;
+        float range = pt.range * u->rangeUnit;
+        float sin_e, cos_e, sin_a, cos_a;
+        sincosf(pt.elevation * u->elevationUnit, &sin_e, &cos_e);
+        sincosf(pt.azimuth * u->azimuthUnit, &sin_a, &cos_a);
+        float *r = c->rows[n++];
+        r[0] = range * cos_e * sin_a;
+        r[1] = range * cos_e * cos_a;
+        r[2] = range * sin_e + z_offset;
+        r[3] = range;
+        r[4] = pt.doppler * u->dopplerUnit;
+        r[5] = snr;
+    }
+    c->num_points = n;
+    c->dropped = pc->num_points - n;
+    return n;
+}
+
+void pc_cloud_free(pc_cloud_t *c)
+{
+    free(c->rows);
+    memset(c, 0, sizeof(*c));
+}
@@ -0,0 +1,37 @@
+#ifndef PC_CLOUD_H
+#define PC_CLOUD_H
+
+#include "pc_tlv.h"
+
+/*
+Point cloud of a frame as the later stages read it, one row per point:
+x, y, z, range, doppler, snr. The packed TLV records are decoded, SNR filtered
+and turned into coordinates in one pass, with float sincosf, into a buffer that
+stays with its owner (one per radar) and only grows, to the largest frame seen.
+Rows rather than one array per column because every consumer (dbscan_labels(),
+cluster_stats_build(), pc_targets_label_points()) takes rows with a stride.
+*/
+
+#define PC_CLOUD_COLS 6           // x, y, z, range, doppler, snr
+#define PC_CLOUD_RANGE 3          // column of the range
+#define PC_CLOUD_DOPPLER 4        // column of the doppler, for cluster_stats
+
+typedef struct {
+    float (*rows)[PC_CLOUD_COLS];
+    unsigned int num_points;      // rows of the last frame
+    unsigned int dropped;         // points of the last frame at or below the SNR threshold
+    unsigned int cap;
+} pc_cloud_t;
+
+/*
+Fill c with the points of pc whose snr is above snr_min, in TLV order.
+x = range cos(elevation) sin(azimuth), y = range cos(elevation) cos(azimuth),
+z = range sin(elevation) + z_offset
+c = zero-initialised or used before
+return = number of points kept, -1 if the buffer cannot grow (printed, c is empty)
+*/
+int pc_cloud_build(pc_cloud_t *c, const pc_frame_t *pc, float snr_min, float z_offset);
+
+void pc_cloud_free(pc_cloud_t *c);
+
+#endif // PC_CLOUD_H
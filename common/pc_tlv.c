@@ -0,0 +1,103 @@
+#include <string.h>
+
+#include "pc_tlv.h"
+
+typedef int (*tlv_parser_fn)(const uint8_t *payload, uint32_t len, pc_frame_t *out);
+
+static int parse_point_cloud(const uint8_t *payload, uint32_t len, pc_frame_t *out)
+{
+    if (len < sizeof(pc_point_unit_t))
+        return -1;
+    decode_pc_point_unit(payload, &out->unit);
+    out->points = payload + sizeof(pc_point_unit_t);
+    out->num_points = (len - sizeof(pc_point_unit_t)) / sizeof(pc_point_t);
+    return 0;
+}
+
+static int parse_target_list(const uint8_t *payload, uint32_t len, pc_frame_t *out)
+{
+    out->has_targets = 1;
+    out->targets = payload;
+    out->num_targets = len / sizeof(pc_target_t);
+    return 0;
+}
+
+static int parse_target_index(const uint8_t *payload, uint32_t len, pc_frame_t *out)
+{
+    out->target_index = payload;
+    out->num_index = len;
+    return 0;
+}
+
+static const struct {
+    uint32_t type;
+    tlv_parser_fn parse;
+} tlv_parsers[] = {
+    { PC_TLV_POINT_CLOUD, parse_point_cloud },
+    { PC_TLV_TARGET_LIST, parse_target_list },
+    { PC_TLV_TARGET_INDEX, parse_target_index },
+};
+
+int pc_parse_frame(const uint8_t *frame, int size, pc_frame_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (size < PC_HEADER_LEN)
+        return -1;
+    decode_pc_header(frame, &out->header);
+
+    int off = PC_TLV_OFFSET;
+    for (int i = 0; i < out->header.numTLVs; i++) {
+        tlv_header_t tlv;
+        if (off + (int) sizeof(tlv) > size)
+            return -1;
+        decode_tlv_header(frame + off, &tlv);
+        // tlvLength includes its 8 byte header
+        if (tlv.length < sizeof(tlv) || tlv.length > PC_TLV_MAX_LEN || off + (int) tlv.length > size)
+            return -1;
+
+        size_t k;
+        for (k = 0; k < sizeof(tlv_parsers) / sizeof(tlv_parsers[0]); k++)
+            if (tlv_parsers[k].type == tlv.type)
+                break;
+        if (k < sizeof(tlv_parsers) / sizeof(tlv_parsers[0])) {
+            if (tlv_parsers[k].parse(frame + off + sizeof(tlv), tlv.length - sizeof(tlv), out) != 0)
+                return -1;
+        } else {
+            out->skipped_tlvs++;
+        }
+        out->num_tlvs++;
+        off += tlv.length;
+    }
+    return 0;
+}
+
+int pc_targets_label_points(const pc_frame_t *pc, const float *pos, int stride, int n, float gate, int *labels)
+{
+    float tx[PC_TLV_MAX_LEN / sizeof(pc_target_t)], ty[PC_TLV_MAX_LEN / sizeof(pc_target_t)];
+    float gate2 = gate * gate;
+    int claimed = 0;
+
+    // positions decoded once, the point loop only compares
+    for (int t = 0; t < pc->num_targets; t++) {
+        pc_target_t target;
+        decode_pc_target(pc->targets, t, &target);
+        tx[t] = target.posX;
+        ty[t] = target.posY;
+    }
+    for (int i = 0; i < n; i++) {
+        const float *p = pos + (size_t) i * stride;
+        float best = gate2;
+        labels[i] = PC_TARGET_NOISE;
+        for (int t = 0; t < pc->num_targets; t++) {
+            float dx = p[0] - tx[t];
+            float dy = p[1] - ty[t];
+            float d2 = dx * dx + dy * dy;
+            if (d2 <= best) {
+                best = d2;
+                labels[i] = t;
+            }
+        }
+        claimed += labels[i] != PC_TARGET_NOISE;
+    }
+    return claimed;
+}
@@ -0,0 +1,55 @@
+#ifndef PC_TLV_H
+#define PC_TLV_H
+
+#include <stdint.h>
+
+#include "radar_decode.h"
+
+/*
+People counting / animal frame walker.
+The frame header gives numTLVs, every TLV is visited in order and handed to the
+parser registered for its type in a table; types without a parser are skipped by
+their length. Parsers only record where their records start and how many there
+are, the caller decodes what it needs.
+*/
+
+#define PC_TLV_MAX_LEN 10000      // longer TLVs are treated as a broken frame
+#define PC_TARGET_NOISE -2        // label of a point no target claims, same as DBSCAN NOISE
+
+typedef struct {
+    pc_frame_header_t header;
+    int num_tlvs;                 // TLVs walked
+    int skipped_tlvs;             // TLVs without a parser
+    pc_point_unit_t unit;
+    const uint8_t *points;        // type 6: packed pc_point_t records
+    int num_points;
+    int has_targets;              // type 7 present, the radar-side tracker is running
+    const uint8_t *targets;       // type 7: packed pc_target_t records
+    int num_targets;
+    const uint8_t *target_index;  // type 8: target id of each point of the previous frame
+    int num_index;
+} pc_frame_t;
+
+/*
+Walk all TLVs of a frame.
+frame = complete frame starting with the magic word
+size = frame length in bytes
+out = pointers into frame, valid as long as frame is
+return = 0 on success, -1 if the header or a TLV does not fit the frame
+*/
+int pc_parse_frame(const uint8_t *frame, int size, pc_frame_t *out);
+
+/*
+Label points with the radar tracker instead of clustering them on the host.
+The target index TLV refers to the previous frame's points, so the points of this
+frame are gated against the type 7 target positions: each point gets the index in the
+target list of the nearest target within gate metres in the xy plane, PC_TARGET_NOISE
+otherwise. Labels are therefore dense, 0 .. num_targets-1, whatever tids the radar
+sends; the tid of label k is decode_pc_target(pc->targets, k, ...).tid.
+pos = points as [x, y, z, ...], stride floats per point
+labels = output, one label per point
+return = number of points claimed by a target
+*/
+int pc_targets_label_points(const pc_frame_t *pc, const float *pos, int stride, int n, float gate, int *labels);
+
+#endif // PC_TLV_H
@@ -0,0 +1,245 @@
+#ifndef RADAR_DECODE_H
+#define RADAR_DECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+Wire layouts of the TI mmWave UART frames, decoded with memcpy into packed structs.
+The radar sends little-endian data and both the Jetson (aarch64) and desktop hosts
+are little-endian, so a memcpy is the whole decode: no per-bit IEEE-754 rebuild.
+Every layout size is checked at compile time against the byte offsets used by the parsers.
+*/
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "radar_decode.h assumes a little-endian host"
+#endif
+
+#define RADAR_PACKED __attribute__((packed))
+
+/* ---------------- People counting / animal (3D people counting demo) ---------------- */
+
+// struct.unpack('Q9I2H') : magic word + 9 uint32 + numTLVs + checksum
+typedef struct RADAR_PACKED {
+    uint8_t magic[8];
+    uint32_t version;
+    uint32_t totalPackLen;
+    uint32_t platform;
+    uint32_t frameNumber;
+    uint32_t subframeNumber;
+    uint32_t chirpMargin;
+    uint32_t frameMargin;
+    uint32_t trackProcessTime;
+    uint32_t uartSendTime;
+    uint16_t numTLVs;
+    uint16_t checksum;
+} pc_frame_header_t;
+
+// struct.unpack('2I') : ttype, tlvLength (tlvLength includes this header)
+typedef struct RADAR_PACKED {
+    uint32_t type;
+    uint32_t length;
+} tlv_header_t;
+
+// struct.unpack('5f') : scale of each point field
+typedef struct RADAR_PACKED {
+    float elevationUnit;
+    float azimuthUnit;
+    float dopplerUnit;
+    float rangeUnit;
+    float snrUnit;
+} pc_point_unit_t;
+
+// struct.unpack('2b3h') : one compressed point
+typedef struct RADAR_PACKED {
+    int8_t elevation;
+    int8_t azimuth;
+    int16_t doppler;
+    int16_t range;
+    int16_t snr;
+} pc_point_t;
+
+// struct.unpack('I27f') : one tracked target (tid, pos, vel, acc, ec[16], g, confidenceLevel)
+typedef struct RADAR_PACKED {
+    uint32_t tid;
+    float posX, posY, posZ;
+    float velX, velY, velZ;
+    float accX, accY, accZ;
+    float ec[16];
+    float g;
+    float confidenceLevel;
+} pc_target_t;
+
+#define PC_HEADER_LEN 48
+#define PC_TLV_OFFSET PC_HEADER_LEN
+#define PC_UNIT_OFFSET (PC_TLV_OFFSET + 8)
+#define PC_POINT_OFFSET (PC_UNIT_OFFSET + 20)
+#define PC_TLV_POINT_CLOUD 6
+#define PC_TLV_TARGET_LIST 7
+#define PC_TLV_TARGET_INDEX 8     // one uint8 target id per point of the previous frame
+#define PC_TARGET_INDEX_NONE 253  // 253..255: point not associated with a target
+
+_Static_assert(sizeof(pc_frame_header_t) == PC_HEADER_LEN, "pc_frame_header_t must be 48 bytes");
+_Static_assert(sizeof(tlv_header_t) == 8, "tlv_header_t must be 8 bytes");
+_Static_assert(sizeof(pc_point_unit_t) == 20, "pc_point_unit_t must be 20 bytes");
+_Static_assert(sizeof(pc_point_t) == 8, "pc_point_t must be 8 bytes");
+_Static_assert(sizeof(pc_target_t) == 112, "pc_target_t must be 112 bytes");
+
+/* ---------------- Vital signs ---------------- */
+
+typedef struct RADAR_PACKED {
+    uint8_t magic[8];
+    uint32_t version;
+    uint32_t totalPacketLen;
+    uint32_t platform;
+    uint32_t frameNumber;
+    uint32_t timeCpuCycles;
+    uint32_t numDetectedObj;
+    uint32_t numTLVs;
+    uint32_t subFrameNumber;
+} vs_frame_header_t;
+
+// TLV payload of the vital signs output stats, 128 bytes
+typedef struct RADAR_PACKED {
+    uint16_t rangeBinIndexMax;
+    uint16_t rangeBinIndexPhase;
+    float maxVal;
+    uint16_t processingCyclesOut[2];
+    uint16_t rangeBinStartIndex;
+    uint16_t rangeBinEndIndex;
+    float unwrapPhasePeak_mm;
+    float outputFilterBreathOut;
+    float outputFilterHeartOut;
+    float heartRateEst_FFT;
+    float heartRateEst_FFT_4Hz;
+    float heartRateEst_xCorr;
+    float heartRateEst_peakCount;
+    float breathingRateEst_FFT;
+    float breathingEst_xCorr;
+    float breathingEst_peakCount;
+    float confidenceMetricBreathOut;
+    float confidenceMetricBreathOut_xCorr;
+    float confidenceMetricHeartOut;
+    float confidenceMetricHeartOut_4Hz;
+    float confidenceMetricHeartOut_xCorr;
+    float sumEnergyBreathWfm;
+    float sumEnergyHeartWfm;
+    float motionDetectedFlag;
+    float breathingRateEst_harmonicEnergy;
+    float heartRateEst_harmonicEnergy;
+    float reserved[7];
+    uint32_t padding;
+} vs_output_stats_t;
+
+#define VS_HEADER_LEN 40
+#define VS_STATS_OFFSET (VS_HEADER_LEN + 8)
+#define VS_RANGE_PROFILE_OFFSET (VS_STATS_OFFSET + 128 + 8)
+#define VS_RANGE_PROFILE_LEN 126
+#define VS_FRAME_LEN (VS_RANGE_PROFILE_OFFSET + 2 * VS_RANGE_PROFILE_LEN)
+#define VS_ARRAY_LEN 34
+
+_Static_assert(sizeof(vs_frame_header_t) == VS_HEADER_LEN, "vs_frame_header_t must be 40 bytes");
+_Static_assert(sizeof(vs_output_stats_t) == 128, "vs_output_stats_t must be 128 bytes");
+_Static_assert(VS_FRAME_LEN == 436, "vital signs frame must end at byte 436");
+
+/* ---------------- Decoders ---------------- */
+
+static inline void decode_pc_header(const uint8_t *frame, pc_frame_header_t *h)
+{
+    memcpy(h, frame, sizeof(*h));
+}
+
+/*
+Header checksum of the people counting frames: ones' complement sum of the 24
+uint16 words of the header. The radar stores the complement of the sum taken with
+checksum = 0, so the sum over the whole received header folds to 0xFFFF.
+*/
+static inline uint16_t pc_header_sum(const uint8_t *frame)
+{
+    uint32_t sum = 0;
+    for (int i = 0; i < PC_HEADER_LEN; i += 2)
+        sum += (uint32_t) frame[i] | ((uint32_t) frame[i + 1] << 8);
+    sum = (sum >> 16) + (sum & 0xFFFF);
+    sum += sum >> 16;
+    return (uint16_t) sum;
+}
+
+// Value to put into checksum, h->checksum must be 0 when called.
+static inline uint16_t pc_header_checksum(const pc_frame_header_t *h)
+{
+    return (uint16_t) ~pc_header_sum((const uint8_t *) h);
+}
+
+static inline int pc_header_checksum_ok(const uint8_t *frame)
+{
+    return pc_header_sum(frame) == 0xFFFF;
+}
+
+static inline void decode_tlv_header(const uint8_t *p, tlv_header_t *t)
+{
+    memcpy(t, p, sizeof(*t));
+}
+
+static inline void decode_pc_point_unit(const uint8_t *p, pc_point_unit_t *u)
+{
+    memcpy(u, p, sizeof(*u));
+}
+
+/*
+Decode and scale the points of a point cloud TLV.
+p = first point record (frame + PC_POINT_OFFSET)
+n = number of points
+u = units of this TLV
+out = output, [elevation, azimuth, doppler, range, snr] per point
+*/
+static inline void decode_pc_points(const uint8_t *p, int n, const pc_point_unit_t *u, float (*out)[5])
+{
+    for (int i = 0; i < n; i++) {
+        pc_point_t pt;
+        memcpy(&pt, p + i * sizeof(pt), sizeof(pt));
+        out[i][0] = pt.elevation * u->elevationUnit;
+        out[i][1] = pt.azimuth * u->azimuthUnit;
+        out[i][2] = pt.doppler * u->dopplerUnit;
+        out[i][3] = pt.range * u->rangeUnit;
+        out[i][4] = pt.snr * u->snrUnit;
+    }
+}
+
+static inline void decode_pc_target(const uint8_t *p, int i, pc_target_t *t)
+{
+    memcpy(t, p + i * sizeof(*t), sizeof(*t));
+}
+
+static inline void decode_vs_header(const uint8_t *frame, vs_frame_header_t *h)
+{
+    memcpy(h, frame, sizeof(*h));
+}
+
+static inline void decode_vs_stats(const uint8_t *frame, vs_output_stats_t *s)
+{
+    memcpy(s, frame + VS_STATS_OFFSET, sizeof(*s));
+}
+
+/*
+Flatten the vital signs stats into the vsos_array[34] index layout used by the pipelines:
+0-1 range bins, 2 maxVal, 3-6 uint16 fields, 7-33 the 27 floats from unwrapPhasePeak_mm on.
+*/
+static inline void vs_stats_to_array(const vs_output_stats_t *s, float *vsos_array)
+{
+    vsos_array[0] = s->rangeBinIndexMax;
+    vsos_array[1] = s->rangeBinIndexPhase;
+    vsos_array[2] = s->maxVal;
+    vsos_array[3] = s->processingCyclesOut[0];
+    vsos_array[4] = s->processingCyclesOut[1];
+    vsos_array[5] = s->rangeBinStartIndex;
+    vsos_array[6] = s->rangeBinEndIndex;
+    memcpy(&vsos_array[7], (const uint8_t *) s + offsetof(vs_output_stats_t, unwrapPhasePeak_mm), 27 * sizeof(float));
+}
+
+static inline void decode_vs_range_profile(const uint8_t *frame, short int *range_profile)
+{
+    memcpy(range_profile, frame + VS_RANGE_PROFILE_OFFSET, VS_RANGE_PROFILE_LEN * sizeof(short int));
+}
+
+#endif // RADAR_DECODE_H
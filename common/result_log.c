@@ -0,0 +1,219 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mono_clock.h"
+#include "result_log.h"
+
+static int flush_ms = 1000;
+static result_log_fsync_t fsync_policy = RESULT_LOG_FSYNC_NEVER;
+static size_t batch_bytes = 64 * 1024;
+
+void result_log_config(int argc, char *argv[])
+{
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--log-flush-ms") == 0 && atoi(argv[i + 1]) > 0)
+            flush_ms = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--log-buffer-kb") == 0 && atoi(argv[i + 1]) > 0)
+            batch_bytes = (size_t) atoi(argv[i + 1]) * 1024;
+        else if (strcmp(argv[i], "--log-fsync") == 0) {
+            if (strcmp(argv[i + 1], "flush") == 0)
+                fsync_policy = RESULT_LOG_FSYNC_FLUSH;
+            else if (strcmp(argv[i + 1], "close") == 0)
+                fsync_policy = RESULT_LOG_FSYNC_CLOSE;
+            else
+                fsync_policy = RESULT_LOG_FSYNC_NEVER;
+        }
+    }
+}
+
+// Whole buffer to the file, 0 or -1 (counted and printed once by the caller).
+static int write_all(int fd, const char *p, size_t n)
+{
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += w;
+        n -= (size_t) w;
+    }
+    return 0;
+}
+
+static void *flush_thread(void *arg)
+{
+    result_log_t *log = arg;
+
+    pthread_mutex_lock(&log->lock);
+    for (;;) {
+        if (!log->stop && log->len < log->cap / 2) {
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_sec += log->flush_ms / 1000;
+            until.tv_nsec += (log->flush_ms % 1000) * 1000000L;
+            if (until.tv_nsec >= 1000000000L) {
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&log->wake, &log->lock, &until);
+        }
+        int stop = log->stop;
+        if (log->len > 0) {
+            // swap batches, writers go on filling the other one while this one is written
+            char *out = log->batch[log->fill];
+            size_t n = log->len;
+            log->fill ^= 1;
+            log->len = 0;
+            pthread_cond_broadcast(&log->drained);
+            pthread_mutex_unlock(&log->lock);
+            int err = write_all(log->fd, out, n);
+            int synced = 0;
+            if (err == 0 && log->fsync_policy == RESULT_LOG_FSYNC_FLUSH) {
+                err = fsync(log->fd);
+                synced = 1;
+            }
+            if (err != 0)
+                fprintf(stderr, "Error writing %s: %s\n", log->path, strerror(errno));
+            pthread_mutex_lock(&log->lock);
+            log->flushes++;
+            log->fsyncs += synced;
+            log->errors += err != 0;
+            // the batch written is free again, a writer may be waiting for it
+            pthread_cond_broadcast(&log->drained);
+            continue;
+        }
+        if (stop)
+            break;
+    }
+    pthread_mutex_unlock(&log->lock);
+    return NULL;
+}
+
+int result_log_open(result_log_t *log, const char *path, const char *mode)
+{
+    memset(log, 0, sizeof(*log));
+    snprintf(log->path, sizeof(log->path), "%s", path);
+    log->flush_ms = flush_ms;
+    log->fsync_policy = fsync_policy;
+    log->cap = batch_bytes;
+    log->fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (mode[0] == 'w' ? O_TRUNC : 0), 0644);
+    if (log->fd < 0) {
+        printf("Error %i from open %s: %s\n", errno, path, strerror(errno));
+        return -1;
+    }
+    log->batch[0] = malloc(log->cap);
+    log->batch[1] = malloc(log->cap);
+    if (log->batch[0] == NULL || log->batch[1] == NULL) {
+        printf("Error allocating log buffers\n");
+        result_log_close(log);
+        return -1;
+    }
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_cond_init(&log->wake, NULL);
+    pthread_cond_init(&log->drained, NULL);
+    if (pthread_create(&log->thread, NULL, flush_thread, log) != 0) {
+        printf("Error starting log thread\n");
+        result_log_close(log);
+        return -1;
+    }
+    log->running = 1;
+    return 0;
+}
+
+int result_log_printf(result_log_t *log, const char *fmt, ...)
+{
+    char line[512];
+    va_list ap;
+
+    // format outside the lock, only the copy is serialised
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n < 0)
+        return -1;
+    char *text = line;
+    char *big = NULL;
+    if ((size_t) n >= sizeof(line)) {
+        big = malloc((size_t) n + 1);
+        if (big == NULL)
+            return -1;
+        va_start(ap, fmt);
+        vsnprintf(big, (size_t) n + 1, fmt, ap);
+        va_end(ap);
+        text = big;
+    }
+
+    pthread_mutex_lock(&log->lock);
+    if ((size_t) n > log->cap) {
+        log->dropped++;
+        pthread_mutex_unlock(&log->lock);
+        free(big);
+        return -1;
+    }
+    if (log->len + n > log->cap) {
+        uint64_t t0 = mono_ns();
+        log->stalls++;
+        while (log->len + n > log->cap) {
+            pthread_cond_signal(&log->wake);
+            pthread_cond_wait(&log->drained, &log->lock);
+        }
+        log->stall_ns += mono_ns() - t0;
+    }
+    memcpy(log->batch[log->fill] + log->len, text, (size_t) n);
+    log->len += n;
+    log->lines++;
+    log->bytes += n;
+    if (log->len > log->max_fill)
+        log->max_fill = log->len;
+    if (log->len >= log->cap / 2)
+        pthread_cond_signal(&log->wake);
+    pthread_mutex_unlock(&log->lock);
+    free(big);
+    return n;
+}
+
+void result_log_report(result_log_t *log)
+{
+    int locked = log->running;
+    if (locked)
+        pthread_mutex_lock(&log->lock);
+    fprintf(stderr, "log %s: %lu lines, %llu bytes, %lu flushes, %lu fsyncs, largest batch %zu of %zu bytes, "
+            "%lu stalls (%.1f ms), %lu dropped, %lu errors\n",
+            log->path, log->lines, log->bytes, log->flushes, log->fsyncs, log->max_fill, log->cap,
+            log->stalls, log->stall_ns / 1e6, log->dropped, log->errors);
+    if (locked)
+        pthread_mutex_unlock(&log->lock);
+}
+
+void result_log_close(result_log_t *log)
+{
+    if (log->running) {
+        pthread_mutex_lock(&log->lock);
+        log->stop = 1;
+        pthread_cond_signal(&log->wake);
+        pthread_mutex_unlock(&log->lock);
+        pthread_join(log->thread, NULL);
+        log->running = 0;
+        pthread_mutex_destroy(&log->lock);
+        pthread_cond_destroy(&log->wake);
+        pthread_cond_destroy(&log->drained);
+    }
+    if (log->fd >= 0) {
+        if (log->fsync_policy == RESULT_LOG_FSYNC_CLOSE && fsync(log->fd) == 0)
+            log->fsyncs++;
+        close(log->fd);
+        log->fd = -1;
+    }
+    free(log->batch[0]);
+    free(log->batch[1]);
+    log->batch[0] = NULL;
+    log->batch[1] = NULL;
+}
@@ -0,0 +1,79 @@
+#ifndef RESULT_LOG_H
+#define RESULT_LOG_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Result csv writer that keeps the file open and takes the disk off the frame loop.
+result_log_printf() formats into an in-memory batch under a mutex; a thread per
+file swaps the batch out and writes it with one write() every flush interval, or
+as soon as the batch is half full, and fsyncs it as the policy says. A writer
+that finds the batch full waits for the flush (counted, with the time lost), so
+no line is dropped unless it alone is larger than the batch.
+Lines reach the file at most one interval late; a process killed outright loses
+what it has not flushed, result_log_close() writes everything out.
+Process-wide settings come from the command line:
+--log-flush-ms N            flush interval, default 1000
+--log-fsync never|flush|close   when to fsync, default never (the old fclose behaviour)
+--log-buffer-kb N           batch size, default 64
+*/
+
+typedef enum {
+    RESULT_LOG_FSYNC_NEVER,
+    RESULT_LOG_FSYNC_FLUSH,         // after every flush
+    RESULT_LOG_FSYNC_CLOSE,         // once, when closing
+} result_log_fsync_t;
+
+typedef struct {
+    int fd;
+    char path[128];
+    pthread_t thread;
+    int running;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;            // flusher: batch half full or closing
+    pthread_cond_t drained;         // writers waiting for room
+    char *batch[2];                 // the one being filled and the one being written
+    int fill;                       // index of the one being filled
+    size_t len;
+    size_t cap;
+    int stop;
+    int flush_ms;
+    result_log_fsync_t fsync_policy;
+    // counters, under lock
+    unsigned long lines;
+    unsigned long long bytes;
+    unsigned long flushes;
+    unsigned long fsyncs;
+    unsigned long stalls;           // writers that waited for a flush
+    uint64_t stall_ns;
+    unsigned long dropped;          // lines larger than the batch
+    unsigned long errors;           // failed write / fsync
+    size_t max_fill;
+} result_log_t;
+
+// Read the --log-* options, they apply to logs opened afterwards.
+void result_log_config(int argc, char *argv[]);
+
+/*
+log = log to open, its thread is started
+path = file name
+mode = "w" to truncate, "a" to append
+return = 0, -1 if the file, buffers or thread cannot be set up (printed)
+*/
+int result_log_open(result_log_t *log, const char *path, const char *mode);
+
+/*
+Append formatted text, usually one csv line.
+return = bytes added, -1 if the line was dropped
+*/
+int result_log_printf(result_log_t *log, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// Counters to stderr, also after result_log_close() for the final numbers.
+void result_log_report(result_log_t *log);
+
+// Write out what is left, fsync as configured, stop the thread and close the file.
+void result_log_close(result_log_t *log);
+
+#endif // RESULT_LOG_H
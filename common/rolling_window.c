@@ -0,0 +1,70 @@
+#include <stddef.h>
+
+#include "rolling_window.h"
+
+void rolling_window_init(rolling_window_t *w, int capacity)
+{
+    if (capacity < 1)
+        capacity = 1;
+    if (capacity > ROLLING_WINDOW_MAX)
+        capacity = ROLLING_WINDOW_MAX;
+    w->cap = capacity;
+    rolling_window_clear(w);
+}
+
+void rolling_window_clear(rolling_window_t *w)
+{
+    w->count = 0;
+    w->head = 0;
+    w->next_seq = 0;
+    w->sum = 0.0;
+    w->min_head = w->min_n = 0;
+    w->max_head = w->max_n = 0;
+}
+
+// slot i of a deque, i counted from its head
+static inline int deque_slot(const rolling_window_t *w, int head, int i)
+{
+    int slot = head + i;
+    return slot >= w->cap ? slot - w->cap : slot;
+}
+
+int rolling_window_push(rolling_window_t *w, float v, float *evicted)
+{
+    int dropped = 0;
+    if (w->count == w->cap) {
+        float old = w->v[w->head];
+        w->sum -= old;
+        w->head = w->head + 1 == w->cap ? 0 : w->head + 1;
+        w->count--;
+        if (evicted != NULL)
+            *evicted = old;
+        dropped = 1;
+    }
+    w->v[deque_slot(w, w->head, w->count)] = v;
+    w->count++;
+    w->sum += v;
+    unsigned int seq = w->next_seq++;
+    // the oldest value still held has seq - count + 1, anything before it left
+    unsigned int oldest = seq - (unsigned int) w->count + 1;
+
+    // a value no smaller than a newer one can never be the min again, likewise for max
+    while (w->min_n > 0 && w->min_q[deque_slot(w, w->min_head, w->min_n - 1)].v >= v)
+        w->min_n--;
+    if (w->min_n > 0 && (int) (w->min_q[w->min_head].seq - oldest) < 0) {
+        w->min_head = deque_slot(w, w->min_head, 1);
+        w->min_n--;
+    }
+    w->min_q[deque_slot(w, w->min_head, w->min_n)] = (rolling_window_entry_t) {seq, v};
+    w->min_n++;
+
+    while (w->max_n > 0 && w->max_q[deque_slot(w, w->max_head, w->max_n - 1)].v <= v)
+        w->max_n--;
+    if (w->max_n > 0 && (int) (w->max_q[w->max_head].seq - oldest) < 0) {
+        w->max_head = deque_slot(w, w->max_head, 1);
+        w->max_n--;
+    }
+    w->max_q[deque_slot(w, w->max_head, w->max_n)] = (rolling_window_entry_t) {seq, v};
+    w->max_n++;
+    return dropped;
+}
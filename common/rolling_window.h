@@ -0,0 +1,78 @@
+#ifndef ROLLING_WINDOW_H
+#define ROLLING_WINDOW_H
+
+/*
+The last N values of a per-frame quantity (posture bounds smoothed over 5 frames,
+z_mean history for fall detection) without shifting arrays: a circular buffer
+with a running sum for the mean and two monotonic deques for min and max, so a
+push is O(1) (amortized for min/max) and every query is O(1).
+The storage is inline, a window lives in a context struct like any array did.
+Values are expected finite; the sum is kept in double, so a mean matches the
+plain sum of the values to float precision however long the window runs.
+*/
+
+#define ROLLING_WINDOW_MAX 64       // largest capacity
+
+typedef struct {
+    unsigned int seq;               // position of the value in the stream
+    float v;
+} rolling_window_entry_t;
+
+typedef struct {
+    int cap;
+    int count;
+    int head;                       // slot of the oldest value
+    unsigned int next_seq;          // values pushed so far
+    double sum;
+    float v[ROLLING_WINDOW_MAX];
+    // candidates for min (increasing) and max (decreasing), oldest first, circular
+    rolling_window_entry_t min_q[ROLLING_WINDOW_MAX], max_q[ROLLING_WINDOW_MAX];
+    int min_head, min_n, max_head, max_n;
+} rolling_window_t;
+
+/*
+w = window to set up, emptied
+capacity = values kept, clamped to 1 .. ROLLING_WINDOW_MAX
+*/
+void rolling_window_init(rolling_window_t *w, int capacity);
+
+/*
+Append a value, dropping the oldest when the window is full.
+evicted = receives the dropped value, NULL if not wanted
+return = 1 if a value was dropped, 0 otherwise
+*/
+int rolling_window_push(rolling_window_t *w, float v, float *evicted);
+
+// Drop every value, the capacity stays.
+void rolling_window_clear(rolling_window_t *w);
+
+static inline int rolling_window_full(const rolling_window_t *w)
+{
+    return w->count == w->cap;
+}
+
+// Mean of the values held, 0 when empty.
+static inline float rolling_window_mean(const rolling_window_t *w)
+{
+    return w->count > 0 ? (float) (w->sum / w->count) : 0.0f;
+}
+
+// Smallest and largest value held, not to be called on an empty window.
+static inline float rolling_window_min(const rolling_window_t *w)
+{
+    return w->min_q[w->min_head].v;
+}
+
+static inline float rolling_window_max(const rolling_window_t *w)
+{
+    return w->max_q[w->max_head].v;
+}
+
+// i-th value, 0 the oldest, i < count
+static inline float rolling_window_at(const rolling_window_t *w, int i)
+{
+    int slot = w->head + i;
+    return w->v[slot >= w->cap ? slot - w->cap : slot];
+}
+
+#endif // ROLLING_WINDOW_H
@@ -0,0 +1,266 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sensor_hub.h"
+#include "serial_port.h"
+
+#define SENSOR_WORKER_BATCH 4    // frames of one sensor per claim, then the next sensor gets a turn
+#define SENSOR_EPOLL_TIMEOUT_MS 200
+
+int sensor_hub_init(sensor_hub_t *hub, sensor_process_fn process)
+{
+    memset(hub, 0, sizeof(*hub));
+    hub->process = process;
+    hub->epfd = epoll_create1(0);
+    if (hub->epfd < 0) {
+        printf("Error %i from epoll_create1: %s\n", errno, strerror(errno));
+        return -1;
+    }
+    pthread_mutex_init(&hub->lock, NULL);
+    pthread_cond_init(&hub->work, NULL);
+    return 0;
+}
+
+int sensor_hub_add(sensor_hub_t *hub, const char *device, void *ctx)
+{
+    if (hub->count >= SENSOR_HUB_MAX) {
+        printf("At most %d sensors\n", SENSOR_HUB_MAX);
+        return -1;
+    }
+    sensor_t *s = &hub->sensors[hub->count];
+    memset(s, 0, sizeof(*s));
+    s->id = hub->count;
+    s->device = device;
+    s->ctx = ctx;
+    s->fd = serial_open(device);
+    if (s->fd < 0)
+        return -1;
+    // epoll tells when to read, read() itself must never wait
+    fcntl(s->fd, F_SETFL, fcntl(s->fd, F_GETFL) | O_NONBLOCK);
+    if (frame_reader_init(&s->reader, s->fd) != 0 || spsc_init(&s->queue, sizeof(sensor_frame_t), SENSOR_QUEUE_LEN) != 0) {
+        printf("Error allocating the buffers of %s\n", device);
+        frame_reader_free(&s->reader);
+        close(s->fd);
+        return -1;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = s;
+    if (epoll_ctl(hub->epfd, EPOLL_CTL_ADD, s->fd, &ev) != 0) {
+        printf("Error %i from epoll_ctl: %s\n", errno, strerror(errno));
+        spsc_free(&s->queue);
+        frame_reader_free(&s->reader);
+        close(s->fd);
+        return -1;
+    }
+    return hub->count++;
+}
+
+static void close_sensor(sensor_hub_t *hub, sensor_t *s)
+{
+    printf("sensor %d (%s) closed\n", s->id, s->device);
+    epoll_ctl(hub->epfd, EPOLL_CTL_DEL, s->fd, NULL);
+    s->closed = 1;
+}
+
+// Read everything the port has and queue the complete frames, written straight into the ring slots.
+static int drain_sensor(sensor_hub_t *hub, sensor_t *s)
+{
+    const uint8_t *frame;
+    int queued = 0;
+
+    for (;;) {
+        int len = frame_reader_read(&s->reader, &frame);
+        if (len <= 0) {
+            if (len < 0 && errno != EAGAIN && errno != EINTR)
+                close_sensor(hub, s);
+            return queued;
+        }
+        if (len > SENSOR_FRAME_MAX) {
+            s->oversize++;
+            continue;
+        }
+        sensor_frame_t *slot = (sensor_frame_t *) spsc_reserve(&s->queue);
+        if (slot == NULL)
+            continue;
+        slot->len = len;
+        slot->rx_ns = s->reader.rx_ns;
+        memcpy(slot->data, frame, len);
+        spsc_commit(&s->queue);
+        queued++;
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    sensor_hub_t *hub = (sensor_hub_t *) arg;
+    int next = 0;
+
+    while (!hub->stop) {
+        pthread_mutex_lock(&hub->lock);
+        unsigned long seen = hub->work_seq;
+        pthread_mutex_unlock(&hub->lock);
+
+        int done = 0;
+        for (int k = 0; k < hub->count; k++) {
+            sensor_t *s = &hub->sensors[(next + k) % hub->count];
+            if (spsc_count(&s->queue) == 0)
+                continue;
+            // the claim makes this worker the only consumer of the sensor's ring and pipeline
+            int expected = 0;
+            if (!__atomic_compare_exchange_n(&s->busy, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+                continue;
+            // the frame is processed in its slot, released only afterwards
+            const sensor_frame_t *frame;
+            for (int b = 0; b < SENSOR_WORKER_BATCH && (frame = (const sensor_frame_t *) spsc_peek(&s->queue)) != NULL; b++) {
+                if (hub->process(s, frame) != 0)
+                    hub->stop = 1;
+                spsc_release(&s->queue);
+                done++;
+            }
+            __atomic_store_n(&s->busy, 0, __ATOMIC_RELEASE);
+        }
+        next++;
+        if (done > 0)
+            continue;
+
+        pthread_mutex_lock(&hub->lock);
+        if (hub->work_seq == seen && !hub->stop) {
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_nsec += 100 * 1000000L;
+            if (until.tv_nsec >= 1000000000L) {
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&hub->work, &hub->lock, &until);
+        }
+        pthread_mutex_unlock(&hub->lock);
+    }
+    return NULL;
+}
+
+static int queues_drained(sensor_hub_t *hub)
+{
+    for (int i = 0; i < hub->count; i++)
+        if (spsc_count(&hub->sensors[i].queue) > 0 || __atomic_load_n(&hub->sensors[i].busy, __ATOMIC_ACQUIRE))
+            return 0;
+    return 1;
+}
+
+void sensor_hub_run(sensor_hub_t *hub, int workers)
+{
+    struct epoll_event ev[SENSOR_HUB_MAX];
+
+    if (workers < 1)
+        workers = 1;
+    if (workers > SENSOR_HUB_MAX_WORKERS)
+        workers = SENSOR_HUB_MAX_WORKERS;
+    hub->nworkers = 0;
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&hub->workers[i], NULL, worker_main, hub) != 0) {
+            printf("Error from pthread_create\n");
+            break;
+        }
+        hub->nworkers++;
+    }
+
+    while (!hub->stop) {
+        if (hub->stop_flag != NULL && *hub->stop_flag)
+            break;
+        int open = 0;
+        for (int i = 0; i < hub->count; i++)
+            open += !hub->sensors[i].closed;
+        if (open == 0 || hub->nworkers == 0)
+            break;
+
+        int n = epoll_wait(hub->epfd, ev, SENSOR_HUB_MAX, SENSOR_EPOLL_TIMEOUT_MS);
+        if (n < 0 && errno != EINTR) {
+            printf("Error %i from epoll_wait: %s\n", errno, strerror(errno));
+            break;
+        }
+        int queued = 0;
+        for (int i = 0; i < n; i++) {
+            sensor_t *s = (sensor_t *) ev[i].data.ptr;
+            queued += drain_sensor(hub, s);
+            if (!s->closed && (ev[i].events & (EPOLLHUP | EPOLLERR)))
+                close_sensor(hub, s);
+        }
+        if (queued > 0) {
+            pthread_mutex_lock(&hub->lock);
+            hub->work_seq++;
+            pthread_cond_broadcast(&hub->work);
+            pthread_mutex_unlock(&hub->lock);
+        }
+    }
+
+    // every port closed: let the workers finish what is queued
+    while (!hub->stop && !(hub->stop_flag != NULL && *hub->stop_flag) && hub->nworkers > 0 && !queues_drained(hub)) {
+        struct timespec ts = { 0, 10 * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+    hub->stop = 1;
+    pthread_mutex_lock(&hub->lock);
+    pthread_cond_broadcast(&hub->work);
+    pthread_mutex_unlock(&hub->lock);
+    for (int i = 0; i < hub->nworkers; i++)
+        pthread_join(hub->workers[i], NULL);
+}
+
+void sensor_hub_stop(sensor_hub_t *hub)
+{
+    hub->stop = 1;
+}
+
+void sensor_hub_report(const sensor_hub_t *hub)
+{
+    for (int i = 0; i < hub->count; i++) {
+        const sensor_t *s = &hub->sensors[i];
+        const frame_reader_t *r = &s->reader;
+        double elapsed = r->frames > 1 ? (r->handout_ns - r->first_ns) / 1e9 : 0;
+        printf("sensor %d %s: frames %llu  %.1f frames/s  dropped (queue full) %llu  oversize %llu  max queue depth %zu / %zu\n",
+               s->id, s->device, (unsigned long long) r->frames, elapsed > 0 ? (r->frames - 1) / elapsed : 0.0,
+               (unsigned long long) s->queue.overflows, (unsigned long long) s->oversize,
+               s->queue.high_water, s->queue.mask + 1);
+        frame_reader_report_stats(r);
+    }
+}
+
+int sensor_hub_stats(const sensor_hub_t *hub, int id, frame_stats_t *out)
+{
+    if (id < 0 || id >= hub->count)
+        return -1;
+    frame_reader_stats(&hub->sensors[id].reader, out);
+    return 0;
+}
+
+void sensor_hub_free(sensor_hub_t *hub)
+{
+    for (int i = 0; i < hub->count; i++) {
+        sensor_t *s = &hub->sensors[i];
+        spsc_free(&s->queue);
+        frame_reader_free(&s->reader);
+        close(s->fd);
+    }
+    hub->count = 0;
+    close(hub->epfd);
+    pthread_mutex_destroy(&hub->lock);
+    pthread_cond_destroy(&hub->work);
+}
+
+int sensor_hub_device_args(int argc, char *argv[], const char **devices)
+{
+    int n = 0;
+    for (int i = 1; i + 1 < argc && n < SENSOR_HUB_MAX; i++)
+        if (strcmp(argv[i], "--device") == 0)
+            devices[n++] = argv[++i];
+    return n;
+}
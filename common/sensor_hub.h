@@ -0,0 +1,105 @@
+#ifndef SENSOR_HUB_H
+#define SENSOR_HUB_H
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+
+#include "frame_reader.h"
+#include "spsc_queue.h"
+
+/*
+Several radars in one process.
+One ingest thread waits on all serial ports with epoll, reassembles the frames of
+each port with its own frame reader and queues them per sensor (SPSC ring). A frame
+is written into its ring slot once and processed there, only len bytes are copied.
+A pool of worker threads runs the pipeline: a sensor is claimed by one worker at a
+time, so its pipeline instance (sensor_t.ctx) sees its frames in order and needs no
+lock, while different sensors are processed in parallel.
+*/
+
+#define SENSOR_HUB_MAX 8
+#define SENSOR_HUB_MAX_WORKERS 8
+#define SENSOR_FRAME_MAX 16384   // largest queued frame, point cloud TLVs are limited to 10000 bytes
+#define SENSOR_QUEUE_LEN 64
+
+typedef struct {
+    uint32_t len;
+    uint64_t rx_ns;              // monotonic receive time
+    uint8_t data[SENSOR_FRAME_MAX];
+} sensor_frame_t;
+
+typedef struct sensor_s sensor_t;
+
+/*
+Pipeline entry point, called on a worker thread for each frame of a sensor.
+s = the sensor, s->ctx is its pipeline instance
+return = 0 to go on, -1 to stop the hub (fatal pipeline error)
+*/
+typedef int (*sensor_process_fn)(sensor_t *s, const sensor_frame_t *frame);
+
+struct sensor_s {
+    int id;
+    const char *device;
+    int fd;
+    frame_reader_t reader;
+    spsc_queue_t queue;
+    void *ctx;                   // pipeline instance of this sensor
+    int busy;                    // claimed by a worker
+    int closed;                  // port error or hang-up, no longer polled
+    uint64_t oversize;           // frames larger than SENSOR_FRAME_MAX
+};
+
+typedef struct sensor_hub_s sensor_hub_t;
+struct sensor_hub_s {
+    sensor_t sensors[SENSOR_HUB_MAX];
+    int count;
+    int epfd;
+    sensor_process_fn process;
+    pthread_t workers[SENSOR_HUB_MAX_WORKERS];
+    int nworkers;
+    pthread_mutex_t lock;        // only to sleep on work
+    pthread_cond_t work;
+    unsigned long work_seq;      // bumped under lock whenever frames were queued
+    volatile sig_atomic_t stop;
+    const volatile sig_atomic_t *stop_flag;  // polled by the ingest loop, a signal handler's flag, NULL for none
+};
+
+int sensor_hub_init(sensor_hub_t *hub, sensor_process_fn process);
+
+/*
+Open a serial port (serial_open) and add it as the next sensor.
+ctx = pipeline instance for this sensor
+return = sensor id, -1 on error (printed)
+*/
+int sensor_hub_add(sensor_hub_t *hub, const char *device, void *ctx);
+
+/*
+Start the workers and run the epoll ingest loop on the calling thread until
+sensor_hub_stop(), *stop_flag, a pipeline error or every port is closed.
+workers = number of worker threads (1 .. SENSOR_HUB_MAX_WORKERS)
+*/
+void sensor_hub_run(sensor_hub_t *hub, int workers);
+
+// Ask sensor_hub_run() to return, safe in a signal handler.
+void sensor_hub_stop(sensor_hub_t *hub);
+
+// Per-sensor frames, frames/s, dropped and oversize frames, then the link counters of each reader.
+void sensor_hub_report(const sensor_hub_t *hub);
+
+/*
+Link counters of one sensor (frame_reader_stats), safe while the hub runs.
+return = 0, -1 if id is not a sensor of the hub
+*/
+int sensor_hub_stats(const sensor_hub_t *hub, int id, frame_stats_t *out);
+
+void sensor_hub_free(sensor_hub_t *hub);
+
+/*
+Collect every --device <path> of the command line.
+devices = output, at most SENSOR_HUB_MAX entries
+return = number of devices
+*/
+int sensor_hub_device_args(int argc, char *argv[], const char **devices);
+
+#endif // SENSOR_HUB_H
@@ -0,0 +1,58 @@
+#include <errno.h>	 // Error integer and strerror() function
+#include <fcntl.h>	 // Contains file controls like O_RDWR
+#include <stdio.h>
+#include <string.h>
+#include <termios.h> // Contains POSIX terminal control definitions
+#include <unistd.h>	 // write(), read(), close()
+
+#include "serial_port.h"
+
+int serial_open(const char *device)
+{
+	int serial_port = open(device, O_RDWR);
+	struct termios tty;
+
+	if (tcgetattr(serial_port, &tty) != 0)
+	{
+		printf("Error %i from tcgetattr: %s\n", errno, strerror(errno));
+		if (serial_port >= 0)
+			close(serial_port);
+		return -1;
+	}
+	tty.c_cflag &= ~PARENB;
+	tty.c_cflag &= ~CSTOPB;
+	tty.c_cflag &= ~CSIZE;
+	tty.c_cflag |= CS8;
+	tty.c_cflag &= ~CRTSCTS;
+	tty.c_cflag |= CREAD | CLOCAL;
+	tty.c_lflag &= ~ICANON;
+	tty.c_lflag &= ~ECHO;
+	tty.c_lflag &= ~ECHOE;
+	tty.c_lflag &= ~ECHONL;
+	tty.c_lflag &= ~ISIG;
+	tty.c_iflag &= ~(IXON | IXOFF | IXANY);
+	tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL);
+	tty.c_oflag &= ~OPOST;
+	tty.c_oflag &= ~ONLCR;
+	tty.c_cc[VTIME] = 10;
+	tty.c_cc[VMIN] = 0;
+
+	cfsetispeed(&tty, B921600);
+	cfsetospeed(&tty, B921600);
+
+	if (tcsetattr(serial_port, TCSANOW, &tty) != 0)
+	{
+		printf("Error %i from tcsetattr: %s\n", errno, strerror(errno));
+		close(serial_port);
+		return -1;
+	}
+	return serial_port;
+}
+
+const char *serial_device_arg(int argc, char *argv[])
+{
+	for (int i = 1; i + 1 < argc; i++)
+		if (strcmp(argv[i], "--device") == 0)
+			return argv[i + 1];
+	return RADAR_DEVICE;
+}
@@ -0,0 +1,18 @@
+#ifndef SERIAL_PORT_H
+#define SERIAL_PORT_H
+
+#define RADAR_DEVICE "/dev/ttyTHS1"
+
+/*
+Open the radar data port at 921600 baud, 8N1, raw mode.
+device = path of the tty, e.g. RADAR_DEVICE
+return = file descriptor, -1 on error (the error is printed)
+*/
+int serial_open(const char *device);
+
+/*
+Device given with --device <path> (e.g. the pty of tools/radar_sim), RADAR_DEVICE otherwise.
+*/
+const char *serial_device_arg(int argc, char *argv[]);
+
+#endif // SERIAL_PORT_H
@@ -0,0 +1,141 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+Bounded single-producer / single-consumer ring of fixed-size elements.
+One thread pushes, one thread pops, no lock: each side only writes its own index
+and publishes it with a release store, the other side reads it with an acquire load.
+A push into a full ring fails and is counted in overflows, the producer never waits.
+*/
+
+#define SPSC_CACHE_LINE 64
+
+typedef struct spsc_queue_s spsc_queue_t;
+struct spsc_queue_s {
+    uint8_t *slots;
+    size_t elem_size;
+    size_t mask;                                        // capacity - 1, capacity is a power of two
+    size_t head __attribute__((aligned(SPSC_CACHE_LINE)));  // next slot to pop, written by the consumer
+    size_t tail __attribute__((aligned(SPSC_CACHE_LINE)));  // next slot to push, written by the producer
+    uint64_t pushed;                                    // producer side statistics
+    uint64_t overflows;
+    size_t high_water;
+};
+
+/*
+q = queue to initialise
+elem_size = size of one element in bytes
+capacity = number of slots, rounded up to a power of two
+return = 0 on success, -1 if the slots cannot be allocated
+*/
+static inline int spsc_init(spsc_queue_t *q, size_t elem_size, size_t capacity)
+{
+    size_t n = 1;
+    while (n < capacity)
+        n <<= 1;
+    memset(q, 0, sizeof(*q));
+    q->slots = (uint8_t *) malloc(n * elem_size);
+    if (q->slots == NULL)
+        return -1;
+    q->elem_size = elem_size;
+    q->mask = n - 1;
+    return 0;
+}
+
+static inline void spsc_free(spsc_queue_t *q)
+{
+    free(q->slots);
+    q->slots = NULL;
+}
+
+// Number of queued elements, exact for the consumer and a lower bound for the producer.
+static inline size_t spsc_count(const spsc_queue_t *q)
+{
+    return __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+}
+
+// Producer only: no room for another element.
+static inline int spsc_full(const spsc_queue_t *q)
+{
+    return q->tail - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) > q->mask;
+}
+
+/*
+Producer only: the next free slot, to be filled in place and published with
+spsc_commit(), so only the bytes written to it are copied.
+return = the slot, NULL when the ring is full (counted as an overflow)
+*/
+static inline void *spsc_reserve(spsc_queue_t *q)
+{
+    size_t tail = q->tail;
+    if (tail - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) > q->mask) {
+        __atomic_store_n(&q->overflows, q->overflows + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    return q->slots + (tail & q->mask) * q->elem_size;
+}
+
+// Producer only: queue the slot returned by spsc_reserve().
+static inline void spsc_commit(spsc_queue_t *q)
+{
+    size_t tail = q->tail;
+    size_t used = tail + 1 - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&q->pushed, q->pushed + 1, __ATOMIC_RELAXED);
+    if (used > q->high_water)
+        __atomic_store_n(&q->high_water, used, __ATOMIC_RELAXED);
+}
+
+/*
+Producer only.
+return = 0 when queued, -1 when the ring is full (the element is dropped and counted)
+*/
+static inline int spsc_push(spsc_queue_t *q, const void *elem)
+{
+    void *slot = spsc_reserve(q);
+    if (slot == NULL)
+        return -1;
+    memcpy(slot, elem, q->elem_size);
+    spsc_commit(q);
+    return 0;
+}
+
+/*
+Consumer only: the oldest element, read in place. It stays queued (the producer
+cannot reuse the slot) until spsc_release().
+return = the element, NULL when the ring is empty
+*/
+static inline const void *spsc_peek(const spsc_queue_t *q)
+{
+    size_t head = q->head;
+    if (head == __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE))
+        return NULL;
+    return q->slots + (head & q->mask) * q->elem_size;
+}
+
+// Consumer only: drop the element returned by spsc_peek().
+static inline void spsc_release(spsc_queue_t *q)
+{
+    __atomic_store_n(&q->head, q->head + 1, __ATOMIC_RELEASE);
+}
+
+/*
+Consumer only.
+return = 1 when an element was copied to elem, 0 when the ring is empty
+*/
+static inline int spsc_pop(spsc_queue_t *q, void *elem)
+{
+    const void *slot = spsc_peek(q);
+    if (slot == NULL)
+        return 0;
+    memcpy(elem, slot, q->elem_size);
+    spsc_release(q);
+    return 1;
+}
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,147 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stage_timer.h"
+
+#define STAGE_SUB_BITS 5
+#define STAGE_SUB (1 << STAGE_SUB_BITS)        // linear sub-buckets per power of two
+#define STAGE_MAX_EXP 41                       // 2^42 ns, about 73 minutes
+#define STAGE_BUCKETS ((STAGE_MAX_EXP - STAGE_SUB_BITS + 1) * STAGE_SUB + STAGE_SUB)
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t buckets[STAGE_BUCKETS];
+} stage_hist_t;
+
+static const char *const stage_names[STAGE_COUNT] = {
+    "decode", "snr filter", "transform", "dbscan", "quartiles", "lfilter",
+    "fft", "mlr", "feature compress", "candidate search", "predict", "file i/o",
+    "rx->parse", "rx->cluster", "rx->posture", "rx->output", "fall rx->posture", "fall rx->alert",
+};
+
+static stage_hist_t hists[STAGE_COUNT];
+static uint64_t period_ns;
+static uint64_t next_dump_ns;
+static volatile sig_atomic_t dump_requested;
+
+/*
+Values below 2 * STAGE_SUB are their own bucket, above that the top STAGE_SUB_BITS + 1
+bits select the bucket: index = shift * STAGE_SUB + (v >> shift).
+*/
+static int bucket_of(uint64_t v)
+{
+    if (v < 2 * STAGE_SUB)
+        return (int) v;
+    int e = 63 - __builtin_clzll(v);
+    if (e > STAGE_MAX_EXP)
+        return STAGE_BUCKETS - 1;
+    int shift = e - STAGE_SUB_BITS;
+    return shift * STAGE_SUB + (int) (v >> shift);
+}
+
+// Largest value that falls into bucket i.
+static uint64_t bucket_high(int i)
+{
+    if (i < 2 * STAGE_SUB)
+        return (uint64_t) i;
+    int shift = i / STAGE_SUB - 1;
+    uint64_t m = (uint64_t) (i % STAGE_SUB + STAGE_SUB);
+    return ((m + 1) << shift) - 1;
+}
+
+static void on_sigusr1(int sig)
+{
+    (void) sig;
+    dump_requested = 1;
+}
+
+void stage_timer_init(int argc, char *argv[])
+{
+    for (int i = 1; i + 1 < argc; i++)
+        if (strcmp(argv[i], "--timing-every") == 0)
+            period_ns = (uint64_t) (atof(argv[i + 1]) * 1e9);
+    if (period_ns > 0)
+        next_dump_ns = mono_ns() + period_ns;
+    signal(SIGUSR1, on_sigusr1);
+}
+
+void stage_record(stage_t stage, uint64_t ns)
+{
+    stage_hist_t *h = &hists[stage];
+    __atomic_fetch_add(&h->buckets[bucket_of(ns)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum_ns, ns, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+    while (ns > max && !__atomic_compare_exchange_n(&h->max_ns, &max, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+void stage_timer_poll(void)
+{
+    int due = 0;
+    if (dump_requested) {
+        dump_requested = 0;
+        due = 1;
+    }
+    if (period_ns > 0) {
+        uint64_t now = mono_ns();
+        uint64_t next = __atomic_load_n(&next_dump_ns, __ATOMIC_RELAXED);
+        // one thread wins the period, the others see the new deadline
+        if (now >= next && __atomic_compare_exchange_n(&next_dump_ns, &next, now + period_ns, 0,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            due = 1;
+    }
+    if (due)
+        stage_timer_report();
+}
+
+// Value at quantile q of a histogram snapshot, bucket resolution, never above max.
+static double quantile_us(const uint64_t *buckets, uint64_t count, uint64_t max_ns, double q)
+{
+    uint64_t rank = (uint64_t) (q * count + 0.5);
+    uint64_t seen = 0;
+    if (rank < 1)
+        rank = 1;
+    for (int i = 0; i < STAGE_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            uint64_t v = bucket_high(i);
+            return (v < max_ns ? v : max_ns) / 1e3;
+        }
+    }
+    return max_ns / 1e3;
+}
+
+void stage_timer_report(void)
+{
+    static uint64_t snap[STAGE_BUCKETS];
+    static int reporting;
+
+    // SIGUSR1 and the period can both fire on different workers
+    if (__atomic_exchange_n(&reporting, 1, __ATOMIC_ACQUIRE))
+        return;
+    fprintf(stderr, "%-17s %10s %10s %10s %10s %10s %10s %10s\n",
+            "stage (us)", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        stage_hist_t *h = &hists[s];
+        uint64_t count = 0;
+        for (int i = 0; i < STAGE_BUCKETS; i++) {
+            snap[i] = __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+            count += snap[i];
+        }
+        if (count == 0)
+            continue;
+        uint64_t sum = __atomic_load_n(&h->sum_ns, __ATOMIC_RELAXED);
+        uint64_t max = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+        fprintf(stderr, "%-17s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                stage_names[s], (unsigned long long) count, sum / 1e3 / count,
+                quantile_us(snap, count, max, 0.5), quantile_us(snap, count, max, 0.9),
+                quantile_us(snap, count, max, 0.99), quantile_us(snap, count, max, 0.999), max / 1e3);
+    }
+    fflush(stderr);
+    __atomic_store_n(&reporting, 0, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,88 @@
+#ifndef STAGE_TIMER_H
+#define STAGE_TIMER_H
+
+#include <stdint.h>
+
+#include "mono_clock.h"
+
+/*
+Per-stage latency histograms.
+Each stage keeps a log-linear histogram of its durations (HDR style: 32 linear
+sub-buckets per power of two, about 3% resolution from 1 ns to 1 hour) plus count,
+sum and max. Recording is a few relaxed atomic adds, so worker threads can time
+stages of different sensors without a lock.
+The table (count, mean, p50, p90, p99, p99.9, max per stage) goes to stderr
+every --timing-every N seconds, on SIGUSR1 and at exit.
+*/
+
+typedef enum {
+    STAGE_DECODE,
+    STAGE_SNR_FILTER,
+    STAGE_TRANSFORM,
+    STAGE_DBSCAN,
+    STAGE_QUARTILES,
+    STAGE_LFILTER,
+    STAGE_FFT,
+    STAGE_MLR,
+    STAGE_FEATURE_COMPRESS,
+    STAGE_CANDIDATE_SEARCH,
+    STAGE_PREDICT,
+    STAGE_FILE_IO,
+    // end to end, from the receive time of the frame's last bytes (people)
+    STAGE_RX_PARSE,
+    STAGE_RX_CLUSTER,
+    STAGE_RX_POSTURE,
+    STAGE_RX_OUTPUT,
+    STAGE_FALL_RX_POSTURE,      // only frames where a track turned to fall
+    STAGE_FALL_RX_ALERT,        // fall frames, once the alert hook has run
+    STAGE_COUNT
+} stage_t;
+
+/*
+Read --timing-every <seconds> (0 or absent: only SIGUSR1 and exit) and install the
+SIGUSR1 handler. Timing is recorded whether or not this is called.
+*/
+void stage_timer_init(int argc, char *argv[]);
+
+// Add one duration in nanoseconds to a stage.
+void stage_record(stage_t stage, uint64_t ns);
+
+static inline uint64_t stage_begin(void)
+{
+    return mono_ns();
+}
+
+static inline void stage_end(stage_t stage, uint64_t t0)
+{
+    stage_record(stage, mono_ns() - t0);
+}
+
+/*
+Time the rest of the enclosing block, recorded when the block is left.
+{ STAGE_SCOPE(STAGE_FFT); ... }
+*/
+typedef struct {
+    stage_t stage;
+    uint64_t t0;
+} stage_scope_t;
+
+static inline void stage_scope_end(stage_scope_t *s)
+{
+    stage_end(s->stage, s->t0);
+}
+
+#define STAGE_SCOPE_VAR2(line) stage_scope_##line
+#define STAGE_SCOPE_VAR(line) STAGE_SCOPE_VAR2(line)
+#define STAGE_SCOPE(stage) \
+    stage_scope_t STAGE_SCOPE_VAR(__LINE__) __attribute__((cleanup(stage_scope_end))) = { (stage), mono_ns() }
+
+/*
+Called once per frame by the pipeline: prints the table when SIGUSR1 arrived or the
+--timing-every period has passed. Cheap when there is nothing to print.
+*/
+void stage_timer_poll(void);
+
+// Print the table of every stage with samples.
+void stage_timer_report(void);
+
+#endif // STAGE_TIMER_H
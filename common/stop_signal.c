@@ -0,0 +1,23 @@
+#include <string.h>
+
+#include "stop_signal.h"
+
+volatile sig_atomic_t stop_requested = 0;
+
+static void on_stop(int sig)
+{
+    (void) sig;
+    stop_requested = 1;
+}
+
+void stop_signal_init(void)
+{
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop;
+    sa.sa_flags = SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+}
@@ -0,0 +1,18 @@
+#ifndef STOP_SIGNAL_H
+#define STOP_SIGNAL_H
+
+#include <signal.h>
+
+/*
+Ctrl+C and kill for the read loops.
+SIGINT and SIGTERM only set stop_requested; the loops poll it and leave the way
+the end of a replay does, so the csv is flushed and the reports are printed.
+The handler is installed without SA_RESTART, so a blocking read() returns at once,
+and it is one-shot: a second Ctrl+C kills a process that does not stop.
+*/
+
+extern volatile sig_atomic_t stop_requested;
+
+void stop_signal_init(void);
+
+#endif // STOP_SIGNAL_H
@@ -0,0 +1,88 @@
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "task_pool.h"
+
+#define TASK_POOL_SPIN 20000     // polls of job_seq before a helper sleeps
+
+static void *helper_main(void *p)
+{
+    task_pool_t *pool = (task_pool_t *) p;
+    int thread = __atomic_add_fetch(&pool->started, 1, __ATOMIC_RELAXED);
+    unsigned int seen = 0;
+
+    for (;;) {
+        unsigned int seq;
+        int spins = 0;
+        while ((seq = __atomic_load_n(&pool->job_seq, __ATOMIC_ACQUIRE)) == seen &&
+               !__atomic_load_n(&pool->stop, __ATOMIC_ACQUIRE)) {
+            if (++spins < TASK_POOL_SPIN)
+                continue;
+            pthread_mutex_lock(&pool->lock);
+            while (__atomic_load_n(&pool->job_seq, __ATOMIC_ACQUIRE) == seen && !pool->stop)
+                pthread_cond_wait(&pool->work, &pool->lock);
+            pthread_mutex_unlock(&pool->lock);
+        }
+        if (__atomic_load_n(&pool->stop, __ATOMIC_ACQUIRE))
+            return NULL;
+        seen = seq;
+        pool->fn(pool->arg, thread, pool->nthreads);
+        __atomic_fetch_sub(&pool->pending, 1, __ATOMIC_RELEASE);
+    }
+}
+
+int task_pool_init(task_pool_t *pool, int nthreads)
+{
+    memset(pool, 0, sizeof(*pool));
+    if (nthreads < 1)
+        nthreads = 1;
+    if (nthreads > TASK_POOL_MAX_THREADS)
+        nthreads = TASK_POOL_MAX_THREADS;
+    pthread_mutex_init(&pool->busy, NULL);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pool->nthreads = 1;
+    for (int i = 1; i < nthreads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, helper_main, pool) != 0) {
+            printf("Error from pthread_create\n");
+            task_pool_free(pool);
+            return -1;
+        }
+        pool->nthreads = i + 1;
+    }
+    return 0;
+}
+
+int task_pool_run(task_pool_t *pool, task_fn fn, void *arg)
+{
+    if (pthread_mutex_trylock(&pool->busy) != 0)
+        return -1;
+    pool->fn = fn;
+    pool->arg = arg;
+    __atomic_store_n(&pool->pending, pool->nthreads - 1, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&pool->lock);
+    __atomic_fetch_add(&pool->job_seq, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    fn(arg, 0, pool->nthreads);
+    while (__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE) > 0)
+        sched_yield();
+    pthread_mutex_unlock(&pool->busy);
+    return 0;
+}
+
+void task_pool_free(task_pool_t *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    __atomic_store_n(&pool->stop, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->nthreads; i++)
+        pthread_join(pool->threads[i], NULL);
+    pthread_mutex_destroy(&pool->busy);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work);
+    pool->nthreads = 1;
+}
@@ -0,0 +1,49 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <pthread.h>
+
+/*
+Fork-join pool for data-parallel steps inside one frame (parallel DBSCAN).
+task_pool_run() hands the same function to every thread of the pool, the caller
+being thread 0, and returns when all of them are done. The helpers spin for a
+short while after a job before sleeping, so back-to-back jobs of one frame start
+in well under a microsecond instead of paying a wake-up each.
+One job at a time: a caller that finds the pool busy (another sensor's worker in
+the hub) gets -1 and does the work itself.
+*/
+
+#define TASK_POOL_MAX_THREADS 16
+
+typedef void (*task_fn)(void *arg, int thread, int nthreads);
+
+typedef struct {
+    pthread_t threads[TASK_POOL_MAX_THREADS];
+    int nthreads;                // including the caller
+    int started;                 // helpers numbered 1 .. as they start
+    pthread_mutex_t busy;        // held for a whole job
+    pthread_mutex_t lock;        // only to sleep on work
+    pthread_cond_t work;
+    task_fn fn;
+    void *arg;
+    unsigned int job_seq;        // bumped for every job
+    int pending;                 // helpers still running the job
+    int stop;
+} task_pool_t;
+
+/*
+nthreads = threads running each job, caller included (1 .. TASK_POOL_MAX_THREADS)
+return = 0, -1 if a thread cannot be started (printed)
+*/
+int task_pool_init(task_pool_t *pool, int nthreads);
+
+/*
+Run fn(arg, thread, nthreads) on every thread of the pool and wait for all of them.
+return = 0, -1 if the pool is running another job (fn was not called)
+*/
+int task_pool_run(task_pool_t *pool, task_fn fn, void *arg);
+
+// Stop and join the helpers.
+void task_pool_free(task_pool_t *pool);
+
+#endif // TASK_POOL_H
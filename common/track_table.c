@@ -0,0 +1,107 @@
+#include "track_table.h"
+
+void track_table_init(track_table_t *t, int max_tracks, float gate, unsigned int max_misses, unsigned int min_points)
+{
+    if (max_tracks < 1)
+        max_tracks = 1;
+    if (max_tracks > TRACK_TABLE_MAX)
+        max_tracks = TRACK_TABLE_MAX;
+    t->max_tracks = max_tracks;
+    t->gate2 = gate * gate;
+    t->max_misses = max_misses;
+    t->min_points = min_points > 0 ? min_points : 1;
+    t->next_id = 1;
+    track_table_clear(t);
+}
+
+void track_table_clear(track_table_t *t)
+{
+    for (int s = 0; s < TRACK_TABLE_MAX; s++)
+        t->tracks[s].active = 0;
+}
+
+static float dist2_xy(const track_t *tr, const cluster_stats_t *k)
+{
+    float dx = k->centroid[0] - tr->pos[0];
+    float dy = k->centroid[1] - tr->pos[1];
+    return dx * dx + dy * dy;
+}
+
+static void track_take(track_t *tr, const cluster_stats_t *k)
+{
+    for (int d = 0; d < 3; d++)
+        tr->pos[d] = k->centroid[d];
+    tr->points = k->count;
+    tr->hits++;
+    tr->misses = 0;
+}
+
+int track_table_update(track_table_t *t, const cluster_stats_t *c, int num_clusters, int *slot_of)
+{
+    int matched[TRACK_TABLE_MAX] = {0};
+    int tracked = 0;
+
+    for (int k = 0; k < num_clusters; k++)
+        slot_of[k] = -1;
+    // nearest (track, cluster) pair first until nothing is left within the gate;
+    // a handful of tracks, so a full scan per match is cheaper than sorting pairs
+    for (;;) {
+        int best_s = -1, best_k = -1;
+        float best = t->gate2;
+        for (int s = 0; s < t->max_tracks; s++) {
+            if (!t->tracks[s].active || matched[s])
+                continue;
+            for (int k = 0; k < num_clusters; k++) {
+                if (slot_of[k] >= 0 || c[k].count < t->min_points)
+                    continue;
+                float d2 = dist2_xy(&t->tracks[s], &c[k]);
+                if (d2 <= best) {
+                    best = d2;
+                    best_s = s;
+                    best_k = k;
+                }
+            }
+        }
+        if (best_s < 0)
+            break;
+        matched[best_s] = 1;
+        slot_of[best_k] = best_s;
+        track_take(&t->tracks[best_s], &c[best_k]);
+        tracked++;
+    }
+    for (int s = 0; s < t->max_tracks; s++) {
+        if (t->tracks[s].active && !matched[s] && ++t->tracks[s].misses > t->max_misses)
+            t->tracks[s].active = 0;
+    }
+    // the rest start tracks, largest first
+    for (;;) {
+        int best_k = -1;
+        for (int k = 0; k < num_clusters; k++) {
+            if (slot_of[k] < 0 && c[k].count >= t->min_points && (best_k < 0 || c[k].count > c[best_k].count))
+                best_k = k;
+        }
+        if (best_k < 0)
+            break;
+        int slot = -1;
+        for (int s = 0; s < t->max_tracks && slot < 0; s++)
+            if (!t->tracks[s].active)
+                slot = s;
+        if (slot < 0) {
+            // all taken: the track missing longest, never one seen this frame
+            for (int s = 0; s < t->max_tracks; s++)
+                if (!matched[s] && (slot < 0 || t->tracks[s].misses > t->tracks[slot].misses))
+                    slot = s;
+        }
+        if (slot < 0)
+            break;
+        track_t *tr = &t->tracks[slot];
+        tr->active = 1;
+        tr->id = t->next_id++;
+        tr->hits = 0;
+        matched[slot] = 1;
+        slot_of[best_k] = slot;
+        track_take(tr, &c[best_k]);
+        tracked++;
+    }
+    return tracked;
+}
@@ -0,0 +1,58 @@
+#ifndef TRACK_TABLE_H
+#define TRACK_TABLE_H
+
+#include "cluster_stats.h"
+
+/*
+Persistent ids for the clusters of successive frames, one track per occupant.
+Each frame the clusters are matched to the live tracks by xy distance of their
+centroids, nearest pair first within a gate (z is left out, it drops when a
+person lies down or falls). A cluster no track takes starts a new track, larger
+clusters first; a track no cluster takes keeps its slot for a few frames so a
+person missed by the radar for a moment keeps the id and whatever state the
+caller hangs on the slot. When every slot is taken the longest missing track
+makes room. Ids grow for the life of the table, slots are reused.
+*/
+
+#define TRACK_TABLE_MAX 16          // largest number of tracks
+
+typedef struct {
+    int active;
+    int id;                         // persistent, from 1
+    float pos[3];                   // centroid when last seen
+    unsigned int points;            // points of its cluster when last seen
+    unsigned int hits;              // frames matched, 1 on the frame it started
+    unsigned int misses;            // frames in a row without a cluster, 0 when matched this frame
+} track_t;
+
+typedef struct {
+    int max_tracks;
+    float gate2;
+    unsigned int max_misses;
+    unsigned int min_points;
+    int next_id;
+    track_t tracks[TRACK_TABLE_MAX];
+} track_table_t;
+
+/*
+t = table to set up, emptied
+max_tracks = tracks kept at once, clamped to 1 .. TRACK_TABLE_MAX
+gate = largest xy distance from a track's last position to its cluster, metres
+max_misses = frames a track survives without a cluster
+min_points = smallest cluster that is tracked
+*/
+void track_table_init(track_table_t *t, int max_tracks, float gate, unsigned int max_misses, unsigned int min_points);
+
+/*
+Match this frame's clusters to tracks.
+c = num_clusters cluster aggregates, clusters without points are skipped
+slot_of = receives the slot of each cluster's track, -1 for an untracked cluster;
+t->tracks[slot].hits == 1 means the track started this frame
+return = number of clusters tracked
+*/
+int track_table_update(track_table_t *t, const cluster_stats_t *c, int num_clusters, int *slot_of);
+
+// Drop every track, ids keep counting.
+void track_table_clear(track_table_t *t);
+
+#endif // TRACK_TABLE_H
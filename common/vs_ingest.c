@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "mono_clock.h"
+#include "stage_timer.h"
+#include "vs_ingest.h"
+
+#define VS_INGEST_RETRY_NS 1000000   // pause after a port error
+#define VS_INGEST_WAIT_MS 100        // longest sleep on the ring, then stop_flag is looked at again
+
+static void sleep_ns(long ns)
+{
+    struct timespec ts = { 0, ns };
+    nanosleep(&ts, NULL);
+}
+
+// Called with in->lock held, returns after a signal or VS_INGEST_WAIT_MS.
+static void wait_ring(vs_ingest_t *in, pthread_cond_t *cond)
+{
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_nsec += VS_INGEST_WAIT_MS * 1000000L;
+    if (until.tv_nsec >= 1000000000L) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(cond, &in->lock, &until);
+}
+
+static void signal_ring(vs_ingest_t *in, pthread_cond_t *cond)
+{
+    pthread_mutex_lock(&in->lock);
+    pthread_cond_broadcast(cond);
+    pthread_mutex_unlock(&in->lock);
+}
+
+static void *ingest_main(void *arg)
+{
+    vs_ingest_t *in = (vs_ingest_t *) arg;
+    frame_reader_t *r = in->reader;
+    int replay = r->capture != NULL && r->capture->mode == CAPTURE_REPLAY;
+    const uint8_t *frame;
+    vs_frame_t f;
+
+    while (!__atomic_load_n(&in->stop, __ATOMIC_RELAXED)) {
+        int size = frame_reader_read(r, &frame);
+        if (size <= 0) {
+            if (r->eof)
+                break;
+            if (size < 0)
+                sleep_ns(VS_INGEST_RETRY_NS);   // port error, retry without spinning
+            continue;   // read() timed out (VTIME), keep draining
+        }
+        // Frames too short to hold the vsos and range profile TLVs are not decoded.
+        if (size < VS_FRAME_LEN) {
+            in->short_frames++;
+            continue;
+        }
+
+        {
+            STAGE_SCOPE(STAGE_DECODE);
+            vs_frame_header_t header;
+            vs_output_stats_t vsos;
+            decode_vs_header(frame, &header);
+            decode_vs_stats(frame, &vsos);
+            f.frame_number = header.frameNumber;
+            f.rx_ns = r->rx_ns;
+            f.wall_time = capture_wall_time(r->capture);
+            vs_stats_to_array(&vsos, f.vsos_array);
+            decode_vs_range_profile(frame, f.range_profile);
+        }
+
+        // a replay must not lose frames, it waits for room instead
+        if (replay) {
+            pthread_mutex_lock(&in->lock);
+            while (spsc_full(&in->queue) && !__atomic_load_n(&in->stop, __ATOMIC_RELAXED))
+                wait_ring(in, &in->room);
+            pthread_mutex_unlock(&in->lock);
+        }
+        if (spsc_push(&in->queue, &f) == 0)
+            signal_ring(in, &in->ready);
+    }
+    __atomic_store_n(&in->done, 1, __ATOMIC_RELEASE);
+    signal_ring(in, &in->ready);
+    return NULL;
+}
+
+int vs_ingest_start(vs_ingest_t *in, frame_reader_t *reader)
+{
+    memset(in, 0, sizeof(*in));
+    in->reader = reader;
+    if (spsc_init(&in->queue, sizeof(vs_frame_t), VS_INGEST_QUEUE_LEN) != 0) {
+        printf("Error from spsc_init\n");
+        return -1;
+    }
+    pthread_mutex_init(&in->lock, NULL);
+    pthread_cond_init(&in->ready, NULL);
+    pthread_cond_init(&in->room, NULL);
+    if (pthread_create(&in->thread, NULL, ingest_main, in) != 0) {
+        printf("Error from pthread_create\n");
+        pthread_cond_destroy(&in->room);
+        pthread_cond_destroy(&in->ready);
+        pthread_mutex_destroy(&in->lock);
+        spsc_free(&in->queue);
+        return -1;
+    }
+    return 0;
+}
+
+int vs_ingest_pop(vs_ingest_t *in, vs_frame_t *f)
+{
+    for (;;) {
+        if (in->stop_flag != NULL && *in->stop_flag)
+            return 0;
+        if (spsc_pop(&in->queue, f)) {
+            signal_ring(in, &in->room);
+            return 1;
+        }
+        // done is read before the last look at the ring, so no frame pushed before it is missed
+        if (__atomic_load_n(&in->done, __ATOMIC_ACQUIRE))
+            return spsc_pop(&in->queue, f);
+        // the ingest thread signals under the lock after its push, so the check and the wait cannot miss it
+        pthread_mutex_lock(&in->lock);
+        if (spsc_count(&in->queue) == 0 && !__atomic_load_n(&in->done, __ATOMIC_ACQUIRE))
+            wait_ring(in, &in->ready);
+        pthread_mutex_unlock(&in->lock);
+    }
+}
+
+void vs_ingest_stop(vs_ingest_t *in)
+{
+    __atomic_store_n(&in->stop, 1, __ATOMIC_RELAXED);
+    signal_ring(in, &in->room);
+    pthread_join(in->thread, NULL);
+    pthread_cond_destroy(&in->room);
+    pthread_cond_destroy(&in->ready);
+    pthread_mutex_destroy(&in->lock);
+    spsc_free(&in->queue);
+}
+
+void vs_ingest_report(const vs_ingest_t *in)
+{
+    printf("ingest: queued %llu  dropped (queue full) %llu  short frames %llu  max queue depth %zu / %zu\n",
+           (unsigned long long) __atomic_load_n(&in->queue.pushed, __ATOMIC_RELAXED),
+           (unsigned long long) __atomic_load_n(&in->queue.overflows, __ATOMIC_RELAXED),
+           (unsigned long long) in->short_frames,
+           __atomic_load_n(&in->queue.high_water, __ATOMIC_RELAXED), in->queue.mask + 1);
+}
@@ -0,0 +1,63 @@
+#ifndef VS_INGEST_H
+#define VS_INGEST_H
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "frame_reader.h"
+#include "radar_decode.h"
+#include "spsc_queue.h"
+
+/*
+Vital signs ingest thread.
+The thread owns the frame reader: it drains the port continuously, decodes each
+vital signs frame and pushes it into an SPSC ring, so the once per second DSP of
+the consumer never keeps the UART waiting. When the ring is full the frame is
+dropped and counted (a replay waits instead, a file cannot overrun).
+*/
+
+#define VS_INGEST_QUEUE_LEN 256   // frames, 12.8 s at 20 frames/s
+
+typedef struct {
+    uint32_t frame_number;
+    uint64_t rx_ns;                                 // monotonic receive time
+    time_t wall_time;                               // capture_wall_time() at receive
+    float vsos_array[VS_ARRAY_LEN];
+    short int range_profile[VS_RANGE_PROFILE_LEN];
+} vs_frame_t;
+
+typedef struct vs_ingest_s vs_ingest_t;
+struct vs_ingest_s {
+    frame_reader_t *reader;
+    spsc_queue_t queue;
+    pthread_t thread;
+    int stop;           // set by the consumer
+    int done;           // set by the ingest thread at the end of a replay
+    pthread_mutex_t lock;   // only to sleep on the ring
+    pthread_cond_t ready;   // signalled after a push and at the end, the consumer waits on it
+    pthread_cond_t room;    // signalled after a pop and on stop, a replay waits on it when the ring is full
+    const volatile sig_atomic_t *stop_flag;  // set by the consumer after vs_ingest_start, a signal handler's flag, NULL for none
+    uint64_t short_frames;
+};
+
+/*
+Start the ingest thread on an initialised reader (with its capture, if any).
+return = 0 on success, -1 on error (printed)
+*/
+int vs_ingest_start(vs_ingest_t *in, frame_reader_t *reader);
+
+/*
+Next decoded frame, waiting for one if the ring is empty.
+return = 1 with f filled, 0 when ingest has ended and the ring is drained or *stop_flag is set
+*/
+int vs_ingest_pop(vs_ingest_t *in, vs_frame_t *f);
+
+// Stop and join the ingest thread, free the ring.
+void vs_ingest_stop(vs_ingest_t *in);
+
+// Print queued / dropped frames and the deepest the ring got.
+void vs_ingest_report(const vs_ingest_t *in);
+
+#endif // VS_INGEST_H
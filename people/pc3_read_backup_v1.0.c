@@ -11,80 +11,667 @@
 #include <math.h>
 #include <sys/time.h>
 #include <time.h>
+#include <signal.h>
 #include <complex.h>
 #include "dbscan.c"
 #include <stdlib.h>
-int mean_count = 0;
-int fall_lying_count = 0;
+#include "../common/frame_reader.h"
+#include "../common/serial_port.h"
+#include "../common/sensor_hub.h"
+#include "../common/radar_decode.h"
+#include "../common/pc_tlv.h"
+#include "../common/pc_cloud.h"
+#include "../common/cluster_stats.h"
+#include "../common/stage_timer.h"
+#include "../common/order_stats.h"
+#include "../common/rolling_window.h"
+#include "../common/track_table.h"
+#include "../common/result_log.h"
+#include "../common/dashboard.h"
+#include "../common/fall_alert.h"
+#include "../common/stop_signal.h"
+#include "../common/task_pool.h"
+#define PEOPLE_TARGET_GATE 0.5 //點離target中心多遠內算同一人, 同dbscan的epsilon
+#define PEOPLE_SMOOTH_FRAMES 5 //x y z上下界跟z_mean平均幾個frame
+#define PEOPLE_FALL_FRAMES 10 //臥跌判斷看最近幾個z_mean
+#define PEOPLE_MAX_TRACKS 8 //一台雷達同時追蹤幾個人
+#define PEOPLE_TRACK_GATE 1.0 //群中心離這個人上次位置多遠內(xy)算同一人
+#define PEOPLE_TRACK_MISSES 10 //幾個frame沒看到這個人就刪掉
+//每個人(track)自己的smooth跟臥跌歷史
+typedef struct {
+	rolling_window_t x_max_win, x_min_win, y_max_win, y_min_win, z_max_win, z_min_win, z_mean_win; //5frame smooth
+	rolling_window_t z_fall_recent, z_fall_older; //最近10個z_mean, 新的5個跟再之前的5個
+	int state_people;       //最近一次的姿態
+} people_track_t;
 
-//int sort 的function
-int compare (const void * a, const void * b)
+void people_track_reset(people_track_t *tr)
 {
-  float fa = *(const float*) a;
-  float fb = *(const float*) b;
-  return (fa > fb) - (fa < fb);
+	rolling_window_init(&tr->x_max_win, PEOPLE_SMOOTH_FRAMES);
+	rolling_window_init(&tr->x_min_win, PEOPLE_SMOOTH_FRAMES);
+	rolling_window_init(&tr->y_max_win, PEOPLE_SMOOTH_FRAMES);
+	rolling_window_init(&tr->y_min_win, PEOPLE_SMOOTH_FRAMES);
+	rolling_window_init(&tr->z_max_win, PEOPLE_SMOOTH_FRAMES);
+	rolling_window_init(&tr->z_min_win, PEOPLE_SMOOTH_FRAMES);
+	rolling_window_init(&tr->z_mean_win, PEOPLE_SMOOTH_FRAMES);
+	rolling_window_init(&tr->z_fall_recent, PEOPLE_FALL_FRAMES / 2);
+	rolling_window_init(&tr->z_fall_older, PEOPLE_FALL_FRAMES / 2);
+	tr->state_people = 1;
 }
-//float sort 的function
-int cmpfunc (const void * a, const void * b)
+//每台雷達的pipeline狀態, 原本的全域變數與要跨frame保留的smooth陣列
+typedef struct {
+	int id;                 //雷達編號, 單台雷達為-1
+	int mode;               //1:顯示mode 0:debug mode
+	char filename[64];      //csv檔名
+	char track_filename[72]; //每個人的姿態, tracks_加csv檔名
+	result_log_t csv, track_csv; //一直開著, 背景thread批次寫入
+	dashboard_region_t view; //畫面上這台雷達的幾行
+	track_table_t tracks;   //群對到人, 人的編號跨frame不變
+	people_track_t people[PEOPLE_MAX_TRACKS]; //跟tracks.tracks同一個slot
+	unsigned long tracker_frames, dbscan_frames; //label來自雷達tracker / host dbscan的frame數
+	pc_cloud_t cloud;       //這frame的點 x y z range doppler snr, 緩衝區跨frame留著
+	int *labels;            //以下跟cloud一樣只會變大, 不用每frame在stack上開陣列
+	unsigned int *members;
+	cluster_stats_t *clusters;
+	float *axis;            //一群的一個維度, 算四分位數
+	int *track_of;          //每群的track slot, -1沒有
+	int scratch_cap;
+} people_ctx_t;
+
+dashboard_t dash; //所有雷達共用一個畫面, 各佔幾行
+int use_dbscan = 0; //--dbscan: 跑dbscan, 預設用v1.0的range bins
+
+//開不了csv回傳-1
+int people_ctx_init(people_ctx_t *ctx, int id, int mode, const char *csv_name)
 {
-	return (*(float*)a - *(float*)b);
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->id = id;
+	ctx->mode = mode;
+	if (id < 0)
+		snprintf(ctx->filename, sizeof(ctx->filename), "%s", csv_name);
+	else
+		snprintf(ctx->filename, sizeof(ctx->filename), "s%d_%s", id, csv_name); //每台雷達一個csv
+	snprintf(ctx->track_filename, sizeof(ctx->track_filename), "tracks_%s", ctx->filename);
+	//clusters一群至少有dbscan的minpts個點, tracker的群有1個點也算
+	track_table_init(&ctx->tracks, PEOPLE_MAX_TRACKS, PEOPLE_TRACK_GATE, PEOPLE_TRACK_MISSES, 1);
+	if (id < 0)
+		dashboard_region_init(&ctx->view, &dash, 0, 3 + PEOPLE_MAX_TRACKS); //標題, 說明, 姿態, 每個人一行
+	else
+		dashboard_region_init(&ctx->view, &dash, id * (1 + PEOPLE_MAX_TRACKS), 1 + PEOPLE_MAX_TRACKS);
+	if (result_log_open(&ctx->csv, ctx->filename, "a") != 0)
+		return -1;
+	if (result_log_open(&ctx->track_csv, ctx->track_filename, "a") != 0)
+	{
+		result_log_close(&ctx->csv);
+		return -1;
+	}
+	return 0;
 }
-//ieee 754 function decoder的strust 規範 ieee 754的格式
-typedef union {
-	float f;
-	struct
+
+//labels, members, clusters, axis, track_of放得下n個, 記憶體不夠回傳-1
+int people_ctx_reserve(people_ctx_t *ctx, int n)
+{
+	if (n <= ctx->scratch_cap)
+		return 0;
+	int *labels = realloc(ctx->labels, n * sizeof(*labels));
+	if (labels != NULL)
+		ctx->labels = labels;
+	unsigned int *members = realloc(ctx->members, n * sizeof(*members));
+	if (members != NULL)
+		ctx->members = members;
+	cluster_stats_t *clusters = realloc(ctx->clusters, n * sizeof(*clusters));
+	if (clusters != NULL)
+		ctx->clusters = clusters;
+	float *axis = realloc(ctx->axis, n * sizeof(*axis));
+	if (axis != NULL)
+		ctx->axis = axis;
+	int *track_of = realloc(ctx->track_of, n * sizeof(*track_of));
+	if (track_of != NULL)
+		ctx->track_of = track_of;
+	if (labels == NULL || members == NULL || clusters == NULL || axis == NULL || track_of == NULL)
 	{
-		unsigned int mantissa : 23;
-		unsigned int exponent : 8;
-		unsigned int sign : 1;
-	} raw;
-} myfloat;
-//ieee 754 function 從二進位轉成int
-unsigned int convertToInt(int* arr, int low, int high)
+		printf("Error allocating frame buffers\n");
+		return -1;
+	}
+	ctx->scratch_cap = n;
+	return 0;
+}
+
+void people_ctx_free(people_ctx_t *ctx)
+{
+	result_log_close(&ctx->csv);
+	result_log_close(&ctx->track_csv);
+	result_log_report(&ctx->csv);
+	result_log_report(&ctx->track_csv);
+	pc_cloud_free(&ctx->cloud);
+	free(ctx->labels);
+	free(ctx->members);
+	free(ctx->clusters);
+	free(ctx->axis);
+	free(ctx->track_of);
+	ctx->labels = NULL;
+	ctx->members = NULL;
+	ctx->clusters = NULL;
+	ctx->axis = NULL;
+	ctx->track_of = NULL;
+	ctx->scratch_cap = 0;
+}
+
+//一個人(track)這frame的姿態 0:坐 1:站 2:臥 3:跌, k是他這frame的群
+int people_track_posture(people_ctx_t *ctx, people_track_t *tr, float (*pos1X)[PC_CLOUD_COLS], const int *labels, const unsigned int *members, const cluster_stats_t *k)
+{
+  uint64_t t_stage;
+  int max_index_num = k->count;
+  //這群的點就是pos1X[members[m]]
+  int index_sensorA = max_index_num;
+  if (ctx->mode == 0)
+  {
+	  printf("index_sensorA %d\n", index_sensorA);
+	  for(unsigned int m = k->first; m < k->first + max_index_num; ++m)
+	  {
+		  int num = members[m];
+		  printf("x:%f y:%f z:%f range:%f Doppler:%f noise:%f label:%f\n", pos1X[num][0], pos1X[num][1], pos1X[num][2], pos1X[num][3], pos1X[num][4], pos1X[num][5], (float) labels[num]);  
+	  }
+  }
+  
+  //xyz三維的四分位數, 用選擇的不用排序, 值跟排序後取index一樣
+  t_stage = stage_begin();
+  order_quartiles_t q[3];
+  order_quartiles_rows(&pos1X[0][0], PC_CLOUD_COLS, members + k->first, max_index_num, 3, ctx->axis, q);
+  float q1_x, q3_x, x_irq, x_min, x_max;
+  float q1_y, q3_y, y_irq, y_min, y_max;
+  float q1_z, q3_z, z_irq, z_min, z_max, z_mean, z_sum;
+  q1_x = q[0].q1;
+  q3_x = q[0].q3;
+  x_irq = q3_x - q1_x;
+  x_max = q3_x + 0.5*x_irq;
+  x_min = q1_x - 0.5*x_irq;
+  q1_y = q[1].q1;
+  q3_y = q[1].q3;
+  y_irq = q3_y - q1_y;
+  y_max = q3_y + 0.5*y_irq;
+  y_min = q1_y - 0.5*y_irq;
+  q1_z = q[2].q1;
+  q3_z = q[2].q3;
+  z_irq = q3_z - q1_z;
+  z_max = q3_z + 1.5*z_irq;
+  z_min = q1_z - 1.5*z_irq;
+  stage_end(STAGE_QUARTILES, t_stage);
+  if (ctx->mode == 0)
+  {
+	  printf("q1_x:%f\n", q1_x);
+	  printf("q3_x:%f\n", q3_x);
+	  printf("q1_y:%f\n", q1_y);
+	  printf("q3_y:%f\n", q3_y);
+	  printf("q1_z:%f\n", q1_z);
+	  printf("q3_z:%f\n", q3_z);
+	  printf("x_max = %f\n", x_max);
+	  printf("x_min = %f\n", x_min);
+	  printf("y_max = %f\n", y_max);
+	  printf("y_min = %f\n", y_min);
+	  printf("z_max = %f\n", z_max);
+	  printf("z_min = %f\n", z_min);				  
+  }
+
+  
+  //z的總和分群時就算好了
+  z_sum = k->z_sum;
+  z_mean = z_sum/max_index_num;
+
+  //滿5frame以後用最近5frame的平均做smooth, 之前用這frame的值
+  rolling_window_push(&tr->x_max_win, x_max, NULL);
+  rolling_window_push(&tr->x_min_win, x_min, NULL);
+  rolling_window_push(&tr->y_max_win, y_max, NULL);
+  rolling_window_push(&tr->y_min_win, y_min, NULL);
+  rolling_window_push(&tr->z_max_win, z_max, NULL);
+  rolling_window_push(&tr->z_min_win, z_min, NULL);
+  rolling_window_push(&tr->z_mean_win, z_mean, NULL);
+  if (rolling_window_full(&tr->z_mean_win))
+  {
+	  x_max = rolling_window_mean(&tr->x_max_win); //算平均
+	  x_min = rolling_window_mean(&tr->x_min_win);
+	  y_max = rolling_window_mean(&tr->y_max_win);
+	  y_min = rolling_window_mean(&tr->y_min_win);
+	  z_max = rolling_window_mean(&tr->z_max_win);
+	  z_min = rolling_window_mean(&tr->z_min_win);
+	  z_mean = rolling_window_mean(&tr->z_mean_win);
+  }
+
+  float l1_dis;
+  l1_dis = sqrt(pow(x_min + ((x_max - x_min)/2), 2) + pow((y_min + (y_max - y_min)/2), 2));
+  float error_from_radar = 0.06;
+  z_mean = z_mean - error_from_radar;
+  //z_fall_lying都放z_mean, 擠出最近5個的進到前5個
+  float z_out;
+  if (rolling_window_push(&tr->z_fall_recent, z_mean, &z_out))
+	  rolling_window_push(&tr->z_fall_older, z_out, NULL);
+  int state_fall_lying = 0;
+  float tmp_threshold = 0.0;
+  float dif_z_thr = 0.0;
+  if (z_mean>0.7) //如果太高 可調整
+  {
+	  state_fall_lying = 0;
+  }
+  else
+  {
+	  if (rolling_window_full(&tr->z_fall_older)) //判斷z_fall_lying有10個數值
+	  {
+		  tmp_threshold = rolling_window_mean(&tr->z_fall_older); //前5個的平均
+		  dif_z_thr = fabs(tmp_threshold-z_mean);  //現在的z_mean>前5frame的z_mean
+		  if (dif_z_thr > 0.3) //可調整ori:0.67 //因為c語言這邊的刷新率較高所以往下跌的幅度要小一點
+		  {
+			  state_fall_lying = 1; //倒
+		  }
+	  }
+  }
+  //printf("dif_z_thr = %f\n", dif_z_thr);
+  /*
+  error_from_radar = randomForestModel.predict(np.array(l1_dis).reshape(-1, 1))
+  z_mean = z_mean - error_from_radar[0]
+  z_fall_lying.append(z_mean)
+  if len(z_fall_lying) > 10:
+	  z_fall_lying.pop(0)
+  if z_mean > 0.8:  # z_men > 0.8 (reset to 0)
+	  state_fall_lying = 0
+  else:
+	  if len(z_fall_lying) > 9:
+		  tmp_threshold = np.mean(z_fall_lying[:5])
+		  dif_z_thr = np.abs(tmp_threshold - z_mean)
+		  if dif_z_thr > 0.2:  # add: 放寬閾值
+			  state_fall_lying = 1
+  */
+  float lenofx, lenofy, lenofz; //算長度
+  lenofz = z_max - z_min; //算長度
+  lenofx = x_max - x_min; //算長度
+  lenofy = y_max - y_min; //算長度
+  
+  float stardand = 1.0;
+  int  state_people = 1;
+  if (lenofz/lenofx >= 1.0 || lenofz/lenofy >= 1.0 || lenofx == 0.0 || lenofy == 0.0)
+  {
+	  if (z_mean > (stardand / 10) * 7.3) //高於高度 可調整
+	  {
+		  state_people = 1; //站
+	  }
+	  else if (lenofz/lenofx < 0.85 || lenofz/lenofy < 0.95) //低於高度又是長方形
+	  {
+			if (state_fall_lying == 0) //臥跌判斷
+			{
+				state_people = 2; //臥
+			}
+			else
+			{
+				//printf("!!!!!!!!!!!!!!!!!!!!_fail_!!!!!!!!!!!!!!!!!!!!!!");
+				state_people = 3; //跌
+			}
+	  }
+	  else //什麼都不是就判斷坐
+	  {
+		  state_people = 0; // 坐
+	  }
+  }
+  else
+  {
+	  if (state_fall_lying == 0)  //臥跌判斷
+	  {
+		  state_people = 2; //臥
+	  }
+	  else
+	  {
+		  //printf("!!!!!!!!!!!!!!!!!!!!_fail_!!!!!!!!!!!!!!!!!!!!!!");
+		  state_people = 3; //跌
+	  }
+  }
+  return state_people;
+}
+//處理一個完整的frame, 每台雷達各有一個people_ctx_t
+//rx_ns是這frame最後的bytes收到的時間(mono_ns), 到解析, 分群, 姿態, 寫出各花多久記在stage timer
+int people_process_frame(people_ctx_t *ctx, const unsigned char *read_buf, int size, uint64_t rx_ns)
+{
+  time_t rawtime;
+  struct tm tm_now;
+  struct tm *info;
+  char time_text[32];
+  //限制一開始讀入的magicWord
+  int magicWord[8] = {2, 1, 4, 3, 6, 5, 8, 7};
+  //system("clear");
+  //printf("----------start-----------\n");
+  stage_timer_poll();
+  pc_frame_t pc;
+  int total_point = 0;
+  //初始state設為0
+  int state = 0;
+  if (state == 0)
+  {
+	  int same = 0;
+	  //讀取8bytes
+	  for (int ix=0; ix< 8; ++ix) 
+	  {		
+			//讀入的值要跟magicWord一樣才可以	
+			if (read_buf[ix] == magicWord[ix])
+			{	
+				if (ctx->mode == 0)
+				{
+					printf("%d\n", read_buf[ix]);
+				}
+				//fprintf(fp, "%d\n", read_buf[ix]);
+				same++;
+				if (same==8)
+				{   //讀滿8個magicWordstate轉成1
+					state = 1;
+				}
+			}
+			else
+			{
+				state = 0;
+				same = 0;
+				break;
+		    }
+	  }		  
+  }
+  /*
+  (self.hdr.version,self.hdr.totalPackLen,self.hdr.platform,
+  self.hdr.frameNumber,self.hdr.subframeNumber,
+  self.hdr.chirpMargin,self.hdr.frameMargin,self.hdr.trackProcessTime,self.hdr.uartSendTime,
+  self.hdr.numTLVs,self.hdr.checksum) = struct.unpack('9I2H', sbuf)
+  */
+  uint64_t t_stage = stage_begin(); //各階段耗時, --timing-every N 或 SIGUSR1 印出
+  if (state ==1)
+  {	
+	  //header之後的numTLVs個TLV全部走過一次, 6:點雲 7:target list 8:target index, 其他type照長度跳過
+	  //TLV長度超過10000或超出frame長度會被重來
+	  if (pc_parse_frame(read_buf, size, &pc) != 0)
+	  {
+		  state = 0;
+	  }
+	  else
+	  {
+		  state = 2;
+		  stage_end(STAGE_RX_PARSE, rx_ns);
+	  }
+	  if(ctx->mode ==0 && state == 2)
+	  {
+		  printf("----------header-----------\n");
+		  printf("%u\n%u\n%u\n%u\n%u\n%u\n%u\n%u\n%u\n", pc.header.version, pc.header.totalPackLen, pc.header.platform,
+				 pc.header.frameNumber, pc.header.subframeNumber, pc.header.chirpMargin, pc.header.frameMargin,
+				 pc.header.trackProcessTime, pc.header.uartSendTime);
+		  printf("%u\n%u\n", pc.header.numTLVs, pc.header.checksum);
+		  printf("----------TLV-----------\n");
+		  printf("points:%d targets:%d target index:%d skipped:%d\n", pc.num_points, pc.num_targets, pc.num_index, pc.skipped_tlvs);
+	  }
+  }
+  if (state == 2)
+  {
+	  total_point = pc.num_points;
+	  state = 4;
+  }
+  //(e,a,d,r,s) = struct.unpack('2b3h', sbuf) 
+  if (state == 4) //v6
+  {
+	  //點在state 5解碼時順便刪snr跟轉座標
+	  stage_end(STAGE_DECODE, t_stage);
+	  if (total_point > 0)
+	  {
+		  state = 5;
+	  }
+  }
+  
+  if (state == 5)
+  {
+	  
+	  //printf("state = %d\n", state);
+	  float snr_tr = 2.0; //太小的SNR刪除閥值! 可調整
+	  float zOffSet = 1.0;
+	  /*
+	  Python Code
+	  for i in range(len(pct)):
+		  zt = pct[i][3] * np.sin(pct[i][0]) + zOffSet
+		  xt = pct[i][3] * np.cos(pct[i][0]) * np.sin(pct[i][1])
+		  yt = pct[i][3] * np.cos(pct[i][0]) * np.cos(pct[i][1])
+		  pos1X[i] = (xt,yt,zt,pct[i][3],pct[i][2],pct[i][4]) # [x,y,z,range,Doppler,noise]
+	  */
+	  //解碼, 刪掉snr不大於snr_tr的, 轉成pos1X一次做完, 放在ctx->cloud裡不用每frame開陣列
+	  t_stage = stage_begin();
+	  if (pc_cloud_build(&ctx->cloud, &pc, snr_tr, zOffSet) < 0)
+	  {
+		  return -1;
+	  }
+	  if (ctx->mode == 0)
+	  {
+		  printf("small snr:%u\n", ctx->cloud.dropped);
+	  }
+	  int row_wo_snr = ctx->cloud.num_points;
+	  float (*pos1X)[PC_CLOUD_COLS] = ctx->cloud.rows;
+	  stage_end(STAGE_TRANSFORM, t_stage);
+	  //雷達有送target list(type 7)就直接用target在list裡的順序(0 ~ num_targets-1)當label, tid再大也不影響群數, 不用在host上跑dbscan
+	  //一個點都沒被target認領才退回range bins, 有--dbscan時退回dbscan
+	  //labels[num]是pos1X第num個點的label, 不屬於任何群的是NOISE(-2)
+	  if (people_ctx_reserve(ctx, row_wo_snr) != 0)
+	  {
+		  return -1;
+	  }
+	  int num_labels = 0; //label是0 ~ num_labels-1
+	  int tracker = pc.num_targets > 0 && pc_targets_label_points(&pc, &pos1X[0][0], PC_CLOUD_COLS, row_wo_snr, PEOPLE_TARGET_GATE, ctx->labels) > 0;
+	  if (tracker)
+	  {
+		  for(int num=0; num < row_wo_snr; ++num)
+		  {
+			  if (ctx->labels[num] >= num_labels)
+			  {
+				  num_labels = ctx->labels[num] + 1;
+			  }
+		  }
+	  }
+	  else if (!use_dbscan) //v1.0: 每個點的群就是range取整數, 1公尺一群
+	  {
+		  num_labels = cluster_range_bins(&pos1X[0][0], PC_CLOUD_COLS, row_wo_snr, PC_CLOUD_RANGE, ctx->labels);
+	  }
+	  //每群的點數, 中心, 範圍, z總和, Doppler平均, 跟分群同時算好
+	  //members[clusters[k].first]開始的clusters[k].count個是第k群的點
+	  int max_clusters = num_labels > row_wo_snr ? num_labels : row_wo_snr;
+	  if (people_ctx_reserve(ctx, max_clusters) != 0)
+	  {
+		  return -1;
+	  }
+	  int *labels = ctx->labels;
+	  cluster_stats_t *clusters = ctx->clusters;
+	  unsigned int *members = ctx->members;
+	  if (tracker)
+	  {
+		  cluster_stats_build(clusters, num_labels, &pos1X[0][0], PC_CLOUD_COLS, row_wo_snr, labels, PC_CLOUD_DOPPLER, members);
+		  ctx->tracker_frames++;
+	  }
+	  else if (!use_dbscan)
+	  {
+		  cluster_stats_build(clusters, num_labels, &pos1X[0][0], PC_CLOUD_COLS, row_wo_snr, labels, PC_CLOUD_DOPPLER, members);
+	  }
+	  else
+	  {
+		  //送進dbscan, 座標已經在pos1X裡不用再拿一份
+		  t_stage = stage_begin();
+		  num_labels = dbscan_labels(&pos1X[0][0], PC_CLOUD_COLS, row_wo_snr, labels, NULL, clusters, PC_CLOUD_DOPPLER, members);
+		  stage_end(STAGE_DBSCAN, t_stage);
+		  ctx->dbscan_frames++;
+	  }
+	  stage_end(STAGE_RX_CLUSTER, rx_ns);
+	  if (num_labels <= 0) //全部都是noise, 這個frame沒有人可以判斷
+	  {
+		  if (ctx->mode == 0)
+		  {
+			  printf("no cluster\n");
+		  }
+		  return 0;
+	  }
+	  //點最多的群, 一樣多取後面的, 畫面跟csv主要顯示他
+	  int max_index = cluster_stats_largest(clusters, num_labels);
+	  //每群對到一個人(track), smooth跟臥跌的歷史跟著人走, 不會被房間裡別人的群蓋掉
+	  track_table_update(&ctx->tracks, clusters, num_labels, ctx->track_of);
+	  for (int k = 0; k < num_labels; ++k)
+	  {
+		  int slot = ctx->track_of[k];
+		  if (slot < 0)
+		  {
+			  continue;
+		  }
+		  people_track_t *tr = &ctx->people[slot];
+		  if (ctx->tracks.tracks[slot].hits == 1) //新的人, 歷史重來
+		  {
+			  people_track_reset(tr);
+		  }
+		  if (ctx->mode == 0)
+		  {
+			  printf("track %d label %d\n", ctx->tracks.tracks[slot].id, k);
+		  }
+		  int state_track = people_track_posture(ctx, tr, pos1X, labels, members, &clusters[k]);
+		  if (state_track == 3 && tr->state_people != 3) //剛跌倒, 先通知(callback / --fall-fifo)再顯示跟寫csv
+		  {
+			  fall_event_t e = {ctx->id, ctx->tracks.tracks[slot].id, rx_ns, mono_ns()};
+			  fall_alert_fire(&e);
+		  }
+		  tr->state_people = state_track;
+	  }
+	  stage_end(STAGE_RX_POSTURE, rx_ns);
+	  int primary = ctx->track_of[max_index];
+	  if (primary < 0) //人數超過track表, 最大群排不進去
+	  {
+		  return 0;
+	  }
+	  int state_people = ctx->people[primary].state_people;
+	  //worker thread 裡要用 localtime_r / asctime_r
+	  time(&rawtime);
+	  info = localtime_r(&rawtime, &tm_now);
+	  asctime_r(info, time_text);
+	  //畫面只改有變的行, 最多--display-hz次/秒, 不到時間這裡什麼都不做
+	  if (dashboard_begin(&ctx->view))
+	  {
+		  if (ctx->id < 0)
+		  {
+			  dashboard_printf(&ctx->view, "       Version: V1.0            \n");
+			  dashboard_printf(&ctx->view, "0 = 坐 | 1 = 站 | 2 = 臥 | 3 = 跌\n");
+			  dashboard_printf(&ctx->view, "姿態 = %d %s", state_people, time_text);
+		  }
+		  else
+		  {
+			  dashboard_printf(&ctx->view, "雷達 %d 姿態 = %d %s", ctx->id, state_people, time_text);
+		  }
+		  for (int slot = 0; slot < PEOPLE_MAX_TRACKS; ++slot) //這frame看到的每個人
+		  {
+			  const track_t *t = &ctx->tracks.tracks[slot];
+			  if (t->active && t->misses == 0)
+			  {
+				  dashboard_printf(&ctx->view, "%s  人 %d 姿態 = %d (%.2f, %.2f)%s\n", ctx->id >= 0 ? "  " : "", t->id, ctx->people[slot].state_people, t->pos[0], t->pos[1], slot == primary ? " *" : "");
+			  }
+		  }
+		  dashboard_end(&ctx->view);
+	  }
+	  // Write data to csv
+	  t_stage = stage_begin();
+	  result_log_printf(&ctx->csv, "%d, %s", state_people, time_text);
+	  //每個人一行: 編號, 姿態, 時間
+	  for (int slot = 0; slot < PEOPLE_MAX_TRACKS; ++slot)
+	  {
+		  const track_t *t = &ctx->tracks.tracks[slot];
+		  if (t->active && t->misses == 0)
+		  {
+			  result_log_printf(&ctx->track_csv, "%d, %d, %s", t->id, ctx->people[slot].state_people, time_text);
+		  }
+	  }
+	  stage_end(STAGE_FILE_IO, t_stage);
+	  stage_end(STAGE_RX_OUTPUT, rx_ns);
+  }
+  return 0;
+}
+//sensor_hub的worker thread呼叫, s->ctx是這台雷達的people_ctx_t
+int people_sensor_process(sensor_t *s, const sensor_frame_t *frame)
 {
-	unsigned f = 0, i;
-	for (i = high; i >= low; i--) {
-		f = f + arr[i] * pow(2, high - i);
+	return people_process_frame((people_ctx_t *) s->ctx, frame->data, (int) frame->len, frame->rx_ns);
+}
+
+sensor_hub_t hub;
+
+//--xxx N的N, 不是lo ~ hi的整數印出錯誤回傳-1
+int int_option(int argc, char *argv[], int i, int lo, int hi)
+{
+	if (i + 1 >= argc)
+	{
+		printf("%s expects an argument\n", argv[i]);
+		return -1;
+	}
+	char *end;
+	long v = strtol(argv[i + 1], &end, 10);
+	if (end == argv[i + 1] || *end != '\0' || v < lo || v > hi)
+	{
+		printf("%s expects %d to %d, got %s\n", argv[i], lo, hi, argv[i + 1]);
+		return -1;
 	}
-	return f;
+	return (int) v;
 }
-// ieee 754 convert main function
-unsigned int ieee754_convert(int* ieee)
+//--workers N: 多個--device時跑pipeline的thread數, 預設2, N不對回傳-1
+int workers_arg(int argc, char *argv[])
 {
-	myfloat var;
-	unsigned f = convertToInt(ieee, 9, 31);
-	var.raw.mantissa = f;
-	f = convertToInt(ieee, 1, 8);
-	var.raw.exponent = f;
-	var.raw.sign = ieee[0];
-	return var.f;
+	for (int i = 1; i < argc; i++)
+		if (strcmp(argv[i], "--workers") == 0)
+			return int_option(argc, argv, i, 1, SENSOR_HUB_MAX_WORKERS);
+	return 2;
 }
-// tlvTypeInfo的strust
-struct tlvTypeInfo{
-	int unitByte;
-	int stateString;
-	int sbyte;
-	int dataByte;
-	int retCnt;
-	float nPoint;
-	};
-//玖邦python SDK寫死unitByte, sbyte, dataByte, stateString數值
-struct tlvTypeInfo changeit(struct tlvTypeInfo, int state, int count);
-struct tlvTypeInfo changeit(struct tlvTypeInfo s, int state, int count)
+//--dbscan-threads N: 點雲有DBSCAN_PARALLEL_MIN_POINTS個以上時dbscan用N個thread, 預設1, N不對回傳-1
+int dbscan_threads_arg(int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++)
+		if (strcmp(argv[i], "--dbscan-threads") == 0)
+			return int_option(argc, argv, i, 1, TASK_POOL_MAX_THREADS);
+	return 1;
+}
+
+//--dbscan: 用dbscan分群, 預設照v1.0每個點的群就是range取整數(1公尺一群), 門檻還沒對dbscan的群調過
+int dbscan_arg(int argc, char *argv[])
 {
-	s.unitByte = 20;
-	s.sbyte = 8;
-	s.dataByte = 0;
-	s.stateString = 3;
-	if (state = 2)//相當於python sdk v6
+	for (int i = 1; i < argc; i++)
+		if (strcmp(argv[i], "--dbscan") == 0)
+			return 1;
+	return 0;
+}
+
+int run_sensor_hub(const char **devices, int num_devices, int mode, const char *csv_name, int workers)
+{
+	static people_ctx_t ctxs[SENSOR_HUB_MAX];
+	if (sensor_hub_init(&hub, people_sensor_process) != 0)
+	{
+		return 1;
+	}
+	for (int i = 0; i < num_devices; ++i)
+	{
+		if (people_ctx_init(&ctxs[i], i, mode, csv_name) != 0)
+		{
+			for (int j = 0; j < i; ++j)
+				people_ctx_free(&ctxs[j]);
+			sensor_hub_free(&hub);
+			return 1;
+		}
+		if (sensor_hub_add(&hub, devices[i], &ctxs[i]) < 0)
+		{
+			for (int j = 0; j <= i; ++j)
+				people_ctx_free(&ctxs[j]);
+			sensor_hub_free(&hub);
+			return 1;
+		}
+		hub.sensors[i].reader.verify_checksum = 1; //people counting header有checksum
+		printf("雷達 %d = %s, csv = %s\n", i, devices[i], ctxs[i].filename);
+	}
+	hub.stop_flag = &stop_requested; //Ctrl+C 結束並印出統計
+	stop_signal_init();
+	sensor_hub_run(&hub, workers);
+	dashboard_close(&dash); //統計印在畫面下面
+	sensor_hub_report(&hub);
+	stage_timer_report();
+	fall_alert_report();
+	fall_alert_close();
+	for (int i = 0; i < num_devices; ++i)
 	{
-		s.unitByte = 20;
-		s.sbyte = 8;
-		s.dataByte = 8;
+		printf("雷達 %d label: tracker %lu frames, dbscan %lu frames\n", i, ctxs[i].tracker_frames, ctxs[i].dbscan_frames);
+		people_ctx_free(&ctxs[i]);
 	}
-	s.retCnt =  count - s.unitByte - s.sbyte;
-	s.nPoint =  s.retCnt / s.sbyte;
-	return (s);
+	sensor_hub_free(&hub);
+	return 0;
 }
 int main(int argc, char *argv[]) {
   //mode = *(argv[1]);
@@ -92,6 +679,13 @@ int main(int argc, char *argv[]) {
   int mode = atoi((argv[1])); //1:顯示mode 0:debug mode
   //++++++++++++++++++++++++++++++++++++//
   //printf("%s", argv[1]);
+  int dbscan_threads = dbscan_threads_arg(argc, argv); //先檢查, 不對就不用輸入檔名
+  int workers = workers_arg(argc, argv);
+  if (dbscan_threads < 0 || workers < 0)
+  {
+      printf("usage: %s <0:debug|1:顯示> [--dbscan-threads 1-%d] [--workers 1-%d]\n", argv[0], TASK_POOL_MAX_THREADS, SENSOR_HUB_MAX_WORKERS);
+      return 1;
+  }
   time_t rawtime;
   struct tm *info;
   char buffer[80];
@@ -104,696 +698,84 @@ int main(int argc, char *argv[]) {
   printf("輸入檔名+.csv：");
   //輸入的檔名 變數=csv_name
   scanf("%s", csv_name);
-  char *filename = csv_name;
-  int serial_port = open("/dev/ttyTHS1", O_RDWR);
-  struct termios tty;
-  Struct output;
-  //宣告PORT號
-  //output = dbscan_output();
-  if(tcgetattr(serial_port, &tty) != 0) {
-      printf("Error %i from tcgetattr: %s\n", errno, strerror(errno));
+  stage_timer_init(argc, argv);
+  result_log_config(argc, argv);
+  //--headless 不顯示, --display-hz N 畫面更新率, debug mode照舊一行行印出
+  dashboard_init(&dash, argc, argv, mode == 0);
+  //--fall-fifo <檔名> 跌倒當下寫一行到named pipe
+  fall_alert_init(argc, argv);
+  dbscan_set_threads(dbscan_threads);
+  use_dbscan = dbscan_arg(argc, argv);
+  //多個 --device 時一個process服務全部雷達: epoll讀取, worker threads跑各自的pipeline
+  const char *devices[SENSOR_HUB_MAX];
+  int num_devices = sensor_hub_device_args(argc, argv, devices);
+  if (num_devices > 1)
+  {
+      for (int i = 1; i < argc; i++)
+      {
+          if (strcmp(argv[i], "--record") == 0 || strcmp(argv[i], "--replay") == 0)
+          {
+              printf("%s works with one --device only\n", argv[i]);
+              return 1;
+          }
+      }
+      return run_sensor_hub(devices, num_devices, mode, csv_name, workers);
+  }
+  //--record <檔名> 錄下UART原始資料, --replay <檔名> [--speed N|max] 不接雷達重播
+  capture_t capture;
+  if (capture_parse_args(&capture, argc, argv) != 0) {
       return 1;
   }
-  //獲取時間
-  tty.c_cflag &= ~PARENB; 
-  tty.c_cflag &= ~CSTOPB;
-  tty.c_cflag &= ~CSIZE; 
-  tty.c_cflag |= CS8; 
-  tty.c_cflag &= ~CRTSCTS;
-  tty.c_cflag |= CREAD | CLOCAL; 
-  tty.c_lflag &= ~ICANON;
-  tty.c_lflag &= ~ECHO; 
-  tty.c_lflag &= ~ECHOE; 
-  tty.c_lflag &= ~ECHONL; 
-  tty.c_lflag &= ~ISIG; 
-  tty.c_iflag &= ~(IXON | IXOFF | IXANY); 
-  tty.c_iflag &= ~(IGNBRK|BRKINT|PARMRK|ISTRIP|INLCR|IGNCR|ICRNL); 
-  tty.c_oflag &= ~OPOST;
-  tty.c_oflag &= ~ONLCR;
-  tty.c_cc[VTIME] = 10;   
-  tty.c_cc[VMIN] = 0;
-  //Baudrate
-  cfsetispeed(&tty, B921600);
-  cfsetospeed(&tty, B921600);
-  //如果沒有PORT 跳錯誤
-  if (tcsetattr(serial_port, TCSANOW, &tty) != 0) {
-      printf("Error %i from tcsetattr: %s\n", errno, strerror(errno));
+  int serial_port = -1;
+  if (capture.mode != CAPTURE_REPLAY) {
+      serial_port = serial_open(serial_device_arg(argc, argv));
+      if (serial_port < 0) {
+          return 1;
+      }
+  }
+  //放讀入的byte 由frame_reader重組成完整的frame
+  frame_reader_t reader;
+  if (frame_reader_init(&reader, serial_port) != 0) {
+      printf("Error from frame_reader_init\n");
       return 1;
   }
-  //放讀入的byte
-  char read_buf [102400];
+  frame_reader_set_capture(&reader, &capture);
+  reader.verify_checksum = 1; //people counting header有checksum, 錯誤數會在結束時印出
+  const unsigned char *read_buf;
   int size;
-  //限制一開始讀入的magicWord
-  int magicWord[8] = {2, 1, 4, 3, 6, 5, 8, 7};
-  unsigned long int header_reader_output[9];
-  unsigned long int byte[4];
-  unsigned int ieee[32];
-  int k=0;
-  system("clear");
-  while(1) 
+  static people_ctx_t ctx; //每個人的歷史都在裡面, 不放stack
+  if (people_ctx_init(&ctx, -1, mode, csv_name) != 0)
+  {
+      return 1;
+  }
+  stop_signal_init(); //Ctrl+C 或 kill 結束迴圈, 照樣寫完 csv 並印出統計
+  while (!stop_requested) 
   {
 
-	  while ((size = read(serial_port, &read_buf, sizeof(read_buf)-1))>0)
+	  while (!stop_requested && (size = frame_reader_read(&reader, &read_buf))>0)
 	  {
-		  //system("clear");
-		  struct tlvTypeInfo tlvTypeInfo_value1;
-		  struct tlvTypeInfo tlvTypeInfo_value;
-		  //printf("----------start-----------\n");
-		  float V6_unit[5];
-		  int total_point;
-		  total_point = (int) tlvTypeInfo_value1.retCnt/8.0;
-		  int v6_point_before[5];
-		  float v6_point_after[5];
-		  float v6_2d_output[total_point][5];	
-		  //初始state設為0
-		  int state = 0;
-		  if (state == 0)
-		  {
-			  int same = 0;
-			  //讀取8bytes
-			  for (int ix=0; ix< 8; ++ix) 
-			  {		
-					//讀入的值要跟magicWord一樣才可以	
-					if (read_buf[ix] == magicWord[ix])
-					{	
-						if (mode == 0)
-						{
-							printf("%d\n", read_buf[ix]);
-						}
-						//fprintf(fp, "%d\n", read_buf[ix]);
-						same++;
-						if (same==8)
-						{   //讀滿8個magicWordstate轉成1
-							state = 1;
-						}
-					}
-					else
-					{
-						state = 0;
-						same = 0;
-						memset(read_buf, 0, 102400);
-						break;
-				    }
-			  }		  
-		  }
-		  /*
-		  (self.hdr.version,self.hdr.totalPackLen,self.hdr.platform,
-		  self.hdr.frameNumber,self.hdr.subframeNumber,
-		  self.hdr.chirpMargin,self.hdr.frameMargin,self.hdr.trackProcessTime,self.hdr.uartSendTime,
-		  self.hdr.numTLVs,self.hdr.checksum) = struct.unpack('9I2H', sbuf)
-		  */
-		  if (state ==1)
-		  
-		  {	
-			  if(mode ==0)
-			  {
-				  printf("----------header-----------\n");
-			  }
-			  //前8個已經被state=0讀過了，所以讀後40個bytes 1I=2H 1I=4Bytes
-			  for (int ix=8; ix< 48; ++ix) 
-			  {
-				  //解self.hdr.version,self.hdr.totalPackLen,self.hdr.platform,self.hdr.frameNumber,self.hdr.subframeNumber,self.hdr.chirpMargin,self.hdr.frameMargin,self.hdr.trackProcessTime,self.hdr.uartSendTime,
-				  if (ix<44)
-				  {
-					  if (ix%4==0)
-					  {
-						  if (mode == 0)
-						  {
-							  printf("%d\n", ((read_buf[ix] << 0) + (read_buf[ix+1] << 8) + (read_buf[ix+2] << 16) + (read_buf[ix+3] << 24)) );
-						  }
-						  
-					  }			  
-				  }
-				  else
-				  {
-					  //解self.hdr.numTLVs,self.hdr.checksum
-					  if (ix%2==0)
-					  {	  
-						  if (mode == 0)
-						  {
-							  printf("%d\n", ((read_buf[ix] << 0) + (read_buf[ix+1] << 8)));
-						  }
-
-					  }  
-					  if (ix==47)
-					  {
-						  state = 2;
-						  //讀完40個byte後 state = 2
-					  }
-				  }
-			  }
-		  }
-		  if (state ==2)
-		  {
-			  int tlvLength;
-			  if (mode == 0)
-			  {
-				  printf("----------TLV Header-----------\n");
-			  }
-			  
-			  for (int ix=48; ix< 56; ++ix) 
-			  {
-				  if (ix%4==0)
-				  {
-					  //struct.unpack('2I', sbuf)產生tlvLength
-					  tlvLength = ((read_buf[ix] << 0) + (read_buf[ix+1] << 8) + (read_buf[ix+2] << 16) + (read_buf[ix+3] << 24)); 
-					  //printf("%d\n", ((read_buf[ix] << 0) + (read_buf[ix+1] << 8) + (read_buf[ix+2] << 16) + (read_buf[ix+3] << 24)) );
-					  if (ix == 48)
-					  {
-						  //ttype 這裡是後來發現的這個值只會有6, 7, 8，對應sdk的state 
-						  if (tlvLength != 6)
-						  {
-							  state = 0;
-							  break;
-						  }
-					  }
-					  if (ix == 52)
-					  {
-						  //tlvLength 超過10000會被重來
-						  if (tlvLength > 10000)
-						  {
-							  state = 0;
-							  break;
-						  }
-					  }
-					  if (mode == 0)
-					  {
-						  printf("%d\n", ((read_buf[ix] << 0) + (read_buf[ix+1] << 8) + (read_buf[ix+2] << 16) + (read_buf[ix+3] << 24)) );
-					  }
-					  
-				  }
-				  
-				  if (ix==55)
-				  {   //unitByteCount,lstate ,plen ,dataBytes,lenCount, numOfPoints = self.tlvTypeInfo(ttype,self.tlvLength,disp)丟進副程式tlvTypeInfo()
-					  tlvTypeInfo_value1 = changeit(tlvTypeInfo_value, state, tlvLength);
-					  /* 會回傳以下值 供後續處理
-					  printf("unitByte:%d\n", tlvTypeInfo_value1.unitByte);
-					  printf("stateString:%d\n", tlvTypeInfo_value1.stateString);
-					  printf("sbyte:%d\n", tlvTypeInfo_value1.sbyte);
-					  printf("dataByte:%d\n", tlvTypeInfo_value1.dataByte);
-					  printf("retCnt:%d\n", tlvTypeInfo_value1.retCnt);
-					  printf("nPoint:%f\n", tlvTypeInfo_value1.nPoint);
-					  
-					  printf("unitByte:%d\n", tlvTypeInfo_value1.unitByte);
-					  printf("stateString:%d\n", tlvTypeInfo_value1.stateString);
-					  printf("sbyte:%d\n", tlvTypeInfo_value1.sbyte);
-					  printf("dataByte:%d\n", tlvTypeInfo_value1.dataByte);
-					  printf("retCnt:%d\n", tlvTypeInfo_value1.retCnt);
-					  printf("nPoint:%f\n", tlvTypeInfo_value1.nPoint);	
-					  */			  
-					  state = tlvTypeInfo_value1.stateString;
-				  }
-				  
-			  }
-		  }
-		  if (state == 3)
+		  if (people_process_frame(&ctx, read_buf, size, reader.rx_ns) != 0)
 		  {
-			  //5f
-			  //self.u.elevationUnit,self.u.azimuthUnit,self.u.dopplerUnit,self.u.rangeUnit,self.u.snrUnit = struct.unpack('5f', sbuf) 解5個float
-			  //float unit_array[5] = {0.01, 0.01, 0.00028, 0.00025, 0.04};
-			  for (int ix2=0; ix2<5; ++ix2) 
-			  {
-				  for (int ix1=59+(ix2*4); ix1> 55+(ix2*4); --ix1) 
-				  {
-					  //printf("%dix1:\n", ix1);
-					  for (int ix=0; ix< 8; ++ix) 
-					  {
-						  ieee[k] = (read_buf[ix1] << ix & 0x80) >> 7; //把讀到的8個待處理的bytes位移存到陣列裡
-						  k++;
-					  }				  
-				  }
-				  //處理ieee 754
-				  k = 0;
-				  myfloat var;
-				  unsigned f = convertToInt(ieee, 9, 31);
-				  var.raw.mantissa = f;
-				  f = convertToInt(ieee, 1, 8);      
-				  var.raw.exponent = f;
-				  var.raw.sign = ieee[0];
-				  //V6_unit 存 self.u.elevationUnit,self.u.azimuthUnit,self.u.dopplerUnit,self.u.rangeUnit,self.u.snrUnit 
-				  V6_unit[ix2] = var.f;
-				  //printf("unit %f\n", var.f);		
-			  }	
-			  state = 4;		  
+			  dashboard_close(&dash);
+			  people_ctx_free(&ctx); //寫完還在buffer裡的結果
+			  return -1;
 		  }
-		  //(e,a,d,r,s) = struct.unpack('2b3h', sbuf) 
-		  if (state == 4) //v6
-		  {
-			  
-			  for (int id_point=0; id_point< total_point; ++id_point) 
-			  {
-				  //int index = 76;
-				  int index = 76+(8*id_point);
-				  for (int ix=index; ix< index+2; ++ix) //76-84 先解2b
-				  {
-					  if (read_buf[ix]>128) //因為有正負號要先判斷
-					  {
-						  signed char aaa;
-						  aaa = read_buf[ix];
-						  v6_point_before[ix-index] = aaa;
-					  }
-					  else //因為有正負號要先判斷
-					  {
-						  char aaa;
-						  aaa = read_buf[ix];
-						  v6_point_before[ix-index] = aaa;
-					  }
-				  }//printf("%d\n", ((read_buf[ix] << 0) + (read_buf[ix+1] << 8)));
-				  for (int ix=index+2; ix< index+8; ix = ix+2) //76-84 再解3h
-				  {
-					  if (((read_buf[ix] << 0) + (read_buf[ix+1] << 8))>32768)  //因為有正負號要先判斷
-					  {
-						  signed short bbb;
-						  bbb = ((read_buf[ix] << 0) + (read_buf[ix+1] << 8));
-						  v6_point_before[(ix-(index-2))/2] = bbb;
-					  }
-					  else //因為有正負號要先判斷
-					  {
-						  short bbb;
-						  bbb = ((read_buf[ix] << 0) + (read_buf[ix+1] << 8));
-						  v6_point_before[(ix-(index-2))/2] = bbb;
-					  }
-				  }
-				  //v6_point_before放的就是e,a,d,r,s
-				  /*
-				  elv = e * self.u.elevationUnit
-				  azi = a * self.u.azimuthUnit
-		    	  dop = d * self.u.dopplerUnit
-				  ran = r * self.u.rangeUnit
-				  snr = s * self.u.snrUnit
-				  */
-				  size_t len_v6_point = sizeof(v6_point_before)/sizeof(v6_point_before[0]);
-				  for(int num=0; num < len_v6_point; ++num)
-				  {
-					  v6_point_after[num] = v6_point_before[num]*V6_unit[num]; //相乘得到elv, azi, dop, ran, snr
-					  v6_2d_output[id_point][num] = v6_point_before[num]*V6_unit[num]; //相乘得到elv, azi, dop, ran, snr
-				  }
-				  //printf("elevation:%f azimuth:%f doppler:%f range:%f snr:%f\n", v6_point_after[0], v6_point_after[1], v6_point_after[2], v6_point_after[3], v6_point_after[4]);				  
-			      if (id_point == total_point - 1)
-			      {
-					  state = 5;		
-				  }
-			  }
-		  }
-		  
-		  if (state == 5)
-		  {
-			  
-			  //printf("state = %d\n", state);
-			  int row = sizeof(v6_2d_output) / sizeof(v6_2d_output[0]); //二維陣列的大小
-			  int column = sizeof(v6_2d_output[0])/sizeof(v6_2d_output[0][0]); //二維陣列的大小
-			  int small_snr_count = 0;
-			  float snr_tr = 2.0; //太小的SNR刪除閥值! 可調整
-			  for(int num=0; num < row; ++num)//找snr小於2的
-			  {
-				  //v6_2d_output[num][4] ＝ v6_2d_output[num][4]-5.0;
-				  if (v6_2d_output[num][4]<snr_tr)
-				  {
-					  if (mode == 0)
-					  {
-						  printf("snr:%f\n", v6_2d_output[num][4]); //小於2會被PRINT出來
-					  }
-					  //
-					  small_snr_count+=1;
-				  }
-			  }
-			  int wo_snr = 	row - small_snr_count; //陣列大小變了 因為小於2的要刪掉
-			  float v6_2d_output_wo_snr[wo_snr][5];
-			  int count = 0;
-			  for(int num=0; num < row; ++num)//把snr大於2的放陣列
-			  {
-				  if (v6_2d_output[num][4]>snr_tr)
-				  {
-					  v6_2d_output_wo_snr[count][0] = v6_2d_output[num][0]; //再放一遍
-					  v6_2d_output_wo_snr[count][1] = v6_2d_output[num][1]; //再放一遍
-					  v6_2d_output_wo_snr[count][2] = v6_2d_output[num][2]; //再放一遍
-					  v6_2d_output_wo_snr[count][3] = v6_2d_output[num][3]; //再放一遍
-					  v6_2d_output_wo_snr[count][4] = v6_2d_output[num][4]; //再放一遍
-					  count+=1;
-				  }
-			  } 
-			  //v6_2d_output_wo_snr現在處理的陣列
-			  int row_wo_snr = sizeof(v6_2d_output_wo_snr) / sizeof(v6_2d_output_wo_snr[0]);
-			  int column_wo_snr = sizeof(v6_2d_output_wo_snr[0])/sizeof(v6_2d_output_wo_snr[0][0]);
-
-			  float pos1X[row_wo_snr][6];	 
-			  float zOffSet = 1.0;
-			  /*
-			  printf("Number of rows: %d\n", row_wo_snr);
-			  printf("Number of columns: %d\n", column_wo_snr);
-			  Python Code
-			  for i in range(len(pct)):
-				  zt = pct[i][3] * np.sin(pct[i][0]) + zOffSet
-				  xt = pct[i][3] * np.cos(pct[i][0]) * np.sin(pct[i][1])
-				  yt = pct[i][3] * np.cos(pct[i][0]) * np.cos(pct[i][1])
-				  pos1X[i] = (xt,yt,zt,pct[i][3],pct[i][2],pct[i][4]) # [x,y,z,range,Doppler,noise]
-			  */
-			  for(int num=0; num < row_wo_snr; ++num)
-			  {
-				  float zt;
-				  float xt;
-				  float yt;
-				  zt = v6_2d_output_wo_snr[num][3] * sin(v6_2d_output_wo_snr[num][0]) + zOffSet;
-				  xt = v6_2d_output_wo_snr[num][3] * cos(v6_2d_output_wo_snr[num][0]) * sin(v6_2d_output_wo_snr[num][1]);
-				  yt = v6_2d_output_wo_snr[num][3] * cos(v6_2d_output_wo_snr[num][0]) * cos(v6_2d_output_wo_snr[num][1]);
-				  //printf("elevation:%f azimuth:%f doppler:%f range:%f snr:%f\n", v6_2d_output[num][0], v6_2d_output[num][1], v6_2d_output[num][2], v6_2d_output[num][3], v6_2d_output[num][4]);				  
-				  pos1X[num][0] = xt;
-				  pos1X[num][1] = yt;
-				  pos1X[num][2] = zt;
-				  pos1X[num][3] = v6_2d_output_wo_snr[num][3];
-				  pos1X[num][4] = v6_2d_output_wo_snr[num][2];
-				  pos1X[num][5] = v6_2d_output_wo_snr[num][4];
-			  }	
-			  //送進dbscan
-			  output = dbscan_output(pos1X, row_wo_snr);
-
-			  float index_point[row_wo_snr];
-			  //output.vsos[num][3]為dbscan輸出的label, index_point存所有的label
-			  for(int num=0; num < row_wo_snr; ++num)
-			  {
-				  index_point[num] = output.vsos[num][3];
-			  }
-			  //排列LABEL
-			  qsort(index_point, row_wo_snr, sizeof(float), cmpfunc);
-
-			  int maxofindex = (int) index_point[row_wo_snr-1]; //找最大的LABEL
-			  int countarray[maxofindex+1]; //用來計算LABEL的數量
-			  //陣列都設為0
-			  for(int num=0; num < maxofindex+1; ++num)
-			  {
-				  countarray[num] = 0;
-			  }
-			  //找最多的dbscan標籤			  
-			  for(int num=0; num < row_wo_snr; ++num)
-			  {
-				  //printf("dbscan的label:%f\n", index_point[num]);
-				  for(int num1=0; num1 < maxofindex+1; ++num1)
-				  {
-					  if ((int) index_point[num] == num1)
-					  {
-						  countarray[num1]=countarray[num1]+1;
-					  }
-				  }
-			  }
-			  int max_index = 0;
-			  for(int num=0; num < maxofindex+1; ++num)
-			  {
-				  if (countarray[num]>=countarray[max_index])
-				  {
-					  max_index = num;
-				  }
-			  }
-			  //max_index就是最大的LABEL了 PYTHON可能很簡單...
-			  //printf("最大的數:%d 總共有：%d\n", max_index, countarray[max_index]);
-			  int max_index_num = countarray[max_index];
-			  float sensorA[max_index_num][7];	
-			  float x_array[max_index_num];
-			  float y_array[max_index_num];
-			  float z_array[max_index_num];
-			  int index_sensorA = 0;
-			  for(int num=0; num < row_wo_snr; ++num)
-			  {
-				  if ((int) output.vsos[num][3] == max_index) //要把最大的label放到新陣列裡面
-				  {
-				      //printf("x:%f y:%f z:%f range:%f Doppler:%f noise:%f label:%f\n", pos1X[num][0], pos1X[num][1], pos1X[num][2], pos1X[num][3], pos1X[num][4], pos1X[num][5], output.vsos[num][3]);
-				      for(int num_1=0; num_1 < 6; ++num_1)
-					  {
-						  sensorA[index_sensorA][num_1] = pos1X[num][num_1];
-					  }
-					  x_array[index_sensorA] = pos1X[num][0];
-					  y_array[index_sensorA] = pos1X[num][1];
-					  z_array[index_sensorA] = pos1X[num][2];
-					  sensorA[index_sensorA][6] = output.vsos[num][3];
-					  index_sensorA+=1;		
-				  }
-			  }
-			  //sensorA是現正在處理的陣列
-			  if (mode == 0)
-			  {
-				  printf("index_sensorA %d\n", index_sensorA);
-			  }
-			  
-			  for(int num=0; num < max_index_num; ++num)
-			  {
-				  if (mode == 0)
-				  {
-					  printf("x:%f y:%f z:%f range:%f Doppler:%f noise:%f label:%f\n", sensorA[num][0], sensorA[num][1], sensorA[num][2], sensorA[num][3], sensorA[num][4], sensorA[num][5], sensorA[num][6]);  
-				  }
-			  }
-			  
-			  //對xyz三維作排列 算四分位數
-			  qsort(x_array, max_index_num, sizeof(float), compare);
-			  qsort(y_array, max_index_num, sizeof(float), compare);
-			  qsort(z_array, max_index_num, sizeof(float), compare);
-			  
-			  float q1 = max_index_num*0.25;
-			  float q3 = max_index_num*0.75;
-			  //printf("Q3:%f\n", q3);
-			  //printf("Q1:%f\n", q1);
-			  int floor_q3, ceil_q3, floor_q1, ceil_q1;
-			  floor_q3 = floor(q3);
-			  ceil_q3 = ceil(q3);
-			  //printf("floor_q3:%d\n", floor_q3);
-			  //printf("ceil_q3:%d\n", ceil_q3);
-			  floor_q1 = floor(q1);
-			  ceil_q1 = ceil(q1);
-			  //printf("floor_q1:%d\n", floor_q1);
-			  //printf("ceil_q1:%d\n", ceil_q1);
-			  //floor_q1, floor_q3, ceil_q3, ceil_q1是index所以3個維度都一樣
-			  float q1_x, q3_x, x_irq, x_min, x_max;
-			  float q1_y, q3_y, y_irq, y_min, y_max;
-			  float q1_z, q3_z, z_irq, z_min, z_max, z_mean, z_sum;
-			  q1_x = (x_array[ceil_q1] + x_array[floor_q1])/2;
-			  q3_x = (x_array[ceil_q3] + x_array[floor_q3])/2;
-			  x_irq = q3_x - q1_x;
-			  x_max = q3_x + 0.5*x_irq;
-			  x_min = q1_x - 0.5*x_irq;
-			  q1_y = (y_array[ceil_q1] + y_array[floor_q1])/2;
-			  q3_y = (y_array[ceil_q3] + y_array[floor_q3])/2;
-			  y_irq = q3_y - q1_y;
-			  y_max = q3_y + 0.5*y_irq;
-			  y_min = q1_y - 0.5*y_irq;
-			  q1_z = (z_array[ceil_q1] + z_array[floor_q1])/2;
-			  q3_z = (z_array[ceil_q3] + z_array[floor_q3])/2;
-			  z_irq = q3_z - q1_z;
-			  z_max = q3_z + 1.5*z_irq;
-			  z_min = q1_z - 1.5*z_irq;
-			  if (mode == 0)
-			  {
-				  printf("q1_x:%f\n", q1_x);
-				  printf("q3_x:%f\n", q3_x);
-				  printf("q1_y:%f\n", q1_y);
-				  printf("q3_y:%f\n", q3_y);
-				  printf("q1_z:%f\n", q1_z);
-				  printf("q3_z:%f\n", q3_z);
-				  printf("x_max = %f\n", x_max);
-				  printf("x_min = %f\n", x_min);
-				  printf("y_max = %f\n", y_max);
-				  printf("y_min = %f\n", y_min);
-				  printf("z_max = %f\n", z_max);
-				  printf("z_min = %f\n", z_min);				  
-			  }
-
-			  
-			  //find mean of array
-			  z_sum = 0.0;
-			  for(int num=0; num < max_index_num; ++num)
-			  {
-				  z_sum+=z_array[num]; 
-			  }
-			  z_mean = 0.0;
-			  z_mean = z_sum/max_index_num;
-
-			  float x_max_array[6], y_max_array[6], z_max_array[6], x_min_array[6], y_min_array[6], z_min_array[6], z_mean_array[6];
-			  mean_count+=1;
-			  //printf("mean_count = %d\n", mean_count);
-			  float x_max_sum, x_min_sum, y_max_sum, y_min_sum, z_max_sum, z_min_sum, z_mean_sum;
-			  if (mean_count>=5)
-			  {   
-				  //把5frame的結果算mean做smooth
-				  //put number in last place
-				  x_max_array[5] = x_max;
-				  x_min_array[5] = x_min;
-				  y_max_array[5] = y_max;
-				  y_min_array[5] = y_min;
-				  z_max_array[5] = z_max;
-				  z_min_array[5] = z_min;
-				  z_mean_array[5] = z_mean;
-                  //shift
-				  for(int num=0; num < 6; ++num)
-				  {
-					  x_max_array[num] = x_max_array[num+1];
-					  x_min_array[num] = x_min_array[num+1];
-					  y_max_array[num] = y_max_array[num+1];
-					  y_min_array[num] = y_min_array[num+1];
-					  z_max_array[num] = z_max_array[num+1];
-					  z_min_array[num] = z_min_array[num+1];
-					  z_mean_array[num] = z_mean_array[num+1];
-				  }
-				  x_max_sum = 0.0;
-				  x_min_sum = 0.0;
-				  y_max_sum = 0.0;
-				  y_min_sum = 0.0;
-				  z_max_sum = 0.0;
-				  z_min_sum = 0.0;
-				  z_mean_sum = 0.0;
-				  for(int num=0; num < 5; ++num)
-				  {
-					  x_max_sum+=x_max_array[num]; 
-					  x_min_sum+=x_min_array[num]; 
-					  y_max_sum+=y_max_array[num]; 
-					  y_min_sum+=y_min_array[num]; 
-					  z_max_sum+=z_max_array[num]; 
-					  z_min_sum+=z_min_array[num]; 
-					  z_mean_sum+=z_mean_array[num]; 
-				  }
-				  x_max = x_max_sum/5; //算平均
-				  x_min = x_min_sum/5; //算平均
-				  y_max = y_max_sum/5; //算平均
-				  y_min = y_min_sum/5; //算平均
-				  z_max = z_max_sum/5; //算平均
-				  z_min = z_min_sum/5; //算平均
-				  z_mean = z_mean_sum/5; //算平均
-			  }
-			  else
-			  {
-				  x_max_array[mean_count] = x_max;
-				  x_min_array[mean_count] = x_min;
-				  y_max_array[mean_count] = y_max;
-				  y_min_array[mean_count] = y_min;
-				  z_max_array[mean_count] = z_max;
-				  z_min_array[mean_count] = z_min;
-				  z_mean_array[mean_count] = z_mean;
-			  }
-
-			  float l1_dis;
-			  l1_dis = sqrt(pow(x_min + ((x_max - x_min)/2), 2) + pow((y_min + (y_max - y_min)/2), 2));
-			  float error_from_radar = 0.06;
-			  z_mean = z_mean - error_from_radar;
-			  float z_fall_lying[11];
-			  if (fall_lying_count>10)
-			  {
-				  z_fall_lying[10] = z_mean; //z_fall_lying都放z_mean
-				  for(int num=0; num < 10; ++num)
-				  {
-					  z_fall_lying[num] = z_fall_lying[num+1]; //往前移位
-				  }
-			  }
-			  else
-			  {
-				  fall_lying_count += 1;
-				  z_fall_lying[fall_lying_count] = z_mean; //z_fall_lying都放z_mean
-			  }
-			  int state_fall_lying = 0;
-			  float tmp_threshold = 0.0;
-			  float sum_z_fall_lying = 0.0;
-			  float dif_z_thr = 0.0;
-			  if (z_mean>0.7) //如果太高 可調整
-			  {
-				  state_fall_lying = 0;
-			  }
-			  else
-			  {
-				  if (fall_lying_count>9) //判斷fall_lying_count有10個數值
-				  {
-
-					  for(int num=0; num < 5; ++num)
-					  {
-						  sum_z_fall_lying += z_fall_lying[num];
-					  }
-					  tmp_threshold = sum_z_fall_lying/5.0;
-					  dif_z_thr = fabs(tmp_threshold-z_mean);  //現在的z_mean>前5frame的z_mean
-					  if (dif_z_thr > 0.3) //可調整ori:0.67 //因為c語言這邊的刷新率較高所以往下跌的幅度要小一點
-					  {
-						  state_fall_lying = 1; //倒
-					  }
-				  }
-			  }
-			  //printf("dif_z_thr = %f\n", dif_z_thr);
-			  /*
-			  error_from_radar = randomForestModel.predict(np.array(l1_dis).reshape(-1, 1))
-			  z_mean = z_mean - error_from_radar[0]
-			  z_fall_lying.append(z_mean)
-			  if len(z_fall_lying) > 10:
-				  z_fall_lying.pop(0)
-			  if z_mean > 0.8:  # z_men > 0.8 (reset to 0)
-				  state_fall_lying = 0
-			  else:
-				  if len(z_fall_lying) > 9:
-					  tmp_threshold = np.mean(z_fall_lying[:5])
-					  dif_z_thr = np.abs(tmp_threshold - z_mean)
-					  if dif_z_thr > 0.2:  # add: 放寬閾值
-						  state_fall_lying = 1
-			  */
-			  float lenofx, lenofy, lenofz; //算長度
-			  lenofz = z_max - z_min; //算長度
-			  lenofx = x_max - x_min; //算長度
-			  lenofy = y_max - y_min; //算長度
-			  
-			  float stardand = 1.0;
-			  int  state_people = 1;
-			  if (mode == 1)
-			  {
-				printf("\e[1;1H");
-				system("clear");							
-			  }
-			  if (lenofz/lenofx >= 1.0 || lenofz/lenofy >= 1.0 || lenofx == 0.0 || lenofy == 0.0)
-			  {
-				  if (z_mean > (stardand / 10) * 7.3) //高於高度 可調整
-				  {
-					  state_people = 1; //站
-				  }
-				  else if (lenofz/lenofx < 0.85 || lenofz/lenofy < 0.95) //低於高度又是長方形
-				  {
-						if (state_fall_lying == 0) //臥跌判斷
-						{
-							state_people = 2; //臥
-						}
-						else
-						{
-							//printf("!!!!!!!!!!!!!!!!!!!!_fail_!!!!!!!!!!!!!!!!!!!!!!");
-							state_people = 3; //跌
-						}
-				  }
-				  else //什麼都不是就判斷坐
-				  {
-					  state_people = 0; // 坐
-				  }
-			  }
-			  else
-			  {
-				  if (state_fall_lying == 0)  //臥跌判斷
-				  {
-					  state_people = 2; //臥
-				  }
-				  else
-				  {
-					  //printf("!!!!!!!!!!!!!!!!!!!!_fail_!!!!!!!!!!!!!!!!!!!!!!");
-					  state_people = 3; //跌
-				  }
-			  }
-			  time(&rawtime);
-			  info = localtime(&rawtime);
-			  printf("       Version: V1.0            \n");
-			  printf("0 = 坐 | 1 = 站 | 2 = 臥 | 3 = 跌\n");
-			  printf("姿態 = %d %s", state_people, asctime(info));
-			  //printf("\033[1;1H"); clear all consle
-			  // Write data to csv
-			  FILE *fp = fopen(filename, "a");
-			  if (fp == NULL)
-			  {
-				  printf("error");
-				  return -1;
-			  }
-			  fprintf(fp, "%d, %s", state_people, asctime(info));
-			  fclose(fp);
-		  }
-		  
-		  memset(read_buf, 0, 102400);
-		}
+	  }
+	  if (reader.eof) //重播結束
+	  {
+		  break;
+	  }
   }
-  
-
-
+  dashboard_close(&dash); //統計印在畫面下面
+  frame_reader_report(&reader);
+  stage_timer_report();
+  fall_alert_report();
+  fall_alert_close();
+  printf("label: tracker %lu frames, dbscan %lu frames\n", ctx.tracker_frames, ctx.dbscan_frames);
+  people_ctx_free(&ctx);
+  frame_reader_free(&reader);
+  capture_close(&capture);
+  if (serial_port >= 0)
+      close(serial_port);
+  return 0;
 }
-
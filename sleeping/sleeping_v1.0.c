@@ -18,6 +18,14 @@
 #include "pocketfft.h"
 #include "polyfit.h"
 #include "brhr_function.h"
+#include "../common/frame_reader.h"
+#include "../common/serial_port.h"
+#include "../common/vs_ingest.h"
+#include "../common/radar_decode.h"
+#include "../common/stage_timer.h"
+#include "../common/result_log.h"
+#include "../common/dashboard.h"
+#include "../common/stop_signal.h"
 
 // Sklearn model
 #include "svm_br_office_all.h"
@@ -28,8 +36,6 @@
 #define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
 #define MAX(X, Y) (((X) < (Y)) ? (Y) : (X))
 
-struct timeval start, stop;
-
 // Data containers
 double unwrapPhasePeak_mm[800];
 double heartRateEst_FFT_mean[800];
@@ -280,38 +286,6 @@ static void lfilter(double *b, double *a, double *x, double *y, double *Z, int l
 	}
 }
 
-typedef union
-{
-	float f;
-	struct
-	{
-		unsigned int mantissa : 23;
-		unsigned int exponent : 8;
-		unsigned int sign : 1;
-	} raw;
-} myfloat;
-
-unsigned int convertToInt(int *arr, int low, int high)
-{
-	unsigned f = 0, i;
-	for (i = high; i >= low; i--)
-	{
-		f = f + arr[i] * pow(2, high - i);
-	}
-	return f;
-}
-
-unsigned int ieee754_convert(int *ieee)
-{
-	myfloat var;
-	unsigned f = convertToInt(ieee, 9, 31);
-	var.raw.mantissa = f;
-	f = convertToInt(ieee, 1, 8);
-	var.raw.exponent = f;
-	var.raw.sign = ieee[0];
-	return var.f;
-}
-
 void array_shift()
 {
 	for (int num = 0; num < 799; num++)
@@ -566,7 +540,7 @@ void mean_fn_int (int *sig, int sig_len, double *output_i)
     *output_i = *output_i / sig_len;
 }
 
-int main(void)
+int main(int argc, char *argv[])
 {
 	// Create a file of recorded data and enter the first row as the name of each feature.
     char filename[100] = {0};
@@ -579,15 +553,20 @@ int main(void)
     strcat(filename, root_dir);  // Concatenate two strings.
     strcat(filename, input_name);  // Concatenate two strings.
     strcat(filename, ".csv");  // Concatenate two strings.
-    FILE *fp = fopen(filename, "w");  // Open the file and set it to write mode.
-    if (fp == NULL)
+    // Keep the file open, a background thread writes the lines in batches.
+    result_log_t csv_log;
+    result_log_config(argc, argv);
+    // --headless: no display, --display-hz N: display refresh rate.
+    static dashboard_t dash;
+    dashboard_region_t view;
+    dashboard_init(&dash, argc, argv, 0);
+    dashboard_region_init(&view, &dash, 0, DASHBOARD_ROWS);
+    if (result_log_open(&csv_log, filename, "w") != 0)
     {
-        printf("error");
         return -1;
     }
 	// Write the name of each output value to the first row of the file.
-	fprintf(fp, "heart, breath, bmi, deep_p, ada_br, ada_hr, var_RPM, var_HPM, rem_parameter, mov_dens, LF, HF, LFHF, sHF, sLFHF, tfRSA, tmHR, sfRSA, smHR, sdfRSA, sdmHR, stfRSA, stmHR, time, datetime, sleep\n");
-	fclose(fp);
+	result_log_printf(&csv_log, "heart, breath, bmi, deep_p, ada_br, ada_hr, var_RPM, var_HPM, rem_parameter, mov_dens, LF, HF, LFHF, sHF, sLFHF, tfRSA, tmHR, sfRSA, smHR, sdfRSA, sdmHR, stfRSA, stmHR, time, datetime, sleep\n");
 
 	// Initialize (Feature_detection)
 	int len_s_half;  // Signal length and half length.
@@ -600,64 +579,35 @@ int main(void)
 	int ltera_add, location, ltera, time_thr;  // Record the number of rounds and the declaration threshold.
 	int sum_v, sum_p;  // Record how many peaks and valleys remain after compress is completed.
 
-    int serial_port = open("/dev/ttyTHS1", O_RDWR);
-	struct termios tty;
-
-    if (tcgetattr(serial_port, &tty) != 0)
-	{
-		printf("Error %i from tcgetattr: %s\n", errno, strerror(errno));
+	// --record <file> saves the raw UART bytes, --replay <file> [--speed N|max] runs without the radar
+	capture_t capture;
+	if (capture_parse_args(&capture, argc, argv) != 0)
 		return 1;
+	stage_timer_init(argc, argv);
+	int serial_port = -1;
+	if (capture.mode != CAPTURE_REPLAY)
+	{
+		serial_port = serial_open(serial_device_arg(argc, argv));
+		if (serial_port < 0)
+			return 1;
 	}
-	tty.c_cflag &= ~PARENB;
-	tty.c_cflag &= ~CSTOPB;
-	tty.c_cflag &= ~CSIZE;
-	tty.c_cflag |= CS8;
-	tty.c_cflag &= ~CRTSCTS;
-	tty.c_cflag |= CREAD | CLOCAL;
-	tty.c_lflag &= ~ICANON;
-	tty.c_lflag &= ~ECHO;
-	tty.c_lflag &= ~ECHOE;
-	tty.c_lflag &= ~ECHONL;
-	tty.c_lflag &= ~ISIG;
-	tty.c_iflag &= ~(IXON | IXOFF | IXANY);
-	tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL);
-	tty.c_oflag &= ~OPOST;
-	tty.c_oflag &= ~ONLCR;
-	tty.c_cc[VTIME] = 10;
-	tty.c_cc[VMIN] = 0;
-
-	cfsetispeed(&tty, B921600);
-	cfsetospeed(&tty, B921600);
-
-	if (tcsetattr(serial_port, TCSANOW, &tty) != 0)
+
+    frame_reader_t reader;  // Reassembles complete frames from the UART stream.
+	if (frame_reader_init(&reader, serial_port) != 0)
 	{
-		printf("Error %i from tcsetattr: %s\n", errno, strerror(errno));
+		printf("Error from frame_reader_init\n");
 		return 1;
 	}
-
-    char read_buf[1024];
-	int size;
+	frame_reader_set_capture(&reader, &capture);
+	vs_ingest_t ingest;  // Thread that reads and decodes the port.
+	vs_frame_t frame;  // Frame taken from the ingest thread.
 	int data_idx = 0;
-	unsigned long int header_reader_output[10];
-	unsigned long int byte[4];
-	unsigned long int tlv_header_reader_output[2];
-	unsigned int vsos_byte[128];
-	unsigned int tlv_header[4];
-	short int rangeProfile[2];
-	float vsos_array[34];  // Main output 1
-	short int rangeProfile_array[126];  // Main output 2
-	short int int16_number;
-	int i = 0;
-	int j = 0;
-	int k = 0;
-	int int16_temp_number = 0;
-	unsigned int ieee[32];
-	unsigned int int16_temp[16];
-	int magicWord[8] = {2, 1, 4, 3, 6, 5, 8, 7};
+	float vsos_array[VS_ARRAY_LEN];  // Main output 1
+	short int rangeProfile_array[VS_RANGE_PROFILE_LEN];  // Main output 2
 
     // Declare the variable after the completion of reading.
 	time_t start_time;
-	start_time = time(NULL);
+	start_time = capture_wall_time(&capture);  // The recorded time when replaying.
 	int array_index = 0;
 	int array_index_bmi = 0;
 	float phase_diff[799];
@@ -834,127 +784,25 @@ int main(void)
     start_month = local->tm_mon + 1;    // Get the month of the year (0-11)
     start_year = local->tm_year + 1900;    // The year was taken from 1900 onwards.
 	
-    // Execute the algorithm uninterrupted until Ctrl + C is pressed.
+    // Another thread drains the port continuously and queues the decoded frames.
+	if (vs_ingest_start(&ingest, &reader) != 0)
+		return 1;
+	ingest.stop_flag = &stop_requested;  // Ctrl+C or kill ends the loop below, the csv is still closed and the reports printed.
+	stop_signal_init();
+
+    // Execute the algorithm until the replay ends or Ctrl + C is pressed.
 	while (1)
 	{
-        // Reads data from the radar.
-		while ((size = read(serial_port, &read_buf, sizeof(read_buf) - 1)) > 0)
-		{
-			// printf("----------start-----------\n");
-			gettimeofday(&start, NULL);
-			int state = 0;
-			if (state == 0)
-			{
-				int same = 0;
-				for (int ix = 0; ix < 8; ++ix)
-				{
-					// printf("%d\n", read_buf[ix]);
-					if (read_buf[ix] == magicWord[ix])
-					{
-						same++;
-						if (same == 8)
-						{
-							state = 1;
-						}
-					}
-				}
-			}
-			if (state == 1)
-			{
-				for (int ix = 0; ix < 40; ++ix)
-				{
-					byte[i] = read_buf[ix + 8];
-					i++;
-					if (i == 4)
-					{
-						header_reader_output[((ix + 1) / 4) - 1] = ((byte[0] << 0) + (byte[1] << 8) + (byte[2] << 16) + (byte[3] << 24));
-						i = 0;
-					}
-				}
-				for (int ix = 48; ix < 176; ++ix)
-				{
-					vsos_byte[j] = read_buf[ix];
-					j++;
-					if (j == 4)
-					{
-						for (int ix2 = 0; ix2 < 2; ix2++)
-						{
-							vsos_array[ix2] = (float)((vsos_byte[ix2 * 2] << 0) + (vsos_byte[(ix2 * 2) + 1] << 8));
-						}
-					}
-					if (j == 8)
-					{
-						for (int ix1 = 7; ix1 > 3; --ix1)
-						{
-							for (int ix = 0; ix < 8; ++ix)
-							{
-								ieee[k] = (vsos_byte[ix1] << ix & 0x80) >> 7;
-								k++;
-							}
-						}
-						k = 0;
-						float ieee775544 = ieee754_convert(ieee);
-						vsos_array[2] = ieee775544;
-					}
-					if (j == 18)
-					{
-						for (int ix2 = 4; ix2 < 8; ix2++)
-						{
-							vsos_array[ix2 - 1] = (float)((vsos_byte[ix2 * 2] << 0) + (vsos_byte[(ix2 * 2) + 1] << 8));
-						}
-					}
-					if (j == 128)
-					{
-						for (int ix2 = 0; ix2 < 27; ix2++)
-						{
-							for (int ix1 = 19 + (ix2 * 4); ix1 > 15 + (ix2 * 4); --ix1)
-							{
-								for (int ix = 0; ix < 8; ++ix)
-								{
-									ieee[k] = (vsos_byte[ix1] << ix & 0x80) >> 7;
-									k++;
-								}
-							}
-							k = 0;
-							myfloat var;
-							unsigned f = convertToInt(ieee, 9, 31);
-							var.raw.mantissa = f;
-							f = convertToInt(ieee, 1, 8);
-							var.raw.exponent = f;
-							var.raw.sign = ieee[0];
-							vsos_array[ix2 + 7] = var.f; // 7-33
-						}
-					}
-				}
-				j = 0;
-				for (int ix = 176; ix < 184; ++ix)
-				{
-					tlv_header[i] = read_buf[ix];
-					i++;
-					if (i == 4)
-					{
-						i = 0;
-					}
-				}
-
-				for (int ix = 184; ix < 436; ++ix)
-				{
-					rangeProfile[i] = read_buf[ix];
-					i++;
-					if (i == 2)
-					{
-						int16_number = (rangeProfile[0] << 0) + (rangeProfile[1] << 8);
-						rangeProfile_array[(ix - 185) / 2] = int16_number;
-						i = 0;
-					}
-				}
-			}
+        // Takes the next decoded frame from the ingest thread, so the processing below never keeps the UART waiting.
+		if (!vs_ingest_pop(&ingest, &frame))  // End of the replay, or Ctrl+C.
 			break;
-		}
+		stage_timer_poll();  // Prints the time spent per stage on SIGUSR1 or every --timing-every N seconds.
+		memcpy(vsos_array, frame.vsos_array, sizeof(vsos_array));  // vsos_array[7-33] are the 27 floats.
+		memcpy(rangeProfile_array, frame.range_profile, sizeof(rangeProfile_array));
 
 		// Reads data without interruption.
 		time_t end_time;  // Declare time variables.
-		end_time = time(NULL);  // Set the time variable to the current time.
+		end_time = frame.wall_time;  // The receive time, or the recorded time when replaying so --speed max also speeds up the 1 s schedule.
 
 		// When the number of data read is less than 800, the following equation is executed to read the data into the corresponding array step by step.
 		if (array_index < 800) {
@@ -993,14 +841,13 @@ int main(void)
             LF_HF_LFHF_windows[5999] = (double)vsos_array[7];
         }
 
-		if (array_index < 800 && array_index%20 == 0) {
-			printf("\e[1;1H");
-			int systemArb = system("clear");
-			printf("=========================================================\n");
-			printf("|      Version: V1.0                                    |\n");
-			printf("=========================================================\n");
-			printf("|      Cumulative number of data to 800: %*d            |\n", 3, array_index);
-			printf("=========================================================\n");
+		if (array_index < 800 && array_index%20 == 0 && dashboard_begin(&view)) {
+			dashboard_printf(&view, "=========================================================\n");
+			dashboard_printf(&view, "|      Version: V1.0                                    |\n");
+			dashboard_printf(&view, "=========================================================\n");
+			dashboard_printf(&view, "|      Cumulative number of data to 800: %*d            |\n", 3, array_index);
+			dashboard_printf(&view, "=========================================================\n");
+			dashboard_end(&view);
 		}
         // When the number of read data reaches 800 or more, the sleep stage of the algorithm starts.
 		if (array_index >= 800) {
@@ -1121,7 +968,9 @@ int main(void)
 						double a[11] = {1.0,-9.780812442849507348796578298789,43.083177194495931416895473375916,-112.548980608688253823856939561665,193.103088780432216253757360391319,-227.365418151163510174228576943278,186.055050775931675843821722082794,-104.483153273330174215516308322549,38.535884265082792410339607158676,-8.429195049755342949993064394221,0.830358509857336501980284992896};
 						double delay[10] = {0}; // length of (a or b) - 1
 						size_t len_ab = sizeof(a) / sizeof(double);
+						uint64_t t_lfilter = stage_begin();
 						lfilter(b, a, removed_noise, y, delay, len_ab, 799, 1, 1);
+						stage_end(STAGE_LFILTER, t_lfilter);
 					}
 
 					//  if (order == 9) => HR
@@ -1130,13 +979,17 @@ int main(void)
 						double a[19] = {1.0, -15.142612391789038, 109.52867216475022, -502.6626423702458, 1639.7914526180646, -4037.095860679349, 7772.407643496967, -11963.349399532222, 14922.878739349395, -15197.385490007382, 12665.576290591296, -8617.837327643654, 4751.9970631301, -2094.9246186588152, 722.2258948681153, -187.91289244221497, 34.75519411187606, -4.078772963228582, 0.22866640874033417};
 						double delay[18] = {0};  // length of (a or b) - 1
 						size_t len_ab = sizeof(a) / sizeof(double);
+						uint64_t t_lfilter = stage_begin();
 						lfilter(b, a, removed_noise, y, delay, len_ab, 799, 1, 1);
+						stage_end(STAGE_LFILTER, t_lfilter);
 					}
 					
 					// --------------------- FFT --------------------- 
 					int N = 799;  // FFT length & The number of samples
 					double P[800];  // Output signal(complex-value). The layout of elemens are: `nrows * ((fft_len / 2) + 1) * 2(real, img)
+					uint64_t t_fft = stage_begin();
 					rfft_forward_1d_array(y, N, N, 1, 1, P);  // Output: y
+					stage_end(STAGE_FFT, t_fft);
 
 					// Find max value index in FFT
 					int max_index = 0;
@@ -1161,7 +1014,9 @@ int main(void)
 					else
 						smoothing_pars = 2;  // The Smoothing signal parameters for cardiac.
 					int len_input = sizeof(y) / sizeof(double);  // Calculate the length of the signal after filtering.
+					uint64_t t_stage = stage_begin();
 					double *data_s = MLR(y, smoothing_pars, len_input);  // Output: data_s
+					stage_end(STAGE_MLR, t_stage);
 					
 					// --------------------- Feature_detection ---------------------
 					// Signal length and half length, round down to the nearest whole number.
@@ -1182,6 +1037,7 @@ int main(void)
 					feature_valley = _local_maxima_1d(neg_x, len_input, midpoints_valley, &m_v);  // Output: feature_valley
 					
 					// --------------------- Feature compress --------------------- 
+					t_stage = stage_begin();
 					// Given value
 					// m_p and m_v are calculations of how many peak features and valley features were found after Feature_detection.
 					// Store all features (peaks & valleys) into another array total_feature.
@@ -1306,7 +1162,9 @@ int main(void)
 					// Perform quicksort on data
 					quickSort(compress_feature, 0, sum_p + sum_v - 1);
 					
+					stage_end(STAGE_FEATURE_COMPRESS, t_stage);
 					// --------------------- Candidate search --------------------- 
+					t_stage = stage_begin();
 					// Initialize (feature_compress)
 					double tmp_sum, window_sum, tmp_var, window_var;
 					int NT_index, NB_index;
@@ -1357,6 +1215,7 @@ int main(void)
 							NB_index += 1;
 						}
 					}
+					stage_end(STAGE_CANDIDATE_SEARCH, t_stage);
 					// --------------------- Caculate respiratory rate & cardiac rate --------------------- 
 					// Declare the parameters related to respiratory rate and cardiac rate.
 					double rate, cur_rate, tmp_rate;
@@ -1402,7 +1261,9 @@ int main(void)
 					if (br0hr1 == 0){
 						svm_input[1] = br_mean_FFT;
 						svm_input[2] = br_mean_xCorr;
+						t_stage = stage_begin();
 						svm_result = predict_br(svm_input);
+						stage_end(STAGE_PREDICT, t_stage);
 						if (svm_result == 0)
 							final_br = rate;
 						else
@@ -1411,7 +1272,9 @@ int main(void)
 					else{
 						svm_input[1] = br_mean_FFT;
 						svm_input[2] = br_mean_xCorr;
+						t_stage = stage_begin();
 						svm_result = predict_hr(svm_input);
+						stage_end(STAGE_PREDICT, t_stage);
 						if (svm_result == 0)
 							final_hr = rate;
 						else
@@ -1430,21 +1293,21 @@ int main(void)
 				tmp_hr = hr_rpm;
 
 				// printf("BR = %f\nHR = %f\n", br_rpm, hr_rpm);
-				printf("\e[1;1H");
-				int systemArb = system("clear");
+				// Redraw only the rows that changed, at most --display-hz times a second.
+				dashboard_begin(&view);
 				// The calculation does not begin until the time enters the second hand at 00.
 				if (seconds == 0 && counter == 0) {
 					counter += 1;
 					begin = 1;
 				}
 				else if (seconds != 0 && counter == 0) {
-					printf("=========================================================\n");
-					printf("|      Version: V1.0                                    |\n");
-					printf("=========================================================\n");
-					printf("|      Cumulative number of data to 800:      OK        |\n");
-					printf("=========================================================\n");
-					printf("|      Remaining preparation times: %*d sec             |\n", 3, 610 - (var_index + looper) + 60 - seconds);
-					printf("=========================================================\n");
+					dashboard_printf(&view, "=========================================================\n");
+					dashboard_printf(&view, "|      Version: V1.0                                    |\n");
+					dashboard_printf(&view, "=========================================================\n");
+					dashboard_printf(&view, "|      Cumulative number of data to 800:      OK        |\n");
+					dashboard_printf(&view, "=========================================================\n");
+					dashboard_printf(&view, "|      Remaining preparation times: %*d sec             |\n", 3, 610 - (var_index + looper) + 60 - seconds);
+					dashboard_printf(&view, "=========================================================\n");
 					
 				}
 				// Start generating subsequent sleep features.
@@ -1671,10 +1534,14 @@ int main(void)
 							double a[5] = { 1.0, -3.996631500101437, 5.9910822943901785, -3.9922680954261405, 0.9978176514624266 };
 							double delay[4] = {0}; // length of (a or b) - 1
 							size_t len_ab = sizeof(a) / sizeof(double);
+							uint64_t t_lfilter = stage_begin();
 							lfilter(b, a, LF_HF_LFHF_windows, input_energe, delay, len_ab, array_index, 1, 1);
+							stage_end(STAGE_LFILTER, t_lfilter);
 							
 							// energe
+							uint64_t t_fft = stage_begin();
 							rfft_forward_1d_array(input_energe, array_index, array_index, 1, 1, out_fft);
+							stage_end(STAGE_FFT, t_fft);
 							for (int i = 0; i < array_index-1; i+=2){
 								emerge_sum_LF += pow(out_fft[i], 2) + pow(out_fft[i+1], 2);
 							}
@@ -1684,10 +1551,14 @@ int main(void)
 							double a[5] = { 1.0, -3.9832035773796473, 5.961516438161199, -3.973322837534953, 0.995044958484506 };
 							double delay[4] = {0}; // length of (a or b) - 1
 							size_t len_ab = sizeof(a) / sizeof(double);
+							uint64_t t_lfilter = stage_begin();
 							lfilter(b, a, LF_HF_LFHF_windows, input_energe, delay, len_ab, array_index, 1, 1);
+							stage_end(STAGE_LFILTER, t_lfilter);
 
 							// energe
+							uint64_t t_fft = stage_begin();
 							rfft_forward_1d_array(input_energe, array_index, array_index, 1, 1, out_fft);
+							stage_end(STAGE_FFT, t_fft);
 							for (int i = 0; i < array_index-1; i+=2){
 								emerge_sum_HF += pow(out_fft[i], 2) + pow(out_fft[i+1], 2);
 							}
@@ -1908,20 +1779,20 @@ int main(void)
 						start_min = end_min;
 						next_HM = 1;
 					}
-					printf("=========================================================\n");
-					printf("|      Version: V1.0                                    |\n");
-					printf("=========================================================\n");
+					dashboard_printf(&view, "=========================================================\n");
+					dashboard_printf(&view, "|      Version: V1.0                                    |\n");
+					dashboard_printf(&view, "=========================================================\n");
 					if (610 - (var_index + looper) >= 0) {
-						printf("|      Cumulative number of data to 800:      OK        |\n");
-						printf("=========================================================\n");
-						printf("|      Remaining preparation times: %*d sec             |\n", 3, 610 - (var_index + looper));
+						dashboard_printf(&view, "|      Cumulative number of data to 800:      OK        |\n");
+						dashboard_printf(&view, "=========================================================\n");
+						dashboard_printf(&view, "|      Remaining preparation times: %*d sec             |\n", 3, 610 - (var_index + looper));
 					}
 					else {
-						printf("|      Cumulative number of data to 800:      OK        |\n");
-						printf("=========================================================\n");
-						printf("|      Preparation sleep features:            OK        |\n");
+						dashboard_printf(&view, "|      Cumulative number of data to 800:      OK        |\n");
+						dashboard_printf(&view, "=========================================================\n");
+						dashboard_printf(&view, "|      Preparation sleep features:            OK        |\n");
 					}
-					printf("=========================================================\n");
+					dashboard_printf(&view, "=========================================================\n");
 					if (next_HM == 1 && looper >= 10) {
 						// Average all features. mean_fn_double(input, output)
 						mean_fn_double (breath_ar, br_hr_index, &all_results[0]);
@@ -1956,17 +1827,14 @@ int main(void)
 						}
 
 						// Random forest classifier prediction
+						uint64_t t_stage = stage_begin();
 						predict_result = predict(all_results);
+						stage_end(STAGE_PREDICT, t_stage);
 
 						// Write data to csv
-						FILE *fp = fopen(filename, "a");
-						if (fp == NULL)
-						{
-							printf("error");
-							return -1;
-						}
-						fprintf(fp, "%f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %d:%d:%d, %d\n", all_results[1], all_results[0], all_results[2], all_results[3], all_results[4], all_results[5], all_results[6], all_results[7], all_results[8], all_results[9], all_results[10], all_results[11], all_results[12], all_results[13], all_results[14], all_results[15], all_results[16], all_results[17], all_results[18], all_results[19], all_results[20], all_results[21], all_results[22], all_results[23], hours_tf, minutes_tf, seconds_tf, predict_result);
-						fclose(fp);
+						t_stage = stage_begin();
+						result_log_printf(&csv_log, "%f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %d:%d:%d, %d\n", all_results[1], all_results[0], all_results[2], all_results[3], all_results[4], all_results[5], all_results[6], all_results[7], all_results[8], all_results[9], all_results[10], all_results[11], all_results[12], all_results[13], all_results[14], all_results[15], all_results[16], all_results[17], all_results[18], all_results[19], all_results[20], all_results[21], all_results[22], all_results[23], hours_tf, minutes_tf, seconds_tf, predict_result);
+						stage_end(STAGE_FILE_IO, t_stage);
 
 						// Parameter initialization
 						br_hr_index = 0;
@@ -1990,20 +1858,31 @@ int main(void)
 					}
 					if (610 - (var_index + looper) < 0) {
 						if (predict_result == 0)
-							printf("|      Current time: %*d:%*d:%*d  |  Sleeping stage: DEEP  |\n", 2, hours_tf, 2, minutes_tf, 2, seconds_tf);
+							dashboard_printf(&view, "|      Current time: %*d:%*d:%*d  |  Sleeping stage: DEEP  |\n", 2, hours_tf, 2, minutes_tf, 2, seconds_tf);
 						else if (predict_result == 1)
-							printf("|      Current time: %*d:%*d:%*d  |  Sleeping stage: LIGHT |\n", 2, hours_tf, 2, minutes_tf, 2, seconds_tf);
+							dashboard_printf(&view, "|      Current time: %*d:%*d:%*d  |  Sleeping stage: LIGHT |\n", 2, hours_tf, 2, minutes_tf, 2, seconds_tf);
 						else if (predict_result == 2)
-							printf("|      Current time: %*d:%*d:%*d  |  Sleeping stage: REM   |\n", 2, hours_tf, 2, minutes_tf, 2, seconds_tf);
+							dashboard_printf(&view, "|      Current time: %*d:%*d:%*d  |  Sleeping stage: REM   |\n", 2, hours_tf, 2, minutes_tf, 2, seconds_tf);
 						else if (predict_result == 3)
-							printf("|      Current time: %*d:%*d:%*d  |  Sleeping stage: AWAKE |\n", 2, hours_tf, 2, minutes_tf, 2, seconds_tf);
-						printf("=========================================================\n");
+							dashboard_printf(&view, "|      Current time: %*d:%*d:%*d  |  Sleeping stage: AWAKE |\n", 2, hours_tf, 2, minutes_tf, 2, seconds_tf);
+						dashboard_printf(&view, "=========================================================\n");
 					}
 				}
+				dashboard_end(&view);
 				start_time = end_time;
             }
         }
     }
-    close(serial_port);
+    vs_ingest_stop(&ingest);
+    dashboard_close(&dash);
+    vs_ingest_report(&ingest);
+    stage_timer_report();
+    result_log_close(&csv_log);
+    result_log_report(&csv_log);
+    frame_reader_report(&reader);
+    frame_reader_free(&reader);
+    capture_close(&capture);
+    if (serial_port >= 0)
+        close(serial_port);
     return 0;
 }
@@ -0,0 +1,402 @@
+// DBSCAN latency per call: dbscan(), dbscan_euclidean(), dbscan_labels() and the dbscan_output() wrapper,
+// on synthetic clouds (1..10 clusters, 10..5000 points, 2D and 3D) and on the clouds of a recorded capture
+// gcc -O2 bench_cluster.c ../common/*.c -o bench_cluster -lm -lpthread                  (animal, 2D grid)
+// gcc -O2 -DBENCH_PEOPLE bench_cluster.c ../common/*.c -o bench_cluster -lm -lpthread   (people, 3D grid)
+// ./bench_cluster [--iterations N] [--replay session.cap] [--frames N]
+// One line per case and cloud in a fixed order: save the output before and after a change and diff them.
+// With --replay the old labels (1 m range bins, what dbscan_output() gave the mains) are also compared with
+// dbscan_labels() on every recorded cloud, and dbscan_labels() is checked against dbscan() point for point.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef BENCH_PEOPLE
+#include "../people/dbscan.c"
+#define BENCH_DIMS 3      // dims of the grid and kernel compiled in
+#else
+#include "../animal/dbscan_animals.c"
+#define BENCH_DIMS 2
+#endif
+#include "../common/capture.h"
+#include "../common/frame_reader.h"
+#include "../common/pc_tlv.h"
+
+#define BENCH_MAX_CLOUDS 4096
+#define BENCH_OUTPUT_POINTS DBSCAN_OUTPUT_MAX_POINTS  // dbscan_output() returns only this many rows
+
+/* ---------------- Allocation count ---------------- */
+
+// Every malloc of the process goes through here (glibc), a call's count is the difference around it.
+extern void *__libc_malloc(size_t n);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t n);
+static unsigned long allocations;
+
+void *malloc(size_t n)
+{
+	__atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+	return __libc_malloc(n);
+}
+
+void *calloc(size_t n, size_t size)
+{
+	__atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+	return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t n)
+{
+	__atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+	return __libc_realloc(p, n);
+}
+
+/* ---------------- Clouds ---------------- */
+
+// rows as the mains cluster them: x, y, z, range, doppler, snr
+typedef struct {
+	int dims;
+	int clusters;             // 0 for a recorded cloud
+	unsigned int n;
+	float (*pos)[6];
+} cloud_t;
+
+static cloud_t clouds[BENCH_MAX_CLOUDS];
+static int num_clouds;
+
+static cloud_t *new_cloud(int dims, int clusters, unsigned int n)
+{
+	if (num_clouds == BENCH_MAX_CLOUDS)
+		return NULL;
+	cloud_t *c = &clouds[num_clouds++];
+	c->dims = dims;
+	c->clusters = clusters;
+	c->n = n;
+	c->pos = malloc((n > 0 ? n : 1) * sizeof(*c->pos));
+	return c;
+}
+
+/* Animal or person sized blobs 1.8 m apart in an 8 x 8 m room, one point in ten is clutter. */
+static void make_scene(cloud_t *c)
+{
+	for (unsigned int i = 0; i < c->n; i++) {
+		double u = rand() / (double) RAND_MAX, v = rand() / (double) RAND_MAX, w = rand() / (double) RAND_MAX;
+		float *p = c->pos[i];
+		if (i % 10 == 9) {
+			p[0] = u * 8 - 4;
+			p[1] = v * 8;
+			p[2] = w * 3;
+		} else {
+			unsigned int k = i % c->clusters;
+			p[0] = (k % 4) * 1.8 - 2.7 + (u - 0.5) * 0.5;
+			p[1] = (k / 4) * 1.8 + 1.0 + (v - 0.5) * 0.5;
+			p[2] = w * 1.7;
+		}
+		if (c->dims == 2)
+			p[2] = 0;
+		p[3] = sqrtf(p[0] * p[0] + p[1] * p[1]);
+		p[4] = (v - 0.5) * 2;
+		p[5] = 10 + 20 * u;
+	}
+}
+
+/*
+Clouds of a capture as the mains build them: the points of the last frames frames
+with snr above 0 and x, y within 15 m, z from the elevation only for a 3D grid.
+return = number of clouds, -1 if the capture cannot be read
+*/
+static int load_capture(const char *path, int frames)
+{
+	capture_t capture;
+	frame_reader_t reader;
+	const uint8_t *frame;
+	int size, loaded = 0;
+	unsigned int last[frames];
+	float (*window)[6] = NULL;
+	unsigned int window_n = 0;
+
+	memset(&capture, 0, sizeof(capture));
+	if (capture_open_replay(&capture, path, 0) != 0)
+		return -1;
+	if (frame_reader_init(&reader, -1) != 0) {
+		capture_close(&capture);
+		return -1;
+	}
+	frame_reader_set_capture(&reader, &capture);
+	memset(last, 0, sizeof(last));
+	while (!reader.eof) {
+		pc_frame_t pc;
+		if ((size = frame_reader_read(&reader, &frame)) < 0)
+			break;
+		if (size == 0 || pc_parse_frame(frame, size, &pc) != 0)
+			continue;
+		float raw[pc.num_points > 0 ? pc.num_points : 1][5];
+		decode_pc_points(pc.points, pc.num_points, &pc.unit, raw);
+		// drop the oldest frame, then append this one
+		unsigned int keep = window_n - last[0];
+		float (*grown)[6] = realloc(window, (window_n + pc.num_points + 1) * sizeof(*window));
+		if (grown == NULL)
+			break;
+		window = grown;
+		memmove(window, window + last[0], keep * sizeof(*window));
+		memmove(last, last + 1, (frames - 1) * sizeof(*last));
+		unsigned int added = 0;
+		for (int i = 0; i < pc.num_points; i++) {
+			float e = raw[i][0], a = raw[i][1], r = raw[i][3];
+			float *p = window[keep + added];
+			p[0] = r * cosf(e) * sinf(a);
+			p[1] = r * cosf(e) * cosf(a);
+			p[2] = BENCH_DIMS == 3 ? r * sinf(e) + 1.0f : 0;
+			p[3] = r;
+			p[4] = raw[i][2];
+			p[5] = raw[i][4];
+			if (!(raw[i][4] > 0) || !(fabsf(p[0]) < 15) || !(fabsf(p[1]) < 15))
+				continue;
+			added++;
+		}
+		last[frames - 1] = added;
+		window_n = keep + added;
+		if (++loaded < frames)
+			continue;
+		cloud_t *c = new_cloud(BENCH_DIMS, 0, window_n);
+		if (c == NULL)
+			break;
+		memcpy(c->pos, window, window_n * sizeof(*window));
+	}
+	free(window);
+	frame_reader_free(&reader);
+	capture_close(&capture);
+	return loaded < frames ? 0 : loaded - frames + 1;
+}
+
+/* ---------------- Cases ---------------- */
+
+static point_t *points;
+static int *labels;
+static cluster_stats_t *stats;
+static float (*rows)[6];
+
+#define INPUT_POINTS 1        // points[] as dbscan() takes them
+#define INPUT_ROWS 2          // rows[] as dbscan_output() takes them
+
+// Fresh input for a call, clustering overwrites it.
+static void prepare(int input, const cloud_t *c)
+{
+	for (unsigned int i = 0; input == INPUT_POINTS && i < c->n; i++) {
+		points[i].x = c->pos[i][0];
+		points[i].y = c->pos[i][1];
+		points[i].z = c->pos[i][2];
+		points[i].cluster_id = UNCLASSIFIED;
+	}
+	if (input == INPUT_ROWS) {
+		memcpy(rows, c->pos, c->n * sizeof(*rows));
+		for (unsigned int i = 0; i < c->n; i++)
+			rows[i][3] = UNCLASSIFIED; // column 3 is the starting cluster_id
+	}
+}
+
+static void run_dbscan(const cloud_t *c)
+{
+	dbscan(points, c->n, DBSCAN_EPSILON, DBSCAN_MINPTS, DBSCAN_GRID_DIMS, euclidean_dist);
+}
+
+static void run_euclidean(const cloud_t *c)
+{
+	dbscan_euclidean(points, c->n, DBSCAN_EPSILON, DBSCAN_MINPTS, DBSCAN_GRID_DIMS);
+}
+
+static void run_labels(const cloud_t *c)
+{
+	dbscan_labels(&c->pos[0][0], 6, c->n, labels, NULL, stats, 4, NULL);
+}
+
+#ifndef BENCH_PEOPLE
+static void run_output(const cloud_t *c)
+{
+	Struct out = dbscan_output(rows, c->n);
+	(void) out;
+}
+#endif
+
+typedef struct {
+	const char *name;
+	void (*run)(const cloud_t *c);
+	int input;                // INPUT_POINTS, INPUT_ROWS or 0 when the cloud is read as it is
+	int any_dims;             // runs on clouds with more dims than the grid
+	unsigned int max_n;       // 0 = no limit
+} bench_case_t;
+
+static const bench_case_t cases[] = {
+	{"dbscan", run_dbscan, INPUT_POINTS, 1, 0},
+	{"dbscan_euclidean", run_euclidean, INPUT_POINTS, 0, 0},
+	{"dbscan_labels", run_labels, 0, 0, 0},
+#ifndef BENCH_PEOPLE
+	{"dbscan_output", run_output, INPUT_ROWS, 0, BENCH_OUTPUT_POINTS},
+#endif
+};
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+	double x = *(const double *) a, y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+// us at quantile q of sorted samples
+static double quantile(const double *t, int n, double q)
+{
+	int i = (int) ceil(q * n) - 1;
+	return t[i < 0 ? 0 : i] / 1e3;
+}
+
+/*
+Time a case over clouds first .. first + count - 1, iterations rounds, after one
+untimed call per cloud so the per-thread buffers have grown to it.
+*/
+static void bench(const bench_case_t *bc, int first, int count, int iterations, const char *label)
+{
+	double *t = malloc((size_t) iterations * count * sizeof(*t));
+	unsigned long allocs = 0, total_points = 0;
+	int n = 0;
+
+	for (int k = first; k < first + count; k++) {
+		const cloud_t *c = &clouds[k];
+		if ((bc->max_n && c->n > bc->max_n) || (!bc->any_dims && c->dims > BENCH_DIMS)) {
+			free(t);
+			return;
+		}
+		prepare(bc->input, c);
+		bc->run(c);
+	}
+	for (int it = 0; it < iterations; it++) {
+		for (int k = first; k < first + count; k++) {
+			const cloud_t *c = &clouds[k];
+			prepare(bc->input, c);
+			unsigned long a0 = __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+			double t0 = now_ns();
+			bc->run(c);
+			t[n++] = now_ns() - t0;
+			allocs += __atomic_load_n(&allocations, __ATOMIC_RELAXED) - a0;
+			total_points += c->n;
+		}
+	}
+	qsort(t, n, sizeof(*t), compare_double);
+	printf("%-17s %-12s %7lu %9.1f %9.1f %9.1f %9.1f %8.2f\n", bc->name, label, total_points / n,
+	       quantile(t, n, 0.5), quantile(t, n, 0.9), quantile(t, n, 0.99), t[n - 1] / 1e3, (double) allocs / n);
+	free(t);
+}
+
+/* ---------------- Old against new labels ---------------- */
+
+/*
+Recorded clouds first .. first + count - 1: the range-bin labels of the old
+dbscan_output() path against dbscan_labels(), whose labels must be dbscan()'s.
+Prints clusters, largest cluster and noise per cloud for both.
+return = 0, 1 if dbscan_labels() and dbscan() disagree on a point
+*/
+static int compare_labels(int first, int count)
+{
+	double old_clusters = 0, new_clusters = 0, old_largest = 0, new_largest = 0, new_noise = 0;
+	int changed = 0;
+	unsigned long total_points = 0;
+
+	for (int k = first; k < first + count; k++) {
+		const cloud_t *c = &clouds[k];
+		int num_old = cluster_range_bins(&c->pos[0][0], 6, c->n, 3, labels);
+		cluster_stats_build(stats, num_old, &c->pos[0][0], 6, c->n, labels, 4, NULL);
+		int largest_old = cluster_stats_largest(stats, num_old);
+		int nonempty_old = 0;
+		for (int i = 0; i < num_old; i++)
+			nonempty_old += stats[i].count > 0;
+		old_clusters += nonempty_old;
+		old_largest += largest_old < 0 ? 0 : stats[largest_old].count;
+
+		int num_new = dbscan_labels(&c->pos[0][0], 6, c->n, labels, NULL, stats, 4, NULL);
+		int largest_new = cluster_stats_largest(stats, num_new);
+		new_clusters += num_new;
+		new_largest += largest_new < 0 ? 0 : stats[largest_new].count;
+		changed += num_new != nonempty_old;
+
+		prepare(INPUT_POINTS, c);
+		dbscan(points, c->n, DBSCAN_EPSILON, DBSCAN_MINPTS, DBSCAN_GRID_DIMS, euclidean_dist);
+		for (unsigned int i = 0; i < c->n; i++) {
+			new_noise += labels[i] < 0;
+			if (labels[i] != points[i].cluster_id) {
+				printf("label mismatch in recorded cloud %d point %u: dbscan_labels %d, dbscan %d\n",
+				       k - first, i, labels[i], points[i].cluster_id);
+				return 1;
+			}
+		}
+		total_points += c->n;
+	}
+	printf("\nlabels of %d recorded clouds, %.1f points each: dbscan_labels() matches dbscan() on every point\n",
+	       count, (double) total_points / count);
+	printf("%-22s %10s %10s %10s\n", "", "clusters", "largest", "noise %");
+	printf("%-22s %10.2f %10.1f %10.1f\n", "range bins (old)", old_clusters / count, old_largest / count, 0.0);
+	printf("%-22s %10.2f %10.1f %10.1f\n", "dbscan_labels (new)", new_clusters / count, new_largest / count,
+	       total_points > 0 ? 100.0 * new_noise / total_points : 0.0);
+	printf("clouds with a different cluster count: %d of %d\n", changed, count);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int iterations = 20, frames = 3;
+	const char *replay = NULL;
+	static const unsigned int sizes[] = {10, 30, 100, 300, 1000, 2000, 5000};
+	static const int cluster_counts[] = {1, 3, 10};
+	unsigned int max_n = 0;
+
+	for (int i = 1; i + 1 < argc; i++) {
+		if (strcmp(argv[i], "--iterations") == 0)
+			iterations = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--replay") == 0)
+			replay = argv[++i];
+		else if (strcmp(argv[i], "--frames") == 0)
+			frames = atoi(argv[++i]);
+	}
+	if (iterations < 1)
+		iterations = 1;
+	if (frames < 1)
+		frames = 1;
+
+	srand(1);
+	for (int dims = 2; dims <= 3; dims++)
+		for (unsigned int c = 0; c < sizeof(cluster_counts) / sizeof(cluster_counts[0]); c++)
+			for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+				make_scene(new_cloud(dims, cluster_counts[c], sizes[s]));
+	int synthetic = num_clouds;
+	int recorded = 0;
+	if (replay != NULL && (recorded = load_capture(replay, frames)) < 0)
+		return 1;
+	for (int k = 0; k < num_clouds; k++)
+		if (clouds[k].n > max_n)
+			max_n = clouds[k].n;
+	points = malloc(max_n * sizeof(*points));
+	labels = malloc(max_n * sizeof(*labels));
+	stats = malloc(max_n * sizeof(*stats));
+	rows = malloc(max_n * sizeof(*rows));
+
+	printf("grid %dD, epsilon %.2f, minpts %d, %d iterations\n", BENCH_DIMS, DBSCAN_EPSILON, DBSCAN_MINPTS, iterations);
+	printf("%-17s %-12s %7s %9s %9s %9s %9s %8s\n", "case", "cloud", "points", "p50 us", "p90 us", "p99 us", "max us",
+	       "allocs");
+	for (unsigned int b = 0; b < sizeof(cases) / sizeof(cases[0]); b++) {
+		for (int k = 0; k < synthetic; k++) {
+			char label[32];
+			snprintf(label, sizeof(label), "%dd %dc", clouds[k].dims, clouds[k].clusters);
+			bench(&cases[b], k, 1, iterations, label);
+		}
+		if (recorded > 0)
+			bench(&cases[b], synthetic, recorded, iterations, "replay");
+	}
+	if (recorded > 0)
+		return compare_labels(synthetic, recorded);
+	return 0;
+}
@@ -0,0 +1,101 @@
+// DBSCAN cost against point count: serial dbscan_euclidean() and dbscan_parallel() with 2..N threads
+// gcc -O2 bench_dbscan.c ../common/*.c -o bench_dbscan -lm -lpthread
+// ./bench_dbscan [max threads] [iterations]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../people/dbscan.c"
+
+/* People sized blobs (0.5 x 0.5 x 1.7 m) in an 8 x 8 x 3 m room, one point in ten is clutter. */
+static void make_scene(point_t *p, unsigned int n, unsigned int persons)
+{
+	for (unsigned int i = 0; i < n; i++) {
+		double u = rand() / (double) RAND_MAX, v = rand() / (double) RAND_MAX, w = rand() / (double) RAND_MAX;
+		if (i % 10 == 9) {
+			p[i].x = u * 8 - 4;
+			p[i].y = v * 8;
+			p[i].z = w * 3;
+		} else {
+			unsigned int k = i % persons;
+			p[i].x = (k % 4) * 1.8 - 2.7 + (u - 0.5) * 0.5;
+			p[i].y = (k / 4) * 1.8 + 1.0 + (v - 0.5) * 0.5;
+			p[i].z = w * 1.7;
+		}
+		p[i].cluster_id = UNCLASSIFIED;
+	}
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void reset(point_t *p, unsigned int n)
+{
+	for (unsigned int i = 0; i < n; i++)
+		p[i].cluster_id = UNCLASSIFIED;
+}
+
+// us per call of serial (threads 1) or parallel clustering
+static double time_dbscan(point_t *p, unsigned int n, int threads, int iterations)
+{
+	double t0 = now_ns();
+	for (int it = 0; it < iterations; it++) {
+		reset(p, n);
+		if (threads < 2)
+			dbscan_euclidean(p, n, DBSCAN_EPSILON, DBSCAN_MINPTS, DBSCAN_GRID_DIMS);
+		else
+			dbscan_parallel(p, n, DBSCAN_EPSILON, DBSCAN_MINPTS, DBSCAN_GRID_DIMS);
+	}
+	return (now_ns() - t0) / iterations / 1e3;
+}
+
+int main(int argc, char *argv[])
+{
+	int max_threads = argc > 1 ? atoi(argv[1]) : 4;
+	int iterations = argc > 2 ? atoi(argv[2]) : 200;
+	static const unsigned int sizes[] = {64, 128, 256, 512, 1024, 2048, 4096};
+	unsigned int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+	unsigned int max_n = sizes[nsizes - 1];
+	point_t *p = malloc(max_n * sizeof(point_t));
+	int *serial = malloc(max_n * sizeof(int));
+
+	printf("%8s %12s", "points", "serial us");
+	for (int t = 2; t <= max_threads; t++)
+		printf("   %2d thr us  speedup", t);
+	printf("\n");
+	for (unsigned int s = 0; s < nsizes; s++) {
+		unsigned int n = sizes[s];
+		srand(n);
+		make_scene(p, n, n < 256 ? 2 : 8);
+		double serial_us = time_dbscan(p, n, 1, iterations);
+		for (unsigned int i = 0; i < n; i++)
+			serial[i] = p[i].cluster_id;
+		printf("%8u %12.1f", n, serial_us);
+		for (int t = 2; t <= max_threads; t++) {
+			if (dbscan_set_threads(t) != 0)
+				return 1;
+			// the parallel labels must be the serial ones, cluster ids included
+			reset(p, n);
+			dbscan_parallel(p, n, DBSCAN_EPSILON, DBSCAN_MINPTS, DBSCAN_GRID_DIMS);
+			for (unsigned int i = 0; i < n; i++) {
+				if (p[i].cluster_id != serial[i]) {
+					printf("\nlabel mismatch at point %u with %d threads: %d against %d\n",
+					       i, t, p[i].cluster_id, serial[i]);
+					return 1;
+				}
+			}
+			double us = time_dbscan(p, n, t, iterations);
+			printf("   %9.1f  x%6.2f", us, serial_us / us);
+		}
+		printf("\n");
+		dbscan_set_threads(1);
+	}
+	free(p);
+	free(serial);
+	return 0;
+}
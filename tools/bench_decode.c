@@ -0,0 +1,180 @@
+// Per-frame decode cost: bit-by-bit IEEE-754 path (v1.0 parsers) against common/radar_decode.h
+// gcc -O3 bench_decode.c -o bench_decode -lm
+// ./bench_decode [iterations] [points]
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../common/radar_decode.h"
+
+/* ---------------- Legacy decoder, copied from the v1.0 parsers ---------------- */
+
+typedef union {
+	float f;
+	struct
+	{
+		unsigned int mantissa : 23;
+		unsigned int exponent : 8;
+		unsigned int sign : 1;
+	} raw;
+} myfloat;
+
+static unsigned int convertToInt(int *arr, int low, int high)
+{
+	unsigned f = 0, i;
+	for (i = high; i >= low; i--) {
+		f = f + arr[i] * pow(2, high - i);
+	}
+	return f;
+}
+
+static float legacy_float(const unsigned char *buf, int last)
+{
+	int ieee[32];
+	int k = 0;
+	for (int ix1 = last; ix1 > last - 4; --ix1)
+		for (int ix = 0; ix < 8; ++ix)
+			ieee[k++] = (buf[ix1] << ix & 0x80) >> 7;
+	myfloat var;
+	var.raw.mantissa = convertToInt(ieee, 9, 31);
+	var.raw.exponent = convertToInt(ieee, 1, 8);
+	var.raw.sign = ieee[0];
+	return var.f;
+}
+
+static void legacy_pc(const unsigned char *read_buf, int total_point, float (*out)[5])
+{
+	float V6_unit[5];
+	int v6_point_before[5];
+	for (int ix2 = 0; ix2 < 5; ++ix2)
+		V6_unit[ix2] = legacy_float(read_buf, 59 + (ix2 * 4));
+	for (int id_point = 0; id_point < total_point; ++id_point) {
+		int index = 76 + (8 * id_point);
+		for (int ix = index; ix < index + 2; ++ix)
+			v6_point_before[ix - index] = (signed char) read_buf[ix];
+		for (int ix = index + 2; ix < index + 8; ix = ix + 2)
+			v6_point_before[(ix - (index - 2)) / 2] = (short) ((read_buf[ix] << 0) + (read_buf[ix + 1] << 8));
+		for (int num = 0; num < 5; ++num)
+			out[id_point][num] = v6_point_before[num] * V6_unit[num];
+	}
+}
+
+static void legacy_vs(const unsigned char *read_buf, float *vsos_array)
+{
+	const unsigned char *vsos_byte = read_buf + 48;
+	for (int ix2 = 0; ix2 < 2; ix2++)
+		vsos_array[ix2] = (float) ((vsos_byte[ix2 * 2] << 0) + (vsos_byte[(ix2 * 2) + 1] << 8));
+	vsos_array[2] = legacy_float(vsos_byte, 7);
+	for (int ix2 = 4; ix2 < 8; ix2++)
+		vsos_array[ix2 - 1] = (float) ((vsos_byte[ix2 * 2] << 0) + (vsos_byte[(ix2 * 2) + 1] << 8));
+	for (int ix2 = 0; ix2 < 27; ix2++)
+		vsos_array[ix2 + 7] = legacy_float(vsos_byte, 19 + (ix2 * 4));
+}
+
+/* ---------------- Synthetic frames ---------------- */
+
+static void make_pc_frame(unsigned char *buf, int points)
+{
+	pc_frame_header_t h = {{2, 1, 4, 3, 6, 5, 8, 7}, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0};
+	h.totalPackLen = PC_POINT_OFFSET + 8 * points;
+	tlv_header_t t = {PC_TLV_POINT_CLOUD, 8 + 20 + 8 * points};
+	pc_point_unit_t u = {0.01f, 0.01f, 0.00028f, 0.00025f, 0.04f};
+	memcpy(buf, &h, sizeof(h));
+	memcpy(buf + PC_TLV_OFFSET, &t, sizeof(t));
+	memcpy(buf + PC_UNIT_OFFSET, &u, sizeof(u));
+	for (int i = 0; i < points; i++) {
+		pc_point_t p = {(int8_t) (rand() % 200 - 100), (int8_t) (rand() % 200 - 100),
+		                (int16_t) (rand() % 2000 - 1000), (int16_t) (rand() % 16000), (int16_t) (rand() % 1000)};
+		memcpy(buf + PC_POINT_OFFSET + 8 * i, &p, sizeof(p));
+	}
+}
+
+static void make_vs_frame(unsigned char *buf)
+{
+	vs_output_stats_t s;
+	memset(buf, 0, VS_FRAME_LEN);
+	memset(&s, 0, sizeof(s));
+	s.rangeBinIndexMax = 20;
+	s.maxVal = 1234.5f;
+	for (int i = 0; i < 27; i++) {
+		float v = (rand() % 100000) / 7.0f - 5000.0f;
+		memcpy((unsigned char *) &s + offsetof(vs_output_stats_t, unwrapPhasePeak_mm) + 4 * i, &v, 4);
+	}
+	memcpy(buf + VS_STATS_OFFSET, &s, sizeof(s));
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+	int points = argc > 2 ? atoi(argv[2]) : 100;
+	unsigned char *pc = malloc(PC_POINT_OFFSET + 8 * points);
+	unsigned char vs[VS_FRAME_LEN];
+	float (*out_a)[5] = malloc(sizeof(float[5]) * points);
+	float (*out_b)[5] = malloc(sizeof(float[5]) * points);
+	float vs_a[VS_ARRAY_LEN], vs_b[VS_ARRAY_LEN];
+	volatile float sink = 0;
+
+	srand(1);
+	make_pc_frame(pc, points);
+	make_vs_frame(vs);
+
+	// Both paths must agree before timing them
+	legacy_pc(pc, points, out_a);
+	pc_point_unit_t u;
+	decode_pc_point_unit(pc + PC_UNIT_OFFSET, &u);
+	decode_pc_points(pc + PC_POINT_OFFSET, points, &u, out_b);
+	if (memcmp(out_a, out_b, sizeof(float[5]) * points) != 0) {
+		printf("point cloud decode mismatch\n");
+		return 1;
+	}
+	legacy_vs(vs, vs_a);
+	vs_output_stats_t s;
+	decode_vs_stats(vs, &s);
+	vs_stats_to_array(&s, vs_b);
+	if (memcmp(vs_a, vs_b, sizeof(vs_a)) != 0) {
+		printf("vital signs decode mismatch\n");
+		return 1;
+	}
+
+	double t0 = now_ns();
+	for (int i = 0; i < iterations; i++) {
+		legacy_pc(pc, points, out_a);
+		sink += out_a[i % points][3];
+	}
+	double t1 = now_ns();
+	for (int i = 0; i < iterations; i++) {
+		decode_pc_point_unit(pc + PC_UNIT_OFFSET, &u);
+		decode_pc_points(pc + PC_POINT_OFFSET, points, &u, out_b);
+		sink += out_b[i % points][3];
+	}
+	double t2 = now_ns();
+	for (int i = 0; i < iterations; i++) {
+		legacy_vs(vs, vs_a);
+		sink += vs_a[7];
+	}
+	double t3 = now_ns();
+	for (int i = 0; i < iterations; i++) {
+		decode_vs_stats(vs, &s);
+		vs_stats_to_array(&s, vs_b);
+		sink += vs_b[7];
+	}
+	double t4 = now_ns();
+
+	printf("point cloud (%d points)  legacy %10.1f ns/frame   memcpy %8.1f ns/frame   x%.1f\n",
+	       points, (t1 - t0) / iterations, (t2 - t1) / iterations, (t1 - t0) / (t2 - t1));
+	printf("vital signs (vsos 128 B) legacy %10.1f ns/frame   memcpy %8.1f ns/frame   x%.1f\n",
+	       (t3 - t2) / iterations, (t4 - t3) / iterations, (t3 - t2) / (t4 - t3));
+	free(pc);
+	free(out_a);
+	free(out_b);
+	return 0;
+}
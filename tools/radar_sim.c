@@ -0,0 +1,365 @@
+// Radar simulator: emits TI mmWave UART frames on a pseudo-terminal, for load testing the parsers
+// gcc -O2 radar_sim.c -o radar_sim -lm -lutil
+// ./radar_sim [-m people|vital] [-r frames/s] [-n points] [-t targets] [-c frames] [-T]
+//             [-p partial %] [-g garbage %] [-b burst frames] [-B burst period s]
+// then point a program at the printed pty, e.g. ./pc3_read_backup 1 --device /dev/pts/3
+//
+// -p  percent of frames cut short (a random prefix is sent, the rest is lost)
+// -g  percent of frames preceded by 1-64 garbage bytes (sometimes starting with a false magic word)
+// -b  every -B seconds, send this many extra frames back to back
+// -T  people frames also carry the tracker TLVs: target list (7) and target index (8)
+//
+// The pty master is non-blocking: when the reader falls behind and the pty buffer is full,
+// bytes are dropped like an overrun UART and counted in the once per second report.
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pty.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../common/frame_reader.h"
+#include "../common/mono_clock.h"
+#include "../common/radar_decode.h"
+
+#define MODE_PEOPLE 0
+#define MODE_VITAL 1
+
+// TLV types of the vital signs demo
+#define VS_TLV_STATS 6
+#define VS_TLV_RANGE_PROFILE 2
+
+#define MAX_POINTS 1000
+#define MAX_TARGETS 16
+
+typedef struct {
+	int mode;
+	double rate;
+	int points;
+	int targets;
+	long count;
+	int partial_pct;
+	int garbage_pct;
+	int burst;
+	double burst_period;
+	int tracker;
+} sim_config_t;
+
+typedef struct {
+	unsigned long frames, partial, garbage, bursts;
+	unsigned long long bytes, dropped;
+} sim_stats_t;
+
+static volatile sig_atomic_t running = 1;
+
+static void on_signal(int sig)
+{
+	(void) sig;
+	running = 0;
+}
+
+static float frand(float lo, float hi)
+{
+	return lo + (hi - lo) * (rand() / (float) RAND_MAX);
+}
+
+/* ---------------- Frame builders ---------------- */
+
+// Where target k stands at time t
+static void target_position(int k, double t, float *range, float *azimuth)
+{
+	*range = 1.5f + k * 0.8f + 0.5f * sinf((float) t * 0.2f + k);
+	*azimuth = 0.4f * sinf((float) t * 0.1f + 2 * k);
+}
+
+// People counting point cloud: header, one TLV type 6 with the unit block and the points,
+// with -T followed by the target list (7) and the target index of the previous frame's points (8).
+static int build_people_frame(uint8_t *buf, const sim_config_t *cfg, uint32_t frame_number, double t)
+{
+	const pc_point_unit_t u = {0.01f, 0.01f, 0.00028f, 0.00025f, 0.04f};
+	int n = cfg->points;
+	int len = PC_POINT_OFFSET + n * (int) sizeof(pc_point_t);
+	pc_frame_header_t h;
+	tlv_header_t tlv;
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, frame_magic_word, FRAME_MAGIC_LEN);
+	h.version = 0x03050004;
+	h.platform = 0xA6843;
+	h.frameNumber = frame_number;
+	h.numTLVs = 1;
+	tlv.type = PC_TLV_POINT_CLOUD;
+	tlv.length = sizeof(tlv) + sizeof(u) + n * sizeof(pc_point_t);
+	memcpy(buf + PC_TLV_OFFSET, &tlv, sizeof(tlv));
+	memcpy(buf + PC_UNIT_OFFSET, &u, sizeof(u));
+
+	// Targets walk slowly around the room, each point is scattered around its target
+	for (int i = 0; i < n; i++) {
+		float range, azimuth;
+		target_position(i % cfg->targets, t, &range, &azimuth);
+		float elevation = frand(-0.5f, 0.3f);
+		pc_point_t p;
+		p.elevation = (int8_t) lrintf(elevation / u.elevationUnit);
+		p.azimuth = (int8_t) lrintf((azimuth + frand(-0.08f, 0.08f)) / u.azimuthUnit);
+		p.doppler = (int16_t) lrintf(frand(-0.3f, 0.3f) / u.dopplerUnit);
+		p.range = (int16_t) lrintf((range + frand(-0.15f, 0.15f)) / u.rangeUnit);
+		p.snr = (int16_t) lrintf(frand(8.0f, 40.0f) / u.snrUnit);
+		memcpy(buf + PC_POINT_OFFSET + i * sizeof(p), &p, sizeof(p));
+	}
+
+	if (cfg->tracker) {
+		tlv.type = PC_TLV_TARGET_LIST;
+		tlv.length = sizeof(tlv) + cfg->targets * sizeof(pc_target_t);
+		memcpy(buf + len, &tlv, sizeof(tlv));
+		len += sizeof(tlv);
+		for (int k = 0; k < cfg->targets; k++) {
+			float range, azimuth;
+			pc_target_t target;
+			memset(&target, 0, sizeof(target));
+			target_position(k, t, &range, &azimuth);
+			target.tid = k;
+			target.posX = range * sinf(azimuth);
+			target.posY = range * cosf(azimuth);
+			target.posZ = 1.0f;
+			target.g = 1.0f;
+			target.confidenceLevel = 1.0f;
+			memcpy(buf + len, &target, sizeof(target));
+			len += sizeof(target);
+		}
+		// the previous frame had the same number of points, spread the same way
+		tlv.type = PC_TLV_TARGET_INDEX;
+		tlv.length = sizeof(tlv) + n;
+		memcpy(buf + len, &tlv, sizeof(tlv));
+		len += sizeof(tlv);
+		for (int i = 0; i < n; i++)
+			buf[len++] = (uint8_t) (i % cfg->targets);
+		h.numTLVs = 3;
+	}
+	h.totalPackLen = len;
+	h.checksum = pc_header_checksum(&h);
+	memcpy(buf, &h, sizeof(h));
+	return len;
+}
+
+// Vital signs: header, the 128-byte output stats TLV and the 126-entry range profile TLV.
+static int build_vital_frame(uint8_t *buf, uint32_t frame_number, double t)
+{
+	const double breath_hz = 0.25, heart_hz = 1.2;
+	vs_frame_header_t h;
+	vs_output_stats_t s;
+	tlv_header_t tlv;
+	int16_t profile[VS_RANGE_PROFILE_LEN];
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, frame_magic_word, FRAME_MAGIC_LEN);
+	h.version = 0x02010004;
+	h.totalPacketLen = VS_FRAME_LEN;
+	h.platform = 0xA1642;
+	h.frameNumber = frame_number;
+	h.numTLVs = 2;
+	memcpy(buf, &h, sizeof(h));
+
+	memset(&s, 0, sizeof(s));
+	s.rangeBinIndexMax = 20;
+	s.rangeBinIndexPhase = 20;
+	s.maxVal = frand(900.0f, 1100.0f);
+	s.rangeBinStartIndex = 10;
+	s.rangeBinEndIndex = 40;
+	float breath = (float) (4.0 * sin(2 * M_PI * breath_hz * t));
+	float heart = (float) (0.3 * sin(2 * M_PI * heart_hz * t));
+	s.unwrapPhasePeak_mm = breath + heart + frand(-0.05f, 0.05f);
+	s.outputFilterBreathOut = breath;
+	s.outputFilterHeartOut = heart;
+	s.heartRateEst_FFT = (float) (heart_hz * 60) + frand(-2, 2);
+	s.heartRateEst_FFT_4Hz = s.heartRateEst_FFT;
+	s.heartRateEst_xCorr = s.heartRateEst_FFT + frand(-1, 1);
+	s.heartRateEst_peakCount = s.heartRateEst_FFT + frand(-3, 3);
+	s.breathingRateEst_FFT = (float) (breath_hz * 60) + frand(-1, 1);
+	s.breathingEst_xCorr = s.breathingRateEst_FFT + frand(-0.5f, 0.5f);
+	s.breathingEst_peakCount = s.breathingRateEst_FFT + frand(-1, 1);
+	s.confidenceMetricBreathOut = frand(5, 20);
+	s.confidenceMetricBreathOut_xCorr = frand(0.5f, 1);
+	s.confidenceMetricHeartOut = frand(0.5f, 5);
+	s.confidenceMetricHeartOut_4Hz = s.confidenceMetricHeartOut;
+	s.confidenceMetricHeartOut_xCorr = frand(0.2f, 1);
+	s.sumEnergyBreathWfm = frand(1, 10);
+	s.sumEnergyHeartWfm = frand(0.001f, 0.01f);
+	s.breathingRateEst_harmonicEnergy = s.breathingRateEst_FFT;
+	s.heartRateEst_harmonicEnergy = s.heartRateEst_FFT;
+
+	tlv.type = VS_TLV_STATS;
+	tlv.length = sizeof(s);
+	memcpy(buf + VS_HEADER_LEN, &tlv, sizeof(tlv));
+	memcpy(buf + VS_STATS_OFFSET, &s, sizeof(s));
+
+	for (int i = 0; i < VS_RANGE_PROFILE_LEN; i++)
+		profile[i] = (int16_t) (2000 * expf(-(i - 20) * (i - 20) / 20.0f) + frand(0, 50));
+	tlv.type = VS_TLV_RANGE_PROFILE;
+	tlv.length = sizeof(profile);
+	memcpy(buf + VS_RANGE_PROFILE_OFFSET - sizeof(tlv), &tlv, sizeof(tlv));
+	memcpy(buf + VS_RANGE_PROFILE_OFFSET, profile, sizeof(profile));
+	return VS_FRAME_LEN;
+}
+
+/* ---------------- Output ---------------- */
+
+// Write without blocking, what does not fit into the pty is dropped.
+static void emit(int fd, const uint8_t *data, size_t len, sim_stats_t *st)
+{
+	while (len > 0) {
+		ssize_t n = write(fd, data, len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			st->dropped += len;
+			return;
+		}
+		st->bytes += n;
+		data += n;
+		len -= n;
+	}
+}
+
+static void emit_garbage(int fd, sim_stats_t *st)
+{
+	uint8_t junk[64];
+	int n = 1 + rand() % (int) sizeof(junk);
+
+	for (int i = 0; i < n; i++)
+		junk[i] = (uint8_t) rand();
+	// a false magic word with an absurd length makes the reader resync
+	if (n >= FRAME_LEN_OFFSET + 4 && rand() % 4 == 0) {
+		memcpy(junk, frame_magic_word, FRAME_MAGIC_LEN);
+		junk[FRAME_LEN_OFFSET + 3] = 0xFF;
+	}
+	emit(fd, junk, n, st);
+	st->garbage++;
+}
+
+static void send_frame(int fd, const sim_config_t *cfg, uint32_t frame_number, double t, uint8_t *buf, sim_stats_t *st)
+{
+	int len = cfg->mode == MODE_PEOPLE ? build_people_frame(buf, cfg, frame_number, t)
+	                                   : build_vital_frame(buf, frame_number, t);
+
+	if (cfg->garbage_pct > 0 && rand() % 100 < cfg->garbage_pct)
+		emit_garbage(fd, st);
+	if (cfg->partial_pct > 0 && rand() % 100 < cfg->partial_pct) {
+		len = 1 + rand() % (len - 1);
+		st->partial++;
+	}
+	emit(fd, buf, len, st);
+	st->frames++;
+}
+
+static void sleep_until(uint64_t due)
+{
+	uint64_t now = mono_ns();
+	if (due <= now)
+		return;
+	struct timespec ts = {(time_t) ((due - now) / 1000000000ull), (long) ((due - now) % 1000000000ull)};
+	nanosleep(&ts, NULL);
+}
+
+static void usage(const char *prog)
+{
+	printf("usage: %s [-m people|vital] [-r frames/s] [-n points] [-t targets] [-c frames]\n"
+	       "          [-p partial %%] [-g garbage %%] [-b burst frames] [-B burst period s] [-T]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	sim_config_t cfg = {MODE_PEOPLE, 20.0, 100, 2, 0, 0, 0, 0, 5.0, 0};
+	sim_stats_t st, last;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:r:n:t:c:p:g:b:B:Th")) != -1) {
+		switch (opt) {
+		case 'm': cfg.mode = strcmp(optarg, "vital") == 0 ? MODE_VITAL : MODE_PEOPLE; break;
+		case 'r': cfg.rate = atof(optarg); break;
+		case 'n': cfg.points = atoi(optarg); break;
+		case 't': cfg.targets = atoi(optarg); break;
+		case 'c': cfg.count = atol(optarg); break;
+		case 'p': cfg.partial_pct = atoi(optarg); break;
+		case 'g': cfg.garbage_pct = atoi(optarg); break;
+		case 'b': cfg.burst = atoi(optarg); break;
+		case 'B': cfg.burst_period = atof(optarg); break;
+		case 'T': cfg.tracker = 1; break;
+		default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+		}
+	}
+	if (cfg.rate <= 0 || cfg.points < 0 || cfg.points > MAX_POINTS || cfg.targets < 1 || cfg.targets > MAX_TARGETS
+	    || cfg.burst_period <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	int master, slave;
+	char name[64];
+	struct termios tty;
+	memset(&tty, 0, sizeof(tty));
+	cfmakeraw(&tty);
+	cfsetispeed(&tty, B921600);
+	cfsetospeed(&tty, B921600);
+	if (openpty(&master, &slave, name, &tty, NULL) != 0) {
+		printf("Error %i from openpty: %s\n", errno, strerror(errno));
+		return 1;
+	}
+	fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+	signal(SIGPIPE, SIG_IGN);
+
+	printf("%s frames on %s  %.1f frames/s", cfg.mode == MODE_PEOPLE ? "people" : "vital signs", name, cfg.rate);
+	if (cfg.mode == MODE_PEOPLE)
+		printf("  %d points  %d targets%s", cfg.points, cfg.targets, cfg.tracker ? "  tracker TLVs" : "");
+	printf("\n");
+	// 921600 baud 8N1 carries 92160 bytes/s, the pty itself is not paced
+	int frame_len = cfg.mode == MODE_PEOPLE ? PC_POINT_OFFSET + cfg.points * (int) sizeof(pc_point_t) : VS_FRAME_LEN;
+	if (cfg.mode == MODE_PEOPLE && cfg.tracker)
+		frame_len += 2 * sizeof(tlv_header_t) + cfg.targets * sizeof(pc_target_t) + cfg.points;
+	if (frame_len * cfg.rate > 92160)
+		printf("note: %.0f bytes/s is more than a 921600 baud UART can carry\n", frame_len * cfg.rate);
+	fflush(stdout);
+
+	// The slave stays open here too, so the pty survives the reader restarting
+	uint8_t *buf = malloc(PC_POINT_OFFSET + MAX_POINTS * (sizeof(pc_point_t) + 1)
+	                      + 2 * sizeof(tlv_header_t) + MAX_TARGETS * sizeof(pc_target_t));
+	uint64_t period = (uint64_t) (1e9 / cfg.rate);
+	uint64_t start = mono_ns(), next = start, next_report = start + 1000000000ull;
+	uint64_t next_burst = start + (uint64_t) (cfg.burst_period * 1e9);
+	uint32_t frame_number = 1;
+
+	memset(&st, 0, sizeof(st));
+	last = st;
+	while (running && (cfg.count == 0 || st.frames < (unsigned long) cfg.count)) {
+		sleep_until(next);
+		next += period;
+		double t = (mono_ns() - start) / 1e9;
+		send_frame(master, &cfg, frame_number++, t, buf, &st);
+
+		if (cfg.burst > 0 && mono_ns() >= next_burst) {
+			for (int i = 0; i < cfg.burst; i++)
+				send_frame(master, &cfg, frame_number++, t, buf, &st);
+			st.bursts++;
+			next_burst += (uint64_t) (cfg.burst_period * 1e9);
+		}
+		if (mono_ns() >= next_report) {
+			printf("frames %lu (+%lu)  %.1f kB/s  dropped %llu B  partial %lu  garbage %lu  bursts %lu\n",
+			       st.frames, st.frames - last.frames, (st.bytes - last.bytes) / 1e3, st.dropped, st.partial,
+			       st.garbage, st.bursts);
+			fflush(stdout);
+			last = st;
+			next_report += 1000000000ull;
+		}
+	}
+
+	free(buf);
+	close(slave);
+	close(master);
+	return 0;
+}
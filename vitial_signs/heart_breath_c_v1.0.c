@@ -15,12 +15,19 @@
 #include <time.h>
 #include <complex.h>
 #include "pocketfft.h"
+#include "../common/frame_reader.h"
+#include "../common/serial_port.h"
+#include "../common/vs_ingest.h"
+#include "../common/radar_decode.h"
+#include "../common/stage_timer.h"
+#include "../common/result_log.h"
+#include "../common/dashboard.h"
+#include "../common/stop_signal.h"
 
 // sklearn model
 #include "svm_br_office_all.h"
 #include "svm_hr_office_all.h"
 
-struct timeval start, stop;
 double secs = 0;
 
 /*
@@ -197,38 +204,6 @@ void quickSort(int array[], int low, int high)
 }
 /* ----------- QuickSort (End) ----------- */
 
-typedef union
-{
-	float f;
-	struct
-	{
-		unsigned int mantissa : 23;
-		unsigned int exponent : 8;
-		unsigned int sign : 1;
-	} raw;
-} myfloat;
-
-unsigned int convertToInt(int *arr, int low, int high)
-{
-	unsigned f = 0, i;
-	for (i = high; i >= low; i--)
-	{
-		f = f + arr[i] * pow(2, high - i);
-	}
-	return f;
-}
-
-unsigned int ieee754_convert(int *ieee)
-{
-	myfloat var;
-	unsigned f = convertToInt(ieee, 9, 31);
-	var.raw.mantissa = f;
-	f = convertToInt(ieee, 1, 8);
-	var.raw.exponent = f;
-	var.raw.sign = ieee[0];
-	return var.f;
-}
-
 // Data containers
 float unwrapPhasePeak_mm[800];
 float heartRateEst_FFT_mean[800];
@@ -328,7 +303,7 @@ void mean_fn_double (double *sig, int sig_len, double *output_d)
     *output_d = *output_d / sig_len;
 }
 
-int main(void)
+int main(int argc, char *argv[])
 {
 	/* Initialize (Feature_detection) */
 	int len_s_half;  // Signal length and half length
@@ -343,64 +318,41 @@ int main(void)
 	int location;  // 用於取值
 	int ltera, sum_v, sum_p;  // 第幾輪, compress 後共幾個 valley, compress 後共幾個 peak
 
-	int serial_port = open("/dev/ttyTHS1", O_RDWR);  // 設定 port 號
-	struct termios tty;
-
-	if (tcgetattr(serial_port, &tty) != 0)
-	{
-		printf("Error %i from tcgetattr: %s\n", errno, strerror(errno));
+	/* --record <file> 錄下 UART 原始資料, --replay <file> [--speed N|max] 不接雷達重播 */
+	capture_t capture;
+	if (capture_parse_args(&capture, argc, argv) != 0)
 		return 1;
+	stage_timer_init(argc, argv);
+	result_log_config(argc, argv);
+	// --headless 不顯示, --display-hz N 畫面更新率
+	static dashboard_t dash;
+	dashboard_region_t view;
+	dashboard_init(&dash, argc, argv, 0);
+	dashboard_region_init(&view, &dash, 0, DASHBOARD_ROWS);
+	int serial_port = -1;  // 設定 port 號
+	if (capture.mode != CAPTURE_REPLAY)
+	{
+		serial_port = serial_open(serial_device_arg(argc, argv));
+		if (serial_port < 0)
+			return 1;
 	}
-	tty.c_cflag &= ~PARENB;
-	tty.c_cflag &= ~CSTOPB;
-	tty.c_cflag &= ~CSIZE;
-	tty.c_cflag |= CS8;
-	tty.c_cflag &= ~CRTSCTS;
-	tty.c_cflag |= CREAD | CLOCAL;
-	tty.c_lflag &= ~ICANON;
-	tty.c_lflag &= ~ECHO;
-	tty.c_lflag &= ~ECHOE;
-	tty.c_lflag &= ~ECHONL;
-	tty.c_lflag &= ~ISIG;
-	tty.c_iflag &= ~(IXON | IXOFF | IXANY);
-	tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL);
-	tty.c_oflag &= ~OPOST;
-	tty.c_oflag &= ~ONLCR;
-	tty.c_cc[VTIME] = 10;
-	tty.c_cc[VMIN] = 0;
-
-	cfsetispeed(&tty, B921600);
-	cfsetospeed(&tty, B921600);
-
-	if (tcsetattr(serial_port, TCSANOW, &tty) != 0)
+
+	frame_reader_t reader;  // Reassembles complete frames from the UART stream.
+	if (frame_reader_init(&reader, serial_port) != 0)
 	{
-		printf("Error %i from tcsetattr: %s\n", errno, strerror(errno));
+		printf("Error from frame_reader_init\n");
 		return 1;
 	}
-
-	char read_buf[1024];
-	int size;
+	frame_reader_set_capture(&reader, &capture);
+	vs_ingest_t ingest;  // 讀取 port 與解碼的 thread
+	vs_frame_t frame;  // 從 ingest thread 取出的 frame
 	int data_idx = 0;
-	unsigned long int header_reader_output[10];
-	unsigned long int byte[4];
-	unsigned long int tlv_header_reader_output[2];
-	unsigned int vsos_byte[128];
-	unsigned int tlv_header[4];
-	short int rangeProfile[2];
-	float vsos_array[34];			   //主要輸出1
-	short int rangeProfile_array[126]; //主要輸出2
-	short int int16_number;
-	int i = 0;
-	int j = 0;
-	int k = 0;
-	int int16_temp_number = 0;
-	unsigned int ieee[32];
-	unsigned int int16_temp[16];
-	int magicWord[8] = {2, 1, 4, 3, 6, 5, 8, 7};
+	float vsos_array[VS_ARRAY_LEN];			   //主要輸出1
+	short int rangeProfile_array[VS_RANGE_PROFILE_LEN]; //主要輸出2
 
 	/* Initialize */
 	time_t start_time;  // 宣告時間變數 (開始時間)
-	start_time = time(NULL);  // 讀取當前時間做為 (開始時間)
+	start_time = capture_wall_time(&capture);  // 讀取當前時間做為 (開始時間), 重播時為錄製時間
 	int array_index = 0;  // 輸入值累加數量 ( 需累加到 800 個值才開始執行後續算法)
 	float phase_diff[799];  // 宣告存放相位差的陣列 (長度 799)
 	double removed_noise[799];  // 宣告存放 Remove_impulse_noise 後的陣列 (長度 799)
@@ -440,136 +392,33 @@ int main(void)
     strcat(filename, root_dir);
     strcat(filename, input_name);
     strcat(filename, ".csv");
-    FILE *fp = fopen(filename, "w");
-    if (fp == NULL)
+    // 檔案一直開著, 背景 thread 批次寫入
+    result_log_t csv_log;
+    if (result_log_open(&csv_log, filename, "w") != 0)
     {
-        printf("error");
         return -1;
     }
-	fprintf(fp, "Times, heart, breath\n");
-	fclose(fp);
+	result_log_printf(&csv_log, "Times, heart, breath\n");
+
+	/* 由另一個 thread 持續讀取 port，解碼後放入 queue */
+	if (vs_ingest_start(&ingest, &reader) != 0)
+		return 1;
+	ingest.stop_flag = &stop_requested;  // Ctrl+C 或 kill 結束迴圈, 照樣寫完 csv 並印出統計
+	stop_signal_init();
 
 	/* Start execution of the algorithm */
 	while (1)
 	{
-		/* 從雷達讀取檔案資料 */
-		while ((size = read(serial_port, &read_buf, sizeof(read_buf) - 1)) > 0)
-		{
-			// printf("----------start-----------\n");
-			gettimeofday(&start, NULL);
-			int state = 0;
-			if (state == 0)
-			{
-				int same = 0;
-				for (int ix = 0; ix < 8; ++ix)
-				{
-					// printf("%d\n", read_buf[ix]);
-					if (read_buf[ix] == magicWord[ix])
-					{
-						same++;
-						if (same == 8)
-						{
-							state = 1;
-						}
-					}
-				}
-			}
-			if (state == 1)
-			{
-				for (int ix = 0; ix < 40; ++ix)
-				{
-					byte[i] = read_buf[ix + 8];
-					i++;
-					if (i == 4)
-					{
-						header_reader_output[((ix + 1) / 4) - 1] = ((byte[0] << 0) + (byte[1] << 8) + (byte[2] << 16) + (byte[3] << 24));
-						i = 0;
-					}
-				}
-				for (int ix = 48; ix < 176; ++ix)
-				{
-					vsos_byte[j] = read_buf[ix];
-					j++;
-					if (j == 4)
-					{
-						for (int ix2 = 0; ix2 < 2; ix2++)
-						{
-							vsos_array[ix2] = (float)((vsos_byte[ix2 * 2] << 0) + (vsos_byte[(ix2 * 2) + 1] << 8));
-						}
-					}
-					if (j == 8)
-					{
-						for (int ix1 = 7; ix1 > 3; --ix1)
-						{
-							for (int ix = 0; ix < 8; ++ix)
-							{
-								ieee[k] = (vsos_byte[ix1] << ix & 0x80) >> 7;
-								k++;
-							}
-						}
-						k = 0;
-						float ieee775544 = ieee754_convert(ieee);
-						vsos_array[2] = ieee775544;
-					}
-					if (j == 18)
-					{
-						for (int ix2 = 4; ix2 < 8; ix2++)
-						{
-							vsos_array[ix2 - 1] = (float)((vsos_byte[ix2 * 2] << 0) + (vsos_byte[(ix2 * 2) + 1] << 8));
-						}
-					}
-					if (j == 128)
-					{
-						for (int ix2 = 0; ix2 < 27; ix2++)
-						{
-							for (int ix1 = 19 + (ix2 * 4); ix1 > 15 + (ix2 * 4); --ix1)
-							{
-								for (int ix = 0; ix < 8; ++ix)
-								{
-									ieee[k] = (vsos_byte[ix1] << ix & 0x80) >> 7;
-									k++;
-								}
-							}
-							k = 0;
-							myfloat var;
-							unsigned f = convertToInt(ieee, 9, 31);
-							var.raw.mantissa = f;
-							f = convertToInt(ieee, 1, 8);
-							var.raw.exponent = f;
-							var.raw.sign = ieee[0];
-							vsos_array[ix2 + 7] = var.f; // 7-33
-						}
-					}
-				}
-				j = 0;
-				for (int ix = 176; ix < 184; ++ix)
-				{
-					tlv_header[i] = read_buf[ix];
-					i++;
-					if (i == 4)
-					{
-						i = 0;
-					}
-				}
-
-				for (int ix = 184; ix < 436; ++ix)
-				{
-					rangeProfile[i] = read_buf[ix];
-					i++;
-					if (i == 2)
-					{
-						int16_number = (rangeProfile[0] << 0) + (rangeProfile[1] << 8);
-						rangeProfile_array[(ix - 185) / 2] = int16_number;
-						i = 0;
-					}
-				}
-			}
+		/* 從 ingest thread 取出已解碼的 frame，下方的運算不會讓 UART 來不及讀取 */
+		if (!vs_ingest_pop(&ingest, &frame))  // 重播結束或 Ctrl+C
 			break;
-		}
+		stage_timer_poll();  // --timing-every N 或 SIGUSR1 時印出各階段耗時
+		memcpy(vsos_array, frame.vsos_array, sizeof(vsos_array));  // vsos_array[7-33] 為 27 個 float
+		memcpy(rangeProfile_array, frame.range_profile, sizeof(rangeProfile_array));
 
 		/* 將讀取到並解碼後的資料累加，並接續使用 */
 		time_t end_time;  // 宣告結束時間
-		end_time = time(NULL);  // 以當前時間當作結束時間
+		end_time = frame.wall_time;  // 以收到 frame 的時間當作結束時間 (重播時為錄製時間，--speed max 也會加速 1 秒的排程)
 
 		/* 呼吸律與心律的能量蒐集，當超過 60 個時向左 Shift 並推疊最新的數值到陣列尾端 */
 		if (eng_index < 60)
@@ -700,7 +549,9 @@ int main(void)
 						double a[11] = {1.0,-9.780812442849507348796578298789,43.083177194495931416895473375916,-112.548980608688253823856939561665,193.103088780432216253757360391319,-227.365418151163510174228576943278,186.055050775931675843821722082794,-104.483153273330174215516308322549,38.535884265082792410339607158676,-8.429195049755342949993064394221,0.830358509857336501980284992896};
 						double delay[10] = {0}; // length of (a or b) - 1
 						size_t len_ab = sizeof(a) / sizeof(double);
+						uint64_t t_stage = stage_begin();
 						lfilter(b, a, removed_noise, y, delay, len_ab, 799, 1, 1);
+						stage_end(STAGE_LFILTER, t_stage);
 					}
 
 					//  if (order == 9) => HR
@@ -709,13 +560,17 @@ int main(void)
 						double a[19] = {1.0, -15.142612391789038, 109.52867216475022, -502.6626423702458, 1639.7914526180646, -4037.095860679349, 7772.407643496967, -11963.349399532222, 14922.878739349395, -15197.385490007382, 12665.576290591296, -8617.837327643654, 4751.9970631301, -2094.9246186588152, 722.2258948681153, -187.91289244221497, 34.75519411187606, -4.078772963228582, 0.22866640874033417};
 						double delay[18] = {0};  // length of (a or b) - 1
 						size_t len_ab = sizeof(a) / sizeof(double);
+						uint64_t t_stage = stage_begin();
 						lfilter(b, a, removed_noise, y, delay, len_ab, 799, 1, 1);
+						stage_end(STAGE_LFILTER, t_stage);
 					}
 					
 					// --------------------- FFT --------------------- 
 					int N = 799;  // FFT length & The number of samples
 					double P[800];  // Output signal(complex-value). The layout of elemens are: `nrows * ((fft_len / 2) + 1) * 2(real, img)
+					uint64_t t_stage = stage_begin();
 					rfft_forward_1d_array(y, N, N, 1, 1, P);  // Output: y
+					stage_end(STAGE_FFT, t_stage);
 
 					// Find max value index in FFT
 					int max_index = 0;  // 設定追蹤最大值的 index ，當發現新的最大值即更新
@@ -740,7 +595,9 @@ int main(void)
 					else
 						smoothing_pars = 2;
 					int len_input = sizeof(y) / sizeof(double);  // 計算輸入資料長度
+					t_stage = stage_begin();
 					double *data_s = MLR(y, smoothing_pars, len_input);  // Output: data_s
+					stage_end(STAGE_MLR, t_stage);
 					
 					// --------------------- Feature_detection ---------------------
 					// Signal length and half length
@@ -761,6 +618,7 @@ int main(void)
 					feature_valley = _local_maxima_1d(neg_x, len_input, midpoints_valley, &m_v);  // Output: feature_valley ( 最小值集合 )
 					
 					// --------------------- Feature compress --------------------- 
+					t_stage = stage_begin();
 					// Given value
 					for (int i = 0; i < m_p; i++)
 						total_feature[i] = feature_peak[i];
@@ -881,7 +739,9 @@ int main(void)
 					// Perform quicksort on data
 					quickSort(compress_feature, 0, sum_p + sum_v - 1);
 					
+					stage_end(STAGE_FEATURE_COMPRESS, t_stage);
 					// --------------------- Candidate search --------------------- 
+					t_stage = stage_begin();
 					// Initialize (feature_compress)
 					double tmp_sum, window_sum, tmp_var, window_var;
 					int NT_index, NB_index;
@@ -931,6 +791,7 @@ int main(void)
 							NB_index += 1;
 						}
 					}
+					stage_end(STAGE_CANDIDATE_SEARCH, t_stage);
 					// --------------------- Caculate breath rate --------------------- 
 					double rate, cur_rate, tmp_rate;
 					rate = 0;
@@ -971,7 +832,9 @@ int main(void)
 					if (br0hr1 == 0){
 						svm_input[1] = br_mean_FFT;
 						svm_input[2] = br_mean_xCorr;
+						t_stage = stage_begin();
 						svm_result = predict_br(svm_input);
+						stage_end(STAGE_PREDICT, t_stage);
 						if (svm_result == 0)
 							br_rate = round(rate);
 						else
@@ -981,7 +844,9 @@ int main(void)
 					else{
 						svm_input[1] = br_mean_FFT;
 						svm_input[2] = br_mean_xCorr;
+						t_stage = stage_begin();
 						svm_result = predict_hr(svm_input);
+						stage_end(STAGE_PREDICT, t_stage);
 						if (svm_result == 0)
 							hr_rate = round(rate);
 						else
@@ -1000,25 +865,32 @@ int main(void)
 				}
 
 				// 寫入 logs 檔案
-				FILE *fp = fopen(filename, "a");
-				if (fp == NULL)
-				{
-					printf("error");
-					return -1;
-				}
+				uint64_t t_io = stage_begin();
 				// tmp_breath_rate = (ceil((int)hr_rate * 1.0 / 4) + (int)br_rate) / 2;
-				fprintf(fp, "%d:%d:%d, %d, %d\n", hours, minutes, seconds, (int)hr_rate, (int)br_rate);
-				fclose(fp);
-				printf("\e[1;1H");
-				int systemArb = system("clear");
-				printf("=========================================================\n");
-				printf("|      Version: V1.0                                    |\n");
-				printf("=========================================================\n");
-				printf("|      Heart rate: %d    |    Respiratory rate: %d      |\n", (int)hr_rate, (int)br_rate);
-				printf("=========================================================\n");
+				result_log_printf(&csv_log, "%d:%d:%d, %d, %d\n", hours, minutes, seconds, (int)hr_rate, (int)br_rate);
+				stage_end(STAGE_FILE_IO, t_io);
+				// 畫面只改有變的行, 不再每次 fork 一個 clear
+				if (dashboard_begin(&view)) {
+					dashboard_printf(&view, "=========================================================\n");
+					dashboard_printf(&view, "|      Version: V1.0                                    |\n");
+					dashboard_printf(&view, "=========================================================\n");
+					dashboard_printf(&view, "|      Heart rate: %d    |    Respiratory rate: %d      |\n", (int)hr_rate, (int)br_rate);
+					dashboard_printf(&view, "=========================================================\n");
+					dashboard_end(&view);
+				}
 			}
 		}
 	}
-	close(serial_port);
+	vs_ingest_stop(&ingest);
+	dashboard_close(&dash);
+	vs_ingest_report(&ingest);
+	stage_timer_report();
+	result_log_close(&csv_log);
+	result_log_report(&csv_log);
+	frame_reader_report(&reader);
+	frame_reader_free(&reader);
+	capture_close(&capture);
+	if (serial_port >= 0)
+		close(serial_port);
 	return 0; // success
 }